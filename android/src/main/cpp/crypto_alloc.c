@@ -0,0 +1,153 @@
+#include "crypto_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+
+// OpenSSL's own allocations (cipher contexts, provider state, digests) come
+// from per-size-class free lists, so once an operation has run, the next one
+// reuses the same blocks without touching malloc, and the bytes show up in
+// aes_memory_snapshot. Blocks above the largest class go to malloc directly.
+
+#define ALLOC_MIN_SHIFT 4               // Smallest class: 16 bytes
+#define ALLOC_CLASSES 10                // 16 bytes .. 8KB
+#define ALLOC_CLASS_CACHE (128 * 1024)  // Free bytes kept per class
+#define ALLOC_LARGE ALLOC_CLASSES
+
+typedef struct {
+    size_t size;        // Bytes OpenSSL asked for
+    size_t size_class;  // ALLOC_LARGE for plain malloc blocks
+} alloc_header;
+
+typedef struct {
+    pthread_mutex_t lock;
+    alloc_header* head; // Free blocks, linked through their first payload bytes
+    size_t cached;
+} alloc_list;
+
+static alloc_list lists[ALLOC_CLASSES] = {
+    [0 ... ALLOC_CLASSES - 1] = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+};
+static int64_t in_use;
+static int64_t cached;
+static int64_t mallocs;
+
+static size_t class_size(size_t size_class) {
+    return (size_t)1 << (size_class + ALLOC_MIN_SHIFT);
+}
+
+static size_t class_of(size_t size) {
+    for (size_t c = 0; c < ALLOC_CLASSES; c++) {
+        if (size <= class_size(c)) return c;
+    }
+    return ALLOC_LARGE;
+}
+
+static alloc_header** next_of(alloc_header* block) {
+    return (alloc_header**)(block + 1);
+}
+
+static void* alloc_malloc(size_t num, const char* file, int line) {
+    size_t size_class = class_of(num);
+    alloc_header* block = NULL;
+    if (size_class != ALLOC_LARGE) {
+        alloc_list* list = &lists[size_class];
+        pthread_mutex_lock(&list->lock);
+        block = list->head;
+        if (block) {
+            list->head = *next_of(block);
+            list->cached -= class_size(size_class);
+        }
+        pthread_mutex_unlock(&list->lock);
+        if (block) __atomic_sub_fetch(&cached, (int64_t)class_size(size_class), __ATOMIC_RELAXED);
+    }
+    if (!block) {
+        size_t bytes = size_class != ALLOC_LARGE ? class_size(size_class) : num;
+        block = (alloc_header*)malloc(sizeof(alloc_header) + bytes);
+        if (!block) return NULL;
+        __atomic_add_fetch(&mallocs, 1, __ATOMIC_RELAXED);
+        crypto_stats_alloc();
+    }
+    block->size = num;
+    block->size_class = size_class;
+    __atomic_add_fetch(&in_use, (int64_t)num, __ATOMIC_RELAXED);
+    return block + 1;
+}
+
+static void alloc_free(void* addr, const char* file, int line) {
+    if (!addr) return;
+    alloc_header* block = (alloc_header*)addr - 1;
+    size_t size_class = block->size_class;
+    __atomic_sub_fetch(&in_use, (int64_t)block->size, __ATOMIC_RELAXED);
+
+    if (size_class != ALLOC_LARGE) {
+        alloc_list* list = &lists[size_class];
+        int kept = 0;
+        pthread_mutex_lock(&list->lock);
+        if (list->cached + class_size(size_class) <= ALLOC_CLASS_CACHE) {
+            *next_of(block) = list->head;
+            list->head = block;
+            list->cached += class_size(size_class);
+            kept = 1;
+        }
+        pthread_mutex_unlock(&list->lock);
+        if (kept) {
+            __atomic_add_fetch(&cached, (int64_t)class_size(size_class), __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    free(block);
+}
+
+static void* alloc_realloc(void* addr, size_t num, const char* file, int line) {
+    if (!addr) return alloc_malloc(num, file, line);
+    if (num == 0) {
+        alloc_free(addr, file, line);
+        return NULL;
+    }
+
+    alloc_header* block = (alloc_header*)addr - 1;
+    if (block->size_class != ALLOC_LARGE && num <= class_size(block->size_class)) {
+        // Still fits its class
+        __atomic_add_fetch(&in_use, (int64_t)num - (int64_t)block->size, __ATOMIC_RELAXED);
+        block->size = num;
+        return addr;
+    }
+
+    void* grown = alloc_malloc(num, file, line);
+    if (!grown) return NULL;
+    memcpy(grown, addr, block->size < num ? block->size : num);
+    alloc_free(addr, file, line);
+    return grown;
+}
+
+// Runs when the library is loaded, before OpenSSL can have allocated
+// anything; CRYPTO_set_mem_functions refuses once it has
+__attribute__((constructor))
+static void install_allocator(void) {
+    CRYPTO_set_mem_functions(alloc_malloc, alloc_realloc, alloc_free);
+}
+
+void crypto_alloc_trim(void) {
+    for (size_t c = 0; c < ALLOC_CLASSES; c++) {
+        alloc_list* list = &lists[c];
+        pthread_mutex_lock(&list->lock);
+        alloc_header* block = list->head;
+        list->head = NULL;
+        __atomic_sub_fetch(&cached, (int64_t)list->cached, __ATOMIC_RELAXED);
+        list->cached = 0;
+        pthread_mutex_unlock(&list->lock);
+
+        while (block) {
+            alloc_header* next = *next_of(block);
+            free(block);
+            block = next;
+        }
+    }
+}
+
+void crypto_alloc_snapshot(int64_t* bytes_in_use, int64_t* bytes_cached, int64_t* heap_allocations) {
+    *bytes_in_use = __atomic_load_n(&in_use, __ATOMIC_RELAXED);
+    *bytes_cached = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    *heap_allocations = __atomic_load_n(&mallocs, __ATOMIC_RELAXED);
+}
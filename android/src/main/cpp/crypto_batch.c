@@ -0,0 +1,174 @@
+#include "crypto_batch.h"
+#include "crypto_engine.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BATCH_OPEN_AHEAD 2                        // Files opened beyond the one being encrypted
+#define BATCH_CLOSE_BEHIND 4                      // Finished files the close stage may fall behind by
+#define BATCH_PREFETCH_BYTES (16 * 1024 * 1024)   // Read-ahead started per opened input
+
+typedef struct {
+    int input_fd;
+    int output_fd;
+    int result;
+} batch_file;
+
+typedef struct {
+    int mode;
+    int flags;
+    const char* key;
+    const char* const* input_paths;
+    const char* const* output_paths;
+    batch_file* files;
+    int count;
+    int background;
+
+    // Files through each stage so far; every stage handles files in order
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int opened;
+    int crypted;
+    int closed;
+} batch_job;
+
+static void advance(batch_job* job, int* stage, int value) {
+    pthread_mutex_lock(&job->lock);
+    *stage = value;
+    pthread_cond_broadcast(&job->changed);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void open_file(batch_job* job, int index) {
+    batch_file* file = &job->files[index];
+    CRYPTO_TRACE_BEGIN("aes_open");
+    file->input_fd = open(job->input_paths[index], O_RDONLY | O_CLOEXEC);
+    if (file->input_fd >= 0) {
+        file->output_fd = open(job->output_paths[index], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    }
+    CRYPTO_TRACE_END();
+    if (file->input_fd < 0 || file->output_fd < 0) {
+        file->result = -1;
+        return;
+    }
+    // Queue the reads now, so the data is in the page cache (or on its way)
+    // by the time the cipher gets to this file
+    posix_fadvise(file->input_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(file->input_fd, 0, BATCH_PREFETCH_BYTES, POSIX_FADV_WILLNEED);
+}
+
+static void finish_file(batch_job* job, int index) {
+    batch_file* file = &job->files[index];
+    if (file->output_fd >= 0) {
+        if (file->result == 0 && (job->flags & AES_BATCH_SYNC) && crypto_fdatasync(file->output_fd) != 0) {
+            file->result = -7;
+        }
+        if (close(file->output_fd) != 0 && file->result == 0) {
+            file->result = -7;
+        }
+        // Don't leave partial output (or partial plaintext) behind
+        if (file->result != 0) unlink(job->output_paths[index]);
+    }
+    if (file->input_fd >= 0) close(file->input_fd);
+}
+
+static void* opener_main(void* arg) {
+    batch_job* job = (batch_job*)arg;
+    if (job->background) aes_sched_set_thread_priority(AES_PRIORITY_BACKGROUND);
+    for (int i = 0; i < job->count; i++) {
+        pthread_mutex_lock(&job->lock);
+        while (i > job->crypted + BATCH_OPEN_AHEAD) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        pthread_mutex_unlock(&job->lock);
+        open_file(job, i);
+        advance(job, &job->opened, i + 1);
+    }
+    return NULL;
+}
+
+static void* closer_main(void* arg) {
+    batch_job* job = (batch_job*)arg;
+    if (job->background) aes_sched_set_thread_priority(AES_PRIORITY_BACKGROUND);
+    for (int i = 0; i < job->count; i++) {
+        pthread_mutex_lock(&job->lock);
+        while (job->crypted <= i) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        pthread_mutex_unlock(&job->lock);
+        finish_file(job, i);
+        advance(job, &job->closed, i + 1);
+    }
+    return NULL;
+}
+
+int aes_batch_files(int mode, const char* const* input_paths, const char* const* output_paths, int count,
+                    const char* key, int flags, int* results) {
+    if (count < 0 || (count > 0 && (!input_paths || !output_paths || !key || !results))) return -1;
+    if (count == 0) return 0;
+
+    batch_job job;
+    job.mode = mode;
+    job.flags = flags;
+    job.key = key;
+    job.input_paths = input_paths;
+    job.output_paths = output_paths;
+    job.count = count;
+    job.background = crypto_sched_background();
+    job.opened = job.crypted = job.closed = 0;
+    job.files = (batch_file*)malloc((size_t)count * sizeof(batch_file));
+    if (!job.files) return -3;
+    for (int i = 0; i < count; i++) {
+        job.files[i].input_fd = -1;
+        job.files[i].output_fd = -1;
+        job.files[i].result = 0;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+
+    // A stage whose thread can't be started runs inline on this one
+    pthread_t opener;
+    pthread_t closer;
+    int have_opener = pthread_create(&opener, NULL, opener_main, &job) == 0;
+    int have_closer = pthread_create(&closer, NULL, closer_main, &job) == 0;
+
+    for (int i = 0; i < count; i++) {
+        batch_file* file = &job.files[i];
+        if (!have_opener) {
+            open_file(&job, i);
+            advance(&job, &job.opened, i + 1);
+        }
+        pthread_mutex_lock(&job.lock);
+        while (job.opened <= i || i >= job.closed + BATCH_CLOSE_BEHIND) {
+            pthread_cond_wait(&job.changed, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        // Each file is counted in the metrics as its own operation
+        if (file->result == 0) {
+            file->result = mode == AES_BATCH_DECRYPT
+                ? aes_decrypt_fd(file->input_fd, file->output_fd, key, NULL)
+                : aes_encrypt_fd(file->input_fd, file->output_fd, key, NULL);
+        }
+        advance(&job, &job.crypted, i + 1);
+        if (!have_closer) {
+            finish_file(&job, i);
+            advance(&job, &job.closed, i + 1);
+        }
+    }
+
+    if (have_opener) pthread_join(opener, NULL);
+    if (have_closer) pthread_join(closer, NULL);
+    pthread_cond_destroy(&job.changed);
+    pthread_mutex_destroy(&job.lock);
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        results[i] = job.files[i].result;
+        if (results[i] != 0) failed++;
+    }
+    free(job.files);
+    return failed;
+}
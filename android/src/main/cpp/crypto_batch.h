@@ -0,0 +1,31 @@
+#ifndef CRYPTO_BATCH_H
+#define CRYPTO_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_BATCH_ENCRYPT 0
+#define AES_BATCH_DECRYPT 1
+
+#define AES_BATCH_SYNC 1  // fdatasync each output before it is closed
+
+// Encrypt or decrypt count files, input_paths[i] to output_paths[i], as a
+// three-stage pipeline: a thread opens the next files and starts kernel
+// read-ahead on them while the calling thread runs the cipher over the
+// current one, and another thread syncs and closes finished outputs. For
+// batches of small and medium files this hides the open, close and sync
+// latency that a loop over aes_encrypt_file pays once per file.
+//
+// The format is that of aes_encrypt_file; decryption also accepts AESFILE1.
+// results[i] receives 0 or the file's error code, and a failed file's
+// output is removed. Returns the number of failed files, or -1 / -3 if the
+// batch couldn't start.
+int aes_batch_files(int mode, const char* const* input_paths, const char* const* output_paths, int count,
+                    const char* key, int flags, int* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_BATCH_H
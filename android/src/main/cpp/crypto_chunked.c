@@ -0,0 +1,740 @@
+#include "crypto_chunked.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <linux/falloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#define CHUNKED_HEADER_SIZE 64
+#define CHUNKED_VERSION 1
+#define CHUNKED_FLAG_DIRTY 1              // Set while a sync is rewriting the file
+#define CHUNKED_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+#define FINGERPRINT_LENGTH 16
+
+static const char CHUNKED_MAGIC[8] = { 'A', 'E', 'S', 'C', 'H', 'N', 'K', '1' };
+
+// On-disk layout (little-endian, like every supported ABI)
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunk_size;
+    uint64_t plaintext_size;
+    uint64_t chunk_count;
+    uint64_t index_offset;
+    uint32_t flags;
+    uint32_t reserved;
+    unsigned char key_check[16];
+} chunked_header;
+
+typedef struct {
+    uint64_t offset;                            // File offset of the chunk's ciphertext
+    uint32_t length;                            // Plaintext (= ciphertext) length
+    uint32_t flags;
+    unsigned char nonce[IV_LENGTH];             // Initial CTR counter block of the chunk
+    unsigned char fingerprint[FINGERPRINT_LENGTH];
+} chunked_entry;
+
+_Static_assert(sizeof(chunked_header) == CHUNKED_HEADER_SIZE, "chunked header layout");
+_Static_assert(sizeof(chunked_entry) == 48, "chunked index entry layout");
+
+typedef struct {
+    unsigned char enc_key[AES_KEY_LENGTH];
+    unsigned char mac_key[SHA256_DIGEST_LENGTH];
+    unsigned char key_check[16];
+} chunked_keys;
+
+static void derive_label(const unsigned char* prepared_key, const char* label, unsigned char* out) {
+    unsigned char material[64 + AES_KEY_LENGTH];
+    size_t label_len = strlen(label);
+    memcpy(material, label, label_len);
+    memcpy(material + label_len, prepared_key, AES_KEY_LENGTH);
+    SHA256(material, label_len + AES_KEY_LENGTH, out);
+}
+
+static void derive_keys(const char* key, chunked_keys* keys) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    crypto_prepare_key(key, keys->enc_key);
+    derive_label(keys->enc_key, "aes_encrypt_file chunk fingerprint", keys->mac_key);
+    derive_label(keys->enc_key, "aes_encrypt_file chunk key check", digest);
+    memcpy(keys->key_check, digest, sizeof(keys->key_check));
+}
+
+static void fingerprint_chunk(const chunked_keys* keys, const unsigned char* data, size_t length,
+                              unsigned char* fingerprint) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    unsigned int digest_len = 0;
+    HMAC(EVP_sha256(), keys->mac_key, sizeof(keys->mac_key), data, length, digest, &digest_len);
+    memcpy(fingerprint, digest, FINGERPRINT_LENGTH);
+}
+
+int crypto_chunked_probe(const unsigned char* head, size_t length, aes_file_metadata* info) {
+    if (length < sizeof(CHUNKED_MAGIC) || memcmp(head, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC)) != 0) {
+        return -1;
+    }
+    info->format = AES_FILE_FORMAT_CHUNKED;
+    info->algorithm = AES_ALGORITHM_AES_256_CTR;
+    info->header_size = CHUNKED_HEADER_SIZE;
+    if (length >= sizeof(chunked_header)) {
+        chunked_header header;
+        memcpy(&header, head, sizeof(header));
+        info->version = header.version;
+        info->chunk_size = header.chunk_size;
+        // A dirty header may describe an interrupted sync; its size is not reliable
+        if ((header.flags & CHUNKED_FLAG_DIRTY) == 0) {
+            info->plaintext_size = (int64_t)header.plaintext_size;
+        }
+    }
+    return 0;
+}
+
+// Load and validate header and index. Returns -12 for another format, -2 for
+// an unknown version or a damaged index, -10 for a wrong key and -11 for a
+// container left dirty by an interrupted sync, trim or concat.
+static int read_container(int fd, const chunked_keys* keys, chunked_header* header, chunked_entry** entries) {
+    struct stat64 st;
+    if (fstat64(fd, &st) != 0 ||
+        crypto_pread_full(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header)) {
+        return -1;
+    }
+    if (memcmp(header->magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC)) != 0) return -12;
+    if (header->version != CHUNKED_VERSION) return -2;
+    if (CRYPTO_memcmp(header->key_check, keys->key_check, sizeof(keys->key_check)) != 0) return -10;
+    if ((header->flags & CHUNKED_FLAG_DIRTY) != 0) return -11;
+
+    uint64_t index_size = header->chunk_count * sizeof(chunked_entry);
+    if (header->chunk_count > (uint64_t)st.st_size / sizeof(chunked_entry) ||
+        header->index_offset < CHUNKED_HEADER_SIZE ||
+        header->index_offset + index_size > (uint64_t)st.st_size) {
+        return -2;
+    }
+
+    chunked_entry* list = (chunked_entry*)malloc(index_size ? index_size : 1);
+    if (!list) return -3;
+    if (crypto_pread_full(fd, list, index_size, (off64_t)header->index_offset) != (ssize_t)index_size) {
+        free(list);
+        return -1;
+    }
+
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < header->chunk_count; i++) {
+        if (list[i].length > CHUNKED_MAX_CHUNK_SIZE ||
+            list[i].offset < CHUNKED_HEADER_SIZE ||
+            list[i].offset + list[i].length > header->index_offset) {
+            free(list);
+            return -2;
+        }
+        total += list[i].length;
+    }
+    if (total != header->plaintext_size) {
+        free(list);
+        return -2;
+    }
+
+    *entries = list;
+    return 0;
+}
+
+// Files written by sync keep chunk i at a fixed slot, which is what allows
+// in-place rewrites; anything else is rewritten from scratch
+static int is_slot_layout(const chunked_header* header, const chunked_entry* entries) {
+    for (uint64_t i = 0; i < header->chunk_count; i++) {
+        int last = i + 1 == header->chunk_count;
+        if (entries[i].offset != CHUNKED_HEADER_SIZE + i * header->chunk_size ||
+            (last ? entries[i].length > header->chunk_size : entries[i].length != header->chunk_size)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Index goes right after the last chunk, the file is cut there, and only then
+// is the header (which must still carry CHUNKED_FLAG_DIRTY) made clean
+static int commit_container(int fd, chunked_header* header, const chunked_entry* entries) {
+    uint64_t end = CHUNKED_HEADER_SIZE;
+    for (uint64_t i = 0; i < header->chunk_count; i++) {
+        if (entries[i].offset + entries[i].length > end) end = entries[i].offset + entries[i].length;
+    }
+    header->index_offset = end;
+    size_t index_size = (size_t)header->chunk_count * sizeof(chunked_entry);
+    if (crypto_pwrite_full(fd, entries, index_size, (off64_t)end) != 0 ||
+        ftruncate64(fd, (off64_t)(end + index_size)) != 0 ||
+        crypto_fdatasync(fd) != 0) {
+        return -7;
+    }
+    header->flags = 0;
+    if (crypto_pwrite_full(fd, header, sizeof(*header), 0) != 0 || crypto_fsync(fd) != 0) {
+        return -7;
+    }
+    return 0;
+}
+
+// Copy the ciphertext of entries into output_fd from position on, rewriting
+// their offsets; runs that are contiguous in the source go in one copy
+static int copy_chunks(int input_fd, chunked_entry* entries, uint64_t count, int output_fd, uint64_t* position) {
+    uint64_t run_source = 0;
+    uint64_t run_target = *position;
+    uint64_t run_length = 0;
+    for (uint64_t i = 0; i <= count; i++) {
+        if (i < count && run_length > 0 && entries[i].offset == run_source + run_length) {
+            run_length += entries[i].length;
+        } else {
+            if (run_length > 0) {
+                int result = crypto_copy_range(input_fd, (off64_t)run_source, output_fd, (off64_t)run_target, run_length);
+                if (result != 0) return result;
+            }
+            if (i == count) break;
+            run_source = entries[i].offset;
+            run_target = *position;
+            run_length = entries[i].length;
+        }
+        entries[i].offset = *position;
+        *position += entries[i].length;
+    }
+    return 0;
+}
+
+static int same_file(const struct stat64* a, const struct stat64* b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino;
+}
+
+// Swaps a read-only input for a writable one once it turns out to be the
+// output too, so inputs that are only read never need write permission
+static int reopen_writable(int* fd, const char* path, const struct stat64* expected) {
+    int writable = open(path, O_RDWR | O_CLOEXEC);
+    struct stat64 st;
+    if (writable < 0) return -1;
+    if (fstat64(writable, &st) != 0 || !same_file(&st, expected)) {
+        close(writable);
+        return -1;
+    }
+    close(*fd);
+    *fd = writable;
+    return 0;
+}
+
+static int chunked_sync_file(const char* input_path, const char* output_path, const char* key, uint32_t chunk_size) {
+    if (chunk_size == 0) chunk_size = AES_CHUNKED_DEFAULT_CHUNK_SIZE;
+    if (chunk_size > CHUNKED_MAX_CHUNK_SIZE) return -1;
+
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    struct stat64 input_stat;
+    if (input_fd < 0 || fstat64(input_fd, &input_stat) != 0) {
+        if (input_fd >= 0) close(input_fd);
+        return -1;
+    }
+    int output_fd = open(output_path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (output_fd < 0) {
+        close(input_fd);
+        return -1;
+    }
+
+    chunked_keys keys;
+    derive_keys(key, &keys);
+
+    // Reuse the existing index when the file is a clean container for this key
+    chunked_header old_header;
+    chunked_entry* old_entries = NULL;
+    uint64_t old_count = 0;
+    if (read_container(output_fd, &keys, &old_header, &old_entries) == 0) {
+        if (old_header.chunk_size == chunk_size && is_slot_layout(&old_header, old_entries)) {
+            old_count = old_header.chunk_count;
+        }
+    }
+
+    uint64_t plaintext_size = (uint64_t)input_stat.st_size;
+    uint64_t chunk_count = (plaintext_size + chunk_size - 1) / chunk_size;
+
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = NULL;
+    chunked_entry* entries = (chunked_entry*)calloc(chunk_count ? chunk_count : 1, sizeof(chunked_entry));
+    unsigned char* plain = (unsigned char*)crypto_mem_acquire(chunk_size);
+    unsigned char* cipher = (unsigned char*)crypto_mem_acquire(chunk_size);
+    if (!entries || !plain || !cipher) {
+        result = -3;
+        goto done;
+    }
+
+    // Mark the file dirty before touching any chunk so an interrupted sync is
+    // never mistaken for a valid container
+    chunked_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC));
+    header.version = CHUNKED_VERSION;
+    header.chunk_size = chunk_size;
+    header.flags = CHUNKED_FLAG_DIRTY;
+    memcpy(header.key_check, keys.key_check, sizeof(keys.key_check));
+    if (crypto_pwrite_full(output_fd, &header, sizeof(header), 0) != 0 ||
+        (old_count > 0 && crypto_fdatasync(output_fd) != 0)) {
+        result = -7;
+        goto done;
+    }
+
+    ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        result = -3;
+        goto done;
+    }
+    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, keys.enc_key, NULL) != 1) {
+        result = -4;
+        goto done;
+    }
+
+    int written = 0;
+    for (uint64_t i = 0; i < chunk_count; i++) {
+        uint64_t remaining = plaintext_size - i * chunk_size;
+        size_t length = remaining < chunk_size ? (size_t)remaining : chunk_size;
+        if (crypto_read_full(input_fd, plain, length) != (ssize_t)length) {
+            result = -1;
+            goto done;
+        }
+
+        chunked_entry* entry = &entries[i];
+        fingerprint_chunk(&keys, plain, length, entry->fingerprint);
+        if (i < old_count && old_entries[i].length == length &&
+            CRYPTO_memcmp(old_entries[i].fingerprint, entry->fingerprint, FINGERPRINT_LENGTH) == 0) {
+            *entry = old_entries[i];
+            continue;
+        }
+
+        // Changed chunk: fresh nonce so no keystream is ever reused
+        int out_length;
+        if (RAND_bytes(entry->nonce, IV_LENGTH) != 1) {
+            result = -2;
+            goto done;
+        }
+        if (EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, entry->nonce) != 1 ||
+            EVP_EncryptUpdate(ctx, cipher, &out_length, plain, (int)length) != 1) {
+            result = -5;
+            goto done;
+        }
+        entry->offset = CHUNKED_HEADER_SIZE + i * chunk_size;
+        entry->length = (uint32_t)length;
+        entry->flags = 0;
+        if (crypto_pwrite_full(output_fd, cipher, (size_t)out_length, (off64_t)entry->offset) != 0) {
+            result = -7;
+            goto done;
+        }
+        written++;
+    }
+
+    header.plaintext_size = plaintext_size;
+    header.chunk_count = chunk_count;
+    if (commit_container(output_fd, &header, entries) != 0) {
+        result = -7;
+        goto done;
+    }
+    result = written;
+
+done:
+    EVP_CIPHER_CTX_free(ctx);
+    free(old_entries);
+    free(entries);
+    crypto_mem_release(plain, chunk_size);
+    crypto_mem_release(cipher, chunk_size);
+    close(input_fd);
+    close(output_fd);
+    return result;
+}
+
+int aes_chunked_sync_file(const char* input_path, const char* output_path, const char* key, uint32_t chunk_size) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = chunked_sync_file(input_path, output_path, key, chunk_size);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
+int crypto_chunked_decrypt_fd(int input_fd, int output_fd, const char* key) {
+    chunked_keys keys;
+    derive_keys(key, &keys);
+
+    chunked_header header;
+    chunked_entry* entries = NULL;
+    int result = read_container(input_fd, &keys, &header, &entries);
+    if (result != 0) {
+        OPENSSL_cleanse(&keys, sizeof(keys));
+        return result;
+    }
+
+    uint32_t max_length = 0;
+    for (uint64_t i = 0; i < header.chunk_count; i++) {
+        if (entries[i].length > max_length) max_length = entries[i].length;
+    }
+
+    size_t buffer_size = max_length ? max_length : 1;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    unsigned char* cipher = (unsigned char*)crypto_mem_acquire(buffer_size);
+    unsigned char* plain = (unsigned char*)crypto_mem_acquire(buffer_size);
+    if (!ctx || !cipher || !plain) {
+        result = -3;
+        goto done;
+    }
+    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, keys.enc_key, NULL) != 1) {
+        result = -4;
+        goto done;
+    }
+
+    for (uint64_t i = 0; i < header.chunk_count; i++) {
+        const chunked_entry* entry = &entries[i];
+        int out_length;
+        if (crypto_pread_full(input_fd, cipher, entry->length, (off64_t)entry->offset) != (ssize_t)entry->length) {
+            result = -1;
+            goto done;
+        }
+        if (EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, entry->nonce) != 1 ||
+            EVP_DecryptUpdate(ctx, plain, &out_length, cipher, (int)entry->length) != 1) {
+            result = -5;
+            goto done;
+        }
+        if (crypto_write_full(output_fd, plain, (size_t)out_length) != 0) {
+            result = -7;
+            goto done;
+        }
+    }
+
+done:
+    OPENSSL_cleanse(&keys, sizeof(keys));
+    EVP_CIPHER_CTX_free(ctx);
+    free(entries);
+    crypto_mem_release(cipher, buffer_size);
+    crypto_mem_release(plain, buffer_size);
+    return result;
+}
+
+int crypto_chunked_decrypt_buffer(int input_fd, const char* key, unsigned char* buffer, size_t capacity, size_t* length) {
+    chunked_keys keys;
+    derive_keys(key, &keys);
+
+    chunked_header header;
+    chunked_entry* entries = NULL;
+    int result = read_container(input_fd, &keys, &header, &entries);
+    if (result == 0 && header.plaintext_size > capacity) {
+        result = -2;
+    }
+
+    EVP_CIPHER_CTX* ctx = NULL;
+    if (result == 0 && !(ctx = EVP_CIPHER_CTX_new())) {
+        result = -3;
+    } else if (result == 0 && EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, keys.enc_key, NULL) != 1) {
+        result = -4;
+    }
+
+    // Each chunk is read straight into its place in the buffer and decrypted there
+    size_t position = 0;
+    for (uint64_t i = 0; result == 0 && i < header.chunk_count; i++) {
+        const chunked_entry* entry = &entries[i];
+        unsigned char* target = buffer + position;
+        int out_length;
+        if (crypto_pread_full(input_fd, target, entry->length, (off64_t)entry->offset) != (ssize_t)entry->length) {
+            result = -1;
+        } else if (EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, entry->nonce) != 1 ||
+                   EVP_DecryptUpdate(ctx, target, &out_length, target, (int)entry->length) != 1) {
+            result = -5;
+        }
+        position += entry->length;
+    }
+    *length = result == 0 ? position : 0;
+
+    OPENSSL_cleanse(&keys, sizeof(keys));
+    EVP_CIPHER_CTX_free(ctx);
+    free(entries);
+    return result;
+}
+
+static int chunked_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    if (input_fd < 0) return -1;
+
+    // Validate the container before creating (and truncating) the output
+    chunked_keys keys;
+    derive_keys(key, &keys);
+    chunked_header header;
+    chunked_entry* entries = NULL;
+    int result = read_container(input_fd, &keys, &header, &entries);
+    OPENSSL_cleanse(&keys, sizeof(keys));
+    free(entries);
+    if (result != 0) {
+        close(input_fd);
+        return result;
+    }
+
+    int output_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (output_fd < 0) {
+        close(input_fd);
+        return -1;
+    }
+
+    result = crypto_chunked_decrypt_fd(input_fd, output_fd, key);
+
+    close(input_fd);
+    close(output_fd);
+    return result;
+}
+
+int aes_chunked_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int result = chunked_decrypt_file(input_path, output_path, key);
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
+int crypto_chunked_verify(int fd, const char* key, int flags, EVP_MD_CTX* digest, aes_verify_report* report) {
+    chunked_keys keys;
+    derive_keys(key, &keys);
+
+    chunked_header header;
+    chunked_entry* entries = NULL;
+    int result = read_container(fd, &keys, &header, &entries);
+    if (result != 0) {
+        OPENSSL_cleanse(&keys, sizeof(keys));
+        return result;
+    }
+
+    size_t buffer_size = header.chunk_size ? header.chunk_size : 1;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(buffer_size);
+    if (!ctx || !buffer) {
+        result = -3;
+    } else if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, keys.enc_key, NULL) != 1) {
+        result = -4;
+    }
+
+    // Plaintext is decrypted in place and discarded after hashing
+    uint64_t position = 0;
+    for (uint64_t i = 0; result == 0 && i < header.chunk_count; i++) {
+        const chunked_entry* entry = &entries[i];
+        unsigned char fingerprint[FINGERPRINT_LENGTH];
+        int out_length;
+        if (entry->length > header.chunk_size) {
+            report->first_bad_offset = (int64_t)position;
+            break;
+        }
+        if (crypto_pread_full(fd, buffer, entry->length, (off64_t)entry->offset) != (ssize_t)entry->length) {
+            result = -1;
+            break;
+        }
+        if (EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, entry->nonce) != 1 ||
+            EVP_DecryptUpdate(ctx, buffer, &out_length, buffer, (int)entry->length) != 1 ||
+            EVP_DigestUpdate(digest, buffer, entry->length) != 1) {
+            result = -5;
+            break;
+        }
+        if (flags & AES_VERIFY_LOW_PRIORITY) {
+            posix_fadvise64(fd, (off64_t)entry->offset, (off64_t)entry->length, POSIX_FADV_DONTNEED);
+        }
+        fingerprint_chunk(&keys, buffer, entry->length, fingerprint);
+        if (CRYPTO_memcmp(fingerprint, entry->fingerprint, FINGERPRINT_LENGTH) != 0) {
+            report->first_bad_offset = (int64_t)position;
+            break;
+        }
+        position += entry->length;
+    }
+    report->bytes_verified = (int64_t)position;
+
+    if (buffer) OPENSSL_cleanse(buffer, buffer_size);
+    OPENSSL_cleanse(&keys, sizeof(keys));
+    EVP_CIPHER_CTX_free(ctx);
+    crypto_mem_release(buffer, buffer_size);
+    free(entries);
+    return result;
+}
+
+int aes_chunked_concat_files(const char* const* input_paths, int count, const char* output_path, const char* key) {
+    if (count < 1) return -1;
+
+    chunked_keys keys;
+    derive_keys(key, &keys);
+
+    int* fds = (int*)malloc((size_t)count * sizeof(int));
+    chunked_header* headers = (chunked_header*)calloc((size_t)count, sizeof(chunked_header));
+    chunked_entry** lists = (chunked_entry**)calloc((size_t)count, sizeof(chunked_entry*));
+    chunked_entry* entries = NULL;
+    int result = fds && headers && lists ? 0 : -3;
+    int opened = 0;
+
+    // Validate every input up front; they must share key and chunk size
+    int in_place = 0;
+    struct stat64 output_stat;
+    int output_exists = stat64(output_path, &output_stat) == 0;
+    uint64_t chunk_count = 0;
+    uint64_t plaintext_size = 0;
+    for (int i = 0; result == 0 && i < count; i++) {
+        struct stat64 st;
+        fds[i] = open(input_paths[i], O_RDONLY | O_CLOEXEC);
+        if (fds[i] < 0) {
+            result = -1;
+            break;
+        }
+        opened++;
+        if (fstat64(fds[i], &st) != 0) {
+            result = -1;
+        } else if (output_exists && same_file(&st, &output_stat)) {
+            // Only the first input may double as the output
+            if (i == 0 && reopen_writable(&fds[0], input_paths[0], &st) == 0) in_place = 1; else result = -1;
+        }
+        if (result == 0) {
+            result = read_container(fds[i], &keys, &headers[i], &lists[i]);
+        }
+        if (result == 0 && headers[i].chunk_size != headers[0].chunk_size) {
+            result = -2;
+        }
+        chunk_count += headers[i].chunk_count;
+        plaintext_size += headers[i].plaintext_size;
+    }
+    if (result == 0 && !(entries = (chunked_entry*)malloc(chunk_count ? chunk_count * sizeof(chunked_entry) : 1))) {
+        result = -3;
+    }
+
+    int output_fd = -1;
+    if (result == 0) {
+        output_fd = in_place ? fds[0] : open(output_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (output_fd < 0) result = -1;
+    }
+
+    // In place the first file's chunks stay put and the rest land over its
+    // old index; otherwise every chunk is copied into a fresh container
+    chunked_header header;
+    uint64_t position = CHUNKED_HEADER_SIZE;
+    uint64_t done_count = 0;
+    if (result == 0) {
+        header = headers[0];
+        header.flags = CHUNKED_FLAG_DIRTY;
+        if (in_place) {
+            memcpy(entries, lists[0], (size_t)headers[0].chunk_count * sizeof(chunked_entry));
+            done_count = headers[0].chunk_count;
+            position = headers[0].index_offset;
+        }
+        if (crypto_pwrite_full(output_fd, &header, sizeof(header), 0) != 0 ||
+            (in_place && crypto_fdatasync(output_fd) != 0)) {
+            result = -7;
+        }
+    }
+    for (int i = in_place ? 1 : 0; result == 0 && i < count; i++) {
+        memcpy(entries + done_count, lists[i], (size_t)headers[i].chunk_count * sizeof(chunked_entry));
+        result = copy_chunks(fds[i], entries + done_count, headers[i].chunk_count, output_fd, &position);
+        done_count += headers[i].chunk_count;
+    }
+    if (result == 0) {
+        header.chunk_count = chunk_count;
+        header.plaintext_size = plaintext_size;
+        result = commit_container(output_fd, &header, entries);
+    }
+
+    // Never leave a broken container behind: drop a new output, or put the
+    // first file's index and header back (its chunks were never touched)
+    if (result != 0 && output_fd >= 0) {
+        if (!in_place) {
+            unlink(output_path);
+        } else {
+            size_t index_size = (size_t)headers[0].chunk_count * sizeof(chunked_entry);
+            if (crypto_pwrite_full(output_fd, lists[0], index_size, (off64_t)headers[0].index_offset) != 0 ||
+                ftruncate64(output_fd, (off64_t)(headers[0].index_offset + index_size)) != 0 ||
+                crypto_fdatasync(output_fd) != 0 ||
+                crypto_pwrite_full(output_fd, &headers[0], sizeof(headers[0]), 0) != 0 ||
+                crypto_fsync(output_fd) != 0) {
+                result = -8;
+            }
+        }
+    }
+
+    if (output_fd >= 0 && !in_place) close(output_fd);
+    for (int i = 0; i < opened; i++) {
+        close(fds[i]);
+        free(lists[i]);
+    }
+    OPENSSL_cleanse(&keys, sizeof(keys));
+    free(fds);
+    free(headers);
+    free(lists);
+    free(entries);
+    return result;
+}
+
+int aes_chunked_trim_file(const char* input_path, const char* output_path, const char* key, int64_t start, int64_t end) {
+    int in_place = output_path == NULL || strcmp(input_path, output_path) == 0;
+    int input_fd = open(input_path, (in_place ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (input_fd < 0) return -1;
+
+    chunked_keys keys;
+    derive_keys(key, &keys);
+    chunked_header header;
+    chunked_entry* entries = NULL;
+    int result = read_container(input_fd, &keys, &header, &entries);
+    OPENSSL_cleanse(&keys, sizeof(keys));
+
+    // Keep every chunk that overlaps [start, end)
+    uint64_t first = 0;
+    uint64_t kept = 0;
+    uint64_t plaintext_size = 0;
+    if (result == 0) {
+        uint64_t range_end = end < 0 || (uint64_t)end > header.plaintext_size ? header.plaintext_size : (uint64_t)end;
+        uint64_t range_start = start < 0 ? 0 : (uint64_t)start;
+        if (range_start > range_end) {
+            result = -1;
+        }
+        uint64_t position = 0;
+        for (uint64_t i = 0; result == 0 && i < header.chunk_count; i++) {
+            uint64_t chunk_end = position + entries[i].length;
+            if (range_start < range_end && chunk_end > range_start && position < range_end) {
+                if (kept == 0) first = i;
+                kept++;
+                plaintext_size += entries[i].length;
+            }
+            position = chunk_end;
+        }
+    }
+
+    int output_fd = -1;
+    if (result == 0) {
+        struct stat64 input_stat, output_stat;
+        if (!in_place && stat64(output_path, &output_stat) == 0 &&
+            fstat64(input_fd, &input_stat) == 0 && same_file(&input_stat, &output_stat)) {
+            in_place = 1;
+            if (reopen_writable(&input_fd, input_path, &input_stat) != 0) result = -1;
+        }
+        if (result == 0) {
+            output_fd = in_place ? input_fd : open(output_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            if (output_fd < 0) result = -1;
+        }
+    }
+
+    if (result == 0) {
+        chunked_header old_header = header;
+        header.flags = CHUNKED_FLAG_DIRTY;
+        header.chunk_count = kept;
+        header.plaintext_size = plaintext_size;
+        uint64_t position = CHUNKED_HEADER_SIZE;
+        if (crypto_pwrite_full(output_fd, &header, sizeof(header), 0) != 0 ||
+            (in_place && crypto_fdatasync(output_fd) != 0)) {
+            result = -7;
+        } else if (!in_place) {
+            result = copy_chunks(input_fd, entries + first, kept, output_fd, &position);
+        }
+        if (result == 0) {
+            result = commit_container(output_fd, &header, entries + first);
+        }
+
+        // Kept chunks never move in place; give the dropped ones in front of
+        // the new index back to the filesystem
+        for (uint64_t i = 0; result == 0 && in_place && i < old_header.chunk_count; i++) {
+            if ((i < first || i >= first + kept) && entries[i].offset < header.index_offset) {
+                uint64_t length = header.index_offset - entries[i].offset;
+                if (length > entries[i].length) length = entries[i].length;
+                fallocate64(output_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                            (off64_t)entries[i].offset, (off64_t)length);
+            }
+        }
+        if (result != 0 && !in_place) {
+            unlink(output_path);
+        }
+    }
+
+    if (output_fd >= 0 && !in_place) close(output_fd);
+    close(input_fd);
+    free(entries);
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef CRYPTO_CHUNKED_H
+#define CRYPTO_CHUNKED_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_CHUNKED_DEFAULT_CHUNK_SIZE (1024 * 1024)
+
+// Chunked container format: the plaintext is split into fixed-size chunks,
+// each encrypted with AES-256-CTR under its own random nonce. An index at the
+// end of the file stores per-chunk offset, length, nonce and a keyed
+// fingerprint (truncated HMAC-SHA256) of the chunk's plaintext.
+
+// Encrypt input_path into output_path in the chunked format. If output_path
+// already holds a chunked file for the same key and chunk size, only chunks
+// whose plaintext fingerprint changed are re-encrypted (with fresh nonces)
+// and rewritten in place. Pass 0 as chunk_size for the default.
+// Returns the number of chunks written (>= 0) or a negative error.
+int aes_chunked_sync_file(const char* input_path, const char* output_path, const char* key, uint32_t chunk_size);
+
+// Decrypt a chunked file. Returns 0 on success, -10 for a wrong key, -11 for
+// a file left dirty by an interrupted sync, trim or concat, -2 for a damaged
+// index and -12 if input_path is not a chunked file.
+int aes_chunked_decrypt_file(const char* input_path, const char* output_path, const char* key);
+
+// Concatenate chunked files encrypted with the same key and chunk size
+// without decrypting anything: ciphertext is copied with copy_file_range and
+// only the index is rebuilt. When output_path is input_paths[0] the others
+// are appended to it in place, and the file is restored if that fails.
+int aes_chunked_concat_files(const char* const* input_paths, int count, const char* output_path, const char* key);
+
+// Keep only the chunks overlapping plaintext range [start, end) (end < 0 for
+// end of file), rounding outward to chunk boundaries; nothing is decrypted.
+// output_path NULL (or equal to input_path) trims in place by rewriting the
+// index and punching holes where dropped chunks were. An interrupted
+// in-place trim leaves a file that is rejected as dirty.
+int aes_chunked_trim_file(const char* input_path, const char* output_path, const char* key, int64_t start, int64_t end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_CHUNKED_H
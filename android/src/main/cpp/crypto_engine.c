@@ -1,19 +1,20 @@
 #include "crypto_engine.h"
+#include "crypto_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
 #include <openssl/evp.h>
 #include <openssl/aes.h>
 #include <openssl/rand.h>
 #include <openssl/err.h>
 #include <openssl/sha.h>
 
-#define BUFFER_SIZE (256 * 1024)  // 256KB buffer for better performance
-#define AES_KEY_LENGTH 32         // AES-256
-#define IV_LENGTH 16              // AES block size
-
 // Prepare 32-byte key from input (matching iOS and Dart implementations)
-static void prepare_key(const char* input_key, unsigned char* output_key) {
+void crypto_prepare_key(const char* input_key, unsigned char* output_key) {
     size_t key_len = strlen(input_key);
     
     if (key_len == AES_KEY_LENGTH) {
@@ -30,7 +31,7 @@ static void prepare_key(const char* input_key, unsigned char* output_key) {
 }
 
 // Prepare 16-byte IV from input string
-static void prepare_iv(const char* input_iv, unsigned char* output_iv) {
+void crypto_prepare_iv(const char* input_iv, unsigned char* output_iv) {
     size_t iv_len = strlen(input_iv);
     
     if (iv_len == IV_LENGTH) {
@@ -48,15 +49,91 @@ static void prepare_iv(const char* input_iv, unsigned char* output_iv) {
     }
 }
 
+// Compute the CTR counter block for a given block index: the IV is treated as
+// a 128-bit big-endian counter, exactly like OpenSSL increments it
+void crypto_ctr_iv_at(const unsigned char* iv, uint64_t block_index, unsigned char* out_iv) {
+    uint64_t carry = block_index;
+    for (int i = IV_LENGTH - 1; i >= 0; i--) {
+        uint64_t sum = (uint64_t)iv[i] + (carry & 0xff);
+        out_iv[i] = (unsigned char)sum;
+        carry = (carry >> 8) + (sum >> 8);
+    }
+}
+
+// Re-arm an already keyed CTR context so the next update starts at the given
+// plaintext offset; the key schedule is kept, only the counter changes
+int crypto_ctr_seek(EVP_CIPHER_CTX* ctx, const unsigned char* iv, uint64_t offset) {
+    unsigned char counter[IV_LENGTH];
+    crypto_ctr_iv_at(iv, offset / AES_BLOCK_SIZE, counter);
+    if (EVP_CipherInit_ex(ctx, NULL, NULL, NULL, counter, -1) != 1) {
+        return -1;
+    }
+
+    // Burn the keystream bytes that precede the offset inside its block
+    unsigned int skip = (unsigned int)(offset % AES_BLOCK_SIZE);
+    if (skip > 0) {
+        unsigned char zeros[AES_BLOCK_SIZE] = {0};
+        unsigned char discard[AES_BLOCK_SIZE];
+        int out_length;
+        if (EVP_CipherUpdate(ctx, discard, &out_length, zeros, (int)skip) != 1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Stream buffers of the stdio paths, from the memory budget; sized by the
+// tuning of the output's filesystem
+static void release_buffers(unsigned char* in_buffer, unsigned char* out_buffer, size_t buffer_size) {
+    crypto_mem_release(in_buffer, buffer_size);
+    crypto_mem_release(out_buffer, buffer_size + AES_BLOCK_SIZE);
+}
+
+int crypto_ctr_stream(EVP_CIPHER_CTX* ctx, int input_fd, int output_fd) {
+    crypto_tuning tuning;
+    crypto_tune_for_fd(output_fd, &tuning);
+    size_t buffer_size = tuning.buffer_size;
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(buffer_size);
+    if (!buffer) return -3;
+
+    // CTR output is the same size as its input, so encrypt in place
+    int result = 0;
+    ssize_t bytes_read;
+    int out_length;
+    while ((bytes_read = crypto_read_full(input_fd, buffer, buffer_size)) > 0) {
+        int64_t started = crypto_stats_clock();
+        CRYPTO_TRACE_BEGIN("aes_crypt");
+        int updated = EVP_CipherUpdate(ctx, buffer, &out_length, buffer, (int)bytes_read) == 1;
+        CRYPTO_TRACE_END();
+        if (!updated) {
+            result = -5;
+            break;
+        }
+        crypto_stats_crypto(started, (size_t)bytes_read);
+        if (crypto_write_full(output_fd, buffer, (size_t)out_length) != 0) {
+            result = -7;
+            break;
+        }
+    }
+    if (result == 0 && bytes_read < 0) {
+        result = -1;
+    }
+
+    crypto_mem_release(buffer, buffer_size);
+    return result;
+}
+
 // Encrypt file using AES-256-CTR
 int aes_encrypt_file(const char* input_path, const char* output_path, const char* key) {
     return aes_encrypt_file_with_iv(input_path, output_path, key, NULL);
 }
 
 // Encrypt file using AES-256-CTR with optional IV
-int aes_encrypt_file_with_iv(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+static int encrypt_file_with_iv(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    CRYPTO_TRACE_BEGIN("aes_open");
     FILE* input_file = fopen(input_path, "rb");
     FILE* output_file = fopen(output_path, "wb");
+    CRYPTO_TRACE_END();
 
     if (!input_file || !output_file) {
         if (input_file) fclose(input_file);
@@ -65,14 +142,15 @@ int aes_encrypt_file_with_iv(const char* input_path, const char* output_path, co
     }
 
     // Prepare 32-byte key
+    CRYPTO_TRACE_BEGIN("aes_key_setup");
     unsigned char prepared_key[AES_KEY_LENGTH];
-    prepare_key(key, prepared_key);
+    crypto_prepare_key(key, prepared_key);
 
     // Prepare or generate IV
     unsigned char iv[IV_LENGTH];
     if (iv_string != NULL && strlen(iv_string) > 0) {
         // Use provided IV string
-        prepare_iv(iv_string, iv);
+        crypto_prepare_iv(iv_string, iv);
     } else {
         // Generate random IV
         if (RAND_bytes(iv, IV_LENGTH) != 1) {
@@ -101,27 +179,57 @@ int aes_encrypt_file_with_iv(const char* input_path, const char* output_path, co
         fclose(output_file);
         return -4;
     }
+    CRYPTO_TRACE_END();
 
     // Encrypt file in chunks
-    unsigned char in_buffer[BUFFER_SIZE];
-    unsigned char out_buffer[BUFFER_SIZE + AES_BLOCK_SIZE];
+    crypto_tuning tuning;
+    crypto_tune_for_fd(fileno(output_file), &tuning);
+    size_t buffer_size = tuning.buffer_size;
+    unsigned char* in_buffer = (unsigned char*)crypto_mem_acquire(buffer_size);
+    unsigned char* out_buffer = (unsigned char*)crypto_mem_acquire(buffer_size + AES_BLOCK_SIZE);
+    if (!in_buffer || !out_buffer) {
+        release_buffers(in_buffer, out_buffer, buffer_size);
+        EVP_CIPHER_CTX_free(ctx);
+        fclose(input_file);
+        fclose(output_file);
+        return -3;
+    }
     int bytes_read;
     int out_length;
     long long total_encrypted = 0;
 
-    while ((bytes_read = fread(in_buffer, 1, BUFFER_SIZE, input_file)) > 0) {
+    CRYPTO_TRACE_BEGIN("aes_read");
+    int64_t started = crypto_stats_clock();
+    while ((bytes_read = fread(in_buffer, 1, buffer_size, input_file)) > 0) {
+        crypto_stats_read(started);
+        CRYPTO_TRACE_END();
+        crypto_sched_io(2 * (size_t)bytes_read);
+        CRYPTO_TRACE_BEGIN("aes_crypt");
+        started = crypto_stats_clock();
         if (EVP_EncryptUpdate(ctx, out_buffer, &out_length, in_buffer, bytes_read) != 1) {
+            release_buffers(in_buffer, out_buffer, buffer_size);
             EVP_CIPHER_CTX_free(ctx);
             fclose(input_file);
             fclose(output_file);
             return -5;
         }
+        crypto_stats_crypto(started, (size_t)bytes_read);
+        CRYPTO_TRACE_END();
+        CRYPTO_TRACE_BEGIN("aes_write");
+        started = crypto_stats_clock();
         fwrite(out_buffer, 1, out_length, output_file);
+        crypto_stats_write(started);
+        CRYPTO_TRACE_END();
         total_encrypted += bytes_read;
+        CRYPTO_TRACE_BEGIN("aes_read");
+        started = crypto_stats_clock();
     }
+    CRYPTO_TRACE_END();
 
     // Finalize encryption
+    CRYPTO_TRACE_BEGIN("aes_final");
     if (EVP_EncryptFinal_ex(ctx, out_buffer, &out_length) != 1) {
+        release_buffers(in_buffer, out_buffer, buffer_size);
         EVP_CIPHER_CTX_free(ctx);
         fclose(input_file);
         fclose(output_file);
@@ -130,17 +238,27 @@ int aes_encrypt_file_with_iv(const char* input_path, const char* output_path, co
     fwrite(out_buffer, 1, out_length, output_file);
 
     // Cleanup
+    release_buffers(in_buffer, out_buffer, buffer_size);
     EVP_CIPHER_CTX_free(ctx);
     fclose(input_file);
     fclose(output_file);
+    CRYPTO_TRACE_END();
 
     return 0; // Success
 }
 
+int aes_encrypt_file_with_iv(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = encrypt_file_with_iv(input_path, output_path, key, iv_string);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
 // Decrypt file using AES-256-CTR
-int aes_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+static int decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    CRYPTO_TRACE_BEGIN("aes_open");
     FILE* input_file = fopen(input_path, "rb");
     FILE* output_file = fopen(output_path, "wb");
+    CRYPTO_TRACE_END();
 
     if (!input_file || !output_file) {
         if (input_file) fclose(input_file);
@@ -148,17 +266,21 @@ int aes_decrypt_file(const char* input_path, const char* output_path, const char
         return -1;
     }
 
-    // Read IV from input file
-    unsigned char iv[IV_LENGTH];
-    if (fread(iv, 1, IV_LENGTH, input_file) != IV_LENGTH) {
+    // Read IV from input file (legacy prefix or AESFILE1 header) and skip to the body
+    crypto_stream_layout layout;
+    int layout_result = crypto_read_stream_layout(fileno(input_file), &layout);
+    if (layout_result != 0 || fseeko(input_file, (off_t)layout.data_offset, SEEK_SET) != 0) {
         fclose(input_file);
         fclose(output_file);
-        return -2;
+        return layout_result != 0 ? layout_result : -2;
     }
+    unsigned char iv[IV_LENGTH];
+    memcpy(iv, layout.iv, IV_LENGTH);
 
     // Prepare 32-byte key
+    CRYPTO_TRACE_BEGIN("aes_key_setup");
     unsigned char prepared_key[AES_KEY_LENGTH];
-    prepare_key(key, prepared_key);
+    crypto_prepare_key(key, prepared_key);
 
     // Setup OpenSSL context
     EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
@@ -176,32 +298,63 @@ int aes_decrypt_file(const char* input_path, const char* output_path, const char
         fclose(output_file);
         return -4;
     }
+    CRYPTO_TRACE_END();
 
     // Decrypt file in chunks
-    unsigned char in_buffer[BUFFER_SIZE];
-    unsigned char out_buffer[BUFFER_SIZE + AES_BLOCK_SIZE];
+    crypto_tuning tuning;
+    crypto_tune_for_fd(fileno(output_file), &tuning);
+    size_t buffer_size = tuning.buffer_size;
+    unsigned char* in_buffer = (unsigned char*)crypto_mem_acquire(buffer_size);
+    unsigned char* out_buffer = (unsigned char*)crypto_mem_acquire(buffer_size + AES_BLOCK_SIZE);
+    if (!in_buffer || !out_buffer) {
+        release_buffers(in_buffer, out_buffer, buffer_size);
+        EVP_CIPHER_CTX_free(ctx);
+        fclose(input_file);
+        fclose(output_file);
+        return -3;
+    }
     int bytes_read;
     int out_length;
     long long total_decrypted = 0;
 
-    while ((bytes_read = fread(in_buffer, 1, BUFFER_SIZE, input_file)) > 0) {
+    CRYPTO_TRACE_BEGIN("aes_read");
+    int64_t started = crypto_stats_clock();
+    while ((bytes_read = fread(in_buffer, 1, buffer_size, input_file)) > 0) {
+        crypto_stats_read(started);
+        CRYPTO_TRACE_END();
+        crypto_sched_io(2 * (size_t)bytes_read);
+        CRYPTO_TRACE_BEGIN("aes_crypt");
+        started = crypto_stats_clock();
         if (EVP_DecryptUpdate(ctx, out_buffer, &out_length, in_buffer, bytes_read) != 1) {
+            release_buffers(in_buffer, out_buffer, buffer_size);
             EVP_CIPHER_CTX_free(ctx);
             fclose(input_file);
             fclose(output_file);
             return -5;
         }
+        crypto_stats_crypto(started, (size_t)bytes_read);
+        CRYPTO_TRACE_END();
+        CRYPTO_TRACE_BEGIN("aes_write");
+        started = crypto_stats_clock();
         if (fwrite(out_buffer, 1, out_length, output_file) != (size_t)out_length) {
+            release_buffers(in_buffer, out_buffer, buffer_size);
             EVP_CIPHER_CTX_free(ctx);
             fclose(input_file);
             fclose(output_file);
             return -7;
         }
+        crypto_stats_write(started);
+        CRYPTO_TRACE_END();
         total_decrypted += bytes_read;
+        CRYPTO_TRACE_BEGIN("aes_read");
+        started = crypto_stats_clock();
     }
+    CRYPTO_TRACE_END();
 
     // Finalize decryption
+    CRYPTO_TRACE_BEGIN("aes_final");
     if (EVP_DecryptFinal_ex(ctx, out_buffer, &out_length) != 1) {
+        release_buffers(in_buffer, out_buffer, buffer_size);
         EVP_CIPHER_CTX_free(ctx);
         fclose(input_file);
         fclose(output_file);
@@ -209,6 +362,7 @@ int aes_decrypt_file(const char* input_path, const char* output_path, const char
     }
     if (out_length > 0) {
         if (fwrite(out_buffer, 1, out_length, output_file) != (size_t)out_length) {
+            release_buffers(in_buffer, out_buffer, buffer_size);
             EVP_CIPHER_CTX_free(ctx);
             fclose(input_file);
             fclose(output_file);
@@ -217,17 +371,27 @@ int aes_decrypt_file(const char* input_path, const char* output_path, const char
     }
 
     // Cleanup
+    release_buffers(in_buffer, out_buffer, buffer_size);
     EVP_CIPHER_CTX_free(ctx);
     fclose(input_file);
     fclose(output_file);
+    CRYPTO_TRACE_END();
 
     return 0; // Success
 }
 
+int aes_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int result = decrypt_file(input_path, output_path, key);
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
 // Decrypt file using AES-256-CTR with custom IV support
-int aes_decrypt_file_with_iv(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+static int decrypt_file_with_iv(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    CRYPTO_TRACE_BEGIN("aes_open");
     FILE* input_file = fopen(input_path, "rb");
     FILE* output_file = fopen(output_path, "wb");
+    CRYPTO_TRACE_END();
 
     if (!input_file || !output_file) {
         if (input_file) fclose(input_file);
@@ -235,29 +399,29 @@ int aes_decrypt_file_with_iv(const char* input_path, const char* output_path, co
         return -1;
     }
 
+    // Locate the stored IV and the body (legacy prefix or AESFILE1 header)
+    crypto_stream_layout layout;
+    int layout_result = crypto_read_stream_layout(fileno(input_file), &layout);
+    if (layout_result != 0 || fseeko(input_file, (off_t)layout.data_offset, SEEK_SET) != 0) {
+        fclose(input_file);
+        fclose(output_file);
+        return layout_result != 0 ? layout_result : -2;
+    }
+
     // Prepare IV
     unsigned char iv[IV_LENGTH];
     if (iv_string != NULL && strlen(iv_string) > 0) {
         // Use provided IV string (for decrypting files encrypted with custom IV)
-        prepare_iv(iv_string, iv);
-        // Skip the IV in the encrypted file since it was written during encryption
-        if (fseek(input_file, IV_LENGTH, SEEK_SET) != 0) {
-            fclose(input_file);
-            fclose(output_file);
-            return -2;
-        }
+        crypto_prepare_iv(iv_string, iv);
     } else {
-        // Read IV from input file (standard behavior)
-        if (fread(iv, 1, IV_LENGTH, input_file) != IV_LENGTH) {
-            fclose(input_file);
-            fclose(output_file);
-            return -2;
-        }
+        // Use the IV stored in the file (standard behavior)
+        memcpy(iv, layout.iv, IV_LENGTH);
     }
 
     // Prepare 32-byte key
+    CRYPTO_TRACE_BEGIN("aes_key_setup");
     unsigned char prepared_key[AES_KEY_LENGTH];
-    prepare_key(key, prepared_key);
+    crypto_prepare_key(key, prepared_key);
 
     // Setup OpenSSL context
     EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
@@ -275,32 +439,63 @@ int aes_decrypt_file_with_iv(const char* input_path, const char* output_path, co
         fclose(output_file);
         return -4;
     }
+    CRYPTO_TRACE_END();
 
     // Decrypt file in chunks
-    unsigned char in_buffer[BUFFER_SIZE];
-    unsigned char out_buffer[BUFFER_SIZE + AES_BLOCK_SIZE];
+    crypto_tuning tuning;
+    crypto_tune_for_fd(fileno(output_file), &tuning);
+    size_t buffer_size = tuning.buffer_size;
+    unsigned char* in_buffer = (unsigned char*)crypto_mem_acquire(buffer_size);
+    unsigned char* out_buffer = (unsigned char*)crypto_mem_acquire(buffer_size + AES_BLOCK_SIZE);
+    if (!in_buffer || !out_buffer) {
+        release_buffers(in_buffer, out_buffer, buffer_size);
+        EVP_CIPHER_CTX_free(ctx);
+        fclose(input_file);
+        fclose(output_file);
+        return -3;
+    }
     int bytes_read;
     int out_length;
     long long total_decrypted = 0;
 
-    while ((bytes_read = fread(in_buffer, 1, BUFFER_SIZE, input_file)) > 0) {
+    CRYPTO_TRACE_BEGIN("aes_read");
+    int64_t started = crypto_stats_clock();
+    while ((bytes_read = fread(in_buffer, 1, buffer_size, input_file)) > 0) {
+        crypto_stats_read(started);
+        CRYPTO_TRACE_END();
+        crypto_sched_io(2 * (size_t)bytes_read);
+        CRYPTO_TRACE_BEGIN("aes_crypt");
+        started = crypto_stats_clock();
         if (EVP_DecryptUpdate(ctx, out_buffer, &out_length, in_buffer, bytes_read) != 1) {
+            release_buffers(in_buffer, out_buffer, buffer_size);
             EVP_CIPHER_CTX_free(ctx);
             fclose(input_file);
             fclose(output_file);
             return -5;
         }
+        crypto_stats_crypto(started, (size_t)bytes_read);
+        CRYPTO_TRACE_END();
+        CRYPTO_TRACE_BEGIN("aes_write");
+        started = crypto_stats_clock();
         if (fwrite(out_buffer, 1, out_length, output_file) != (size_t)out_length) {
+            release_buffers(in_buffer, out_buffer, buffer_size);
             EVP_CIPHER_CTX_free(ctx);
             fclose(input_file);
             fclose(output_file);
             return -7;
         }
+        crypto_stats_write(started);
+        CRYPTO_TRACE_END();
         total_decrypted += bytes_read;
+        CRYPTO_TRACE_BEGIN("aes_read");
+        started = crypto_stats_clock();
     }
+    CRYPTO_TRACE_END();
 
     // Finalize decryption
+    CRYPTO_TRACE_BEGIN("aes_final");
     if (EVP_DecryptFinal_ex(ctx, out_buffer, &out_length) != 1) {
+        release_buffers(in_buffer, out_buffer, buffer_size);
         EVP_CIPHER_CTX_free(ctx);
         fclose(input_file);
         fclose(output_file);
@@ -308,6 +503,7 @@ int aes_decrypt_file_with_iv(const char* input_path, const char* output_path, co
     }
     if (out_length > 0) {
         if (fwrite(out_buffer, 1, out_length, output_file) != (size_t)out_length) {
+            release_buffers(in_buffer, out_buffer, buffer_size);
             EVP_CIPHER_CTX_free(ctx);
             fclose(input_file);
             fclose(output_file);
@@ -316,13 +512,195 @@ int aes_decrypt_file_with_iv(const char* input_path, const char* output_path, co
     }
 
     // Cleanup
+    release_buffers(in_buffer, out_buffer, buffer_size);
     EVP_CIPHER_CTX_free(ctx);
     fclose(input_file);
     fclose(output_file);
+    CRYPTO_TRACE_END();
 
     return 0; // Success
 }
 
+int aes_decrypt_file_with_iv(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int result = decrypt_file_with_iv(input_path, output_path, key, iv_string);
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
+// Encrypt between descriptors owned by the caller
+static int encrypt_fd(int input_fd, int output_fd, const char* key, const char* iv_string) {
+    // Prepare 32-byte key
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+
+    // Prepare or generate IV
+    unsigned char iv[IV_LENGTH];
+    if (iv_string != NULL && strlen(iv_string) > 0) {
+        crypto_prepare_iv(iv_string, iv);
+    } else if (RAND_bytes(iv, IV_LENGTH) != 1) {
+        return -2;
+    }
+
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = NULL;
+    if (crypto_write_full(output_fd, iv, IV_LENGTH) != 0) {
+        result = -7;
+    } else if (!(ctx = EVP_CIPHER_CTX_new())) {
+        result = -3;
+    } else if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, iv) != 1) {
+        result = -4;
+    } else {
+        result = crypto_ctr_stream(ctx, input_fd, output_fd);
+    }
+
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+    EVP_CIPHER_CTX_free(ctx);
+    return result;
+}
+
+int aes_encrypt_fd(int input_fd, int output_fd, const char* key, const char* iv_string) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    off64_t position = lseek64(output_fd, 0, SEEK_CUR);
+    int result = encrypt_fd(input_fd, output_fd, key, iv_string);
+    int64_t written = position < 0 ? 0 : lseek64(output_fd, 0, SEEK_CUR) - position;
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, written, result);
+}
+
+// Decrypt between descriptors owned by the caller
+static int decrypt_fd(int input_fd, int output_fd, const char* key, const char* iv_string) {
+    // IV prefix or AESFILE1 header, read without seeking
+    crypto_stream_layout layout;
+    int result = crypto_read_stream_layout_sequential(input_fd, &layout);
+    if (result != 0) return result;
+
+    unsigned char iv[IV_LENGTH];
+    if (iv_string != NULL && strlen(iv_string) > 0) {
+        crypto_prepare_iv(iv_string, iv);
+    } else {
+        memcpy(iv, layout.iv, IV_LENGTH);
+    }
+
+    // Prepare 32-byte key
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        result = -3;
+    } else if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, iv) != 1) {
+        result = -4;
+    } else {
+        result = crypto_ctr_stream(ctx, input_fd, output_fd);
+    }
+
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+    EVP_CIPHER_CTX_free(ctx);
+    return result;
+}
+
+int aes_decrypt_fd(int input_fd, int output_fd, const char* key, const char* iv_string) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    off64_t position = lseek64(output_fd, 0, SEEK_CUR);
+    int result = decrypt_fd(input_fd, output_fd, key, iv_string);
+    int64_t written = position < 0 ? 0 : lseek64(output_fd, 0, SEEK_CUR) - position;
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, written, result);
+}
+
+// Append to an encrypted file: CTR lets the new plaintext start at counter
+// IV + existing_length / 16, including a partially used trailing block
+static int append_file(const char* encrypted_path, const char* plaintext_path, const char* key, int sync) {
+    int output_fd = open(encrypted_path, O_RDWR | O_CLOEXEC);
+    int input_fd = open(plaintext_path, O_RDONLY | O_CLOEXEC);
+    if (output_fd < 0 || input_fd < 0) {
+        if (output_fd >= 0) close(output_fd);
+        if (input_fd >= 0) close(input_fd);
+        return -1;
+    }
+
+    // Read IV and current length from the encrypted file
+    crypto_stream_layout layout;
+    int layout_result = crypto_read_stream_layout(output_fd, &layout);
+    if (layout_result != 0) {
+        close(output_fd);
+        close(input_fd);
+        return layout_result;
+    }
+    const unsigned char* iv = layout.iv;
+    uint64_t existing_length = layout.body_length;
+    off64_t original_size = layout.data_offset + (off64_t)existing_length;
+
+    // Prepare 32-byte key
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    crypto_tuning tuning;
+    crypto_tune_for_fd(output_fd, &tuning);
+    size_t buffer_size = tuning.buffer_size;
+    unsigned char* in_buffer = (unsigned char*)crypto_mem_acquire(buffer_size);
+    unsigned char* out_buffer = (unsigned char*)crypto_mem_acquire(buffer_size + AES_BLOCK_SIZE);
+    int result = 0;
+    if (!ctx || !in_buffer || !out_buffer) {
+        result = -3;
+    } else if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, iv) != 1 ||
+               crypto_ctr_seek(ctx, iv, existing_length) != 0) {
+        result = -4;
+    }
+
+    // Encrypt new data in chunks and write it after the existing ciphertext
+    off64_t position = original_size;
+    ssize_t bytes_read = 0;
+    int out_length;
+    while (result == 0 && (bytes_read = crypto_read_full(input_fd, in_buffer, buffer_size)) > 0) {
+        int64_t started = crypto_stats_clock();
+        CRYPTO_TRACE_BEGIN("aes_crypt");
+        int updated = EVP_EncryptUpdate(ctx, out_buffer, &out_length, in_buffer, (int)bytes_read) == 1;
+        CRYPTO_TRACE_END();
+        if (!updated) {
+            result = -5;
+            break;
+        }
+        crypto_stats_crypto(started, (size_t)bytes_read);
+        if (crypto_pwrite_full(output_fd, out_buffer, (size_t)out_length, position) != 0) {
+            result = -7;
+        }
+        position += out_length;
+    }
+    if (result == 0 && bytes_read < 0) {
+        result = -1;
+    }
+    if (result == 0 && layout.has_header &&
+        crypto_header_set_length(output_fd, (uint64_t)(position - layout.data_offset)) != 0) {
+        result = -7;
+    }
+    if (result == 0 && sync && crypto_fdatasync(output_fd) != 0) {
+        result = -7;
+    }
+
+    // Never leave a half-appended tail behind
+    if (result != 0) {
+        if (ftruncate64(output_fd, original_size) != 0 ||
+            (layout.has_header && crypto_header_set_length(output_fd, existing_length) != 0)) {
+            result = -8;
+        }
+    }
+
+    // Cleanup
+    EVP_CIPHER_CTX_free(ctx);
+    crypto_mem_release(in_buffer, buffer_size);
+    crypto_mem_release(out_buffer, buffer_size + AES_BLOCK_SIZE);
+    close(input_fd);
+    close(output_fd);
+
+    return result;
+}
+
+int aes_append_file(const char* encrypted_path, const char* plaintext_path, const char* key, int sync) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_APPEND);
+    int result = append_file(encrypted_path, plaintext_path, key, sync);
+    return crypto_metrics_end(AES_METRIC_APPEND, started, crypto_metrics_file_size(plaintext_path), result);
+}
+
 // Encrypt data in memory
 char* aes_encrypt_data(const char* input, size_t input_len, const char* key, size_t* output_len) {
     EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
@@ -330,7 +708,7 @@ char* aes_encrypt_data(const char* input, size_t input_len, const char* key, siz
 
     // Prepare 32-byte key
     unsigned char prepared_key[AES_KEY_LENGTH];
-    prepare_key(key, prepared_key);
+    crypto_prepare_key(key, prepared_key);
 
     unsigned char iv[IV_LENGTH];
     RAND_bytes(iv, IV_LENGTH);
@@ -385,12 +763,9 @@ void free_buffer(char* buffer) {
 
 // Get file size
 long long get_file_size(const char* filename) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) return -1;
-
-    fseek(file, 0, SEEK_END);
-    long long size = ftell(file);
-    fclose(file);
+    // stat64 keeps sizes above 2GB intact on 32-bit ABIs (ftell returns a long)
+    struct stat64 st;
+    if (stat64(filename, &st) != 0) return -1;
 
-    return size;
+    return (long long)st.st_size;
 }
\ No newline at end of file
@@ -14,6 +14,18 @@ int aes_encrypt_file_with_iv(const char* input_path, const char* output_path, co
 int aes_decrypt_file(const char* input_path, const char* output_path, const char* key);
 int aes_decrypt_file_with_iv(const char* input_path, const char* output_path, const char* key, const char* iv_string);
 
+// Encrypt / decrypt between caller-owned descriptors, e.g. from an Android
+// ParcelFileDescriptor. Neither fd is closed and both are used strictly
+// sequentially from their current position, so pipes work too. The format
+// is that of aes_encrypt_file_with_iv; decryption also accepts AESFILE1.
+int aes_encrypt_fd(int input_fd, int output_fd, const char* key, const char* iv_string);
+int aes_decrypt_fd(int input_fd, int output_fd, const char* key, const char* iv_string);
+
+// Append plaintext_path to an existing encrypted file, continuing the CTR
+// keystream at the current end (no re-encryption of existing data).
+// With sync != 0 the appended data is flushed to storage before returning.
+int aes_append_file(const char* encrypted_path, const char* plaintext_path, const char* key, int sync);
+
 char* aes_encrypt_data(const char* input, size_t input_len, const char* key, size_t* output_len);
 char* aes_decrypt_data(const char* input, size_t input_len, const char* key, size_t* output_len);
 
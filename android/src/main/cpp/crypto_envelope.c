@@ -0,0 +1,210 @@
+#include "crypto_envelope.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define ENVELOPE_VERSION 1
+#define WRAPPED_KEY_LENGTH (AES_KEY_LENGTH + 8)  // RFC 3394 adds one 64-bit block
+
+static const char ENVELOPE_MAGIC[8] = { 'A', 'E', 'S', 'E', 'N', 'V', '0', '1' };
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    unsigned char wrapped_key[WRAPPED_KEY_LENGTH];
+    unsigned char iv[IV_LENGTH];
+} envelope_header;
+
+_Static_assert(sizeof(envelope_header) == 72, "envelope header layout");
+
+// AES-256 key wrap / unwrap of a 32-byte data key under the prepared user key
+static int wrap_key(const unsigned char* kek, const unsigned char* data_key, unsigned char* wrapped, int encrypt) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return -3;
+    EVP_CIPHER_CTX_set_flags(ctx, EVP_CIPHER_CTX_FLAG_WRAP_ALLOW);
+
+    int out_length = 0;
+    int final_length = 0;
+    int expected = encrypt ? WRAPPED_KEY_LENGTH : AES_KEY_LENGTH;
+    int ok = EVP_CipherInit_ex(ctx, EVP_aes_256_wrap(), NULL, kek, NULL, encrypt) == 1 &&
+             EVP_CipherUpdate(ctx, wrapped, &out_length, data_key,
+                              encrypt ? AES_KEY_LENGTH : WRAPPED_KEY_LENGTH) == 1 &&
+             EVP_CipherFinal_ex(ctx, wrapped + out_length, &final_length) == 1 &&
+             out_length + final_length == expected;
+    EVP_CIPHER_CTX_free(ctx);
+    return ok ? 0 : encrypt ? -4 : -10;
+}
+
+int crypto_envelope_probe(const unsigned char* head, size_t length, aes_file_metadata* info) {
+    if (length < sizeof(ENVELOPE_MAGIC) || memcmp(head, ENVELOPE_MAGIC, sizeof(ENVELOPE_MAGIC)) != 0) {
+        return -1;
+    }
+    info->format = AES_FILE_FORMAT_ENVELOPE;
+    info->algorithm = AES_ALGORITHM_AES_256_CTR;
+    info->header_size = sizeof(envelope_header);
+    if (length >= sizeof(envelope_header)) {
+        envelope_header header;
+        memcpy(&header, head, sizeof(header));
+        info->version = header.version;
+        if (info->file_size >= (int64_t)sizeof(header)) {
+            info->plaintext_size = info->file_size - (int64_t)sizeof(header);
+        }
+        info->has_iv = 1;
+        memcpy(info->iv, header.iv, IV_LENGTH);
+    }
+    return 0;
+}
+
+static int read_header(int fd, envelope_header* header) {
+    if (crypto_pread_full(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header)) return -2;
+    if (memcmp(header->magic, ENVELOPE_MAGIC, sizeof(ENVELOPE_MAGIC)) != 0) return -12;
+    if (header->version != ENVELOPE_VERSION) return -2;
+    return 0;
+}
+
+int crypto_envelope_unwrap(int fd, const char* key, unsigned char* data_key, unsigned char* iv, off64_t* data_offset) {
+    unsigned char kek[AES_KEY_LENGTH];
+    envelope_header header;
+    crypto_prepare_key(key, kek);
+    int result = read_header(fd, &header);
+    if (result == 0) {
+        result = wrap_key(kek, header.wrapped_key, data_key, 0);
+    }
+    OPENSSL_cleanse(kek, sizeof(kek));
+    if (result == 0) {
+        memcpy(iv, header.iv, IV_LENGTH);
+        *data_offset = (off64_t)sizeof(header);
+    }
+    return result;
+}
+
+static int envelope_encrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    int output_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (input_fd < 0 || output_fd < 0) {
+        if (input_fd >= 0) close(input_fd);
+        if (output_fd >= 0) close(output_fd);
+        return -1;
+    }
+
+    // Random data key and IV; only the wrapped data key is stored
+    unsigned char kek[AES_KEY_LENGTH];
+    unsigned char data_key[AES_KEY_LENGTH];
+    envelope_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ENVELOPE_MAGIC, sizeof(ENVELOPE_MAGIC));
+    header.version = ENVELOPE_VERSION;
+    crypto_prepare_key(key, kek);
+
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = NULL;
+    if (RAND_bytes(data_key, AES_KEY_LENGTH) != 1 || RAND_bytes(header.iv, IV_LENGTH) != 1) {
+        result = -2;
+    } else if (wrap_key(kek, data_key, header.wrapped_key, 1) != 0) {
+        result = -4;
+    } else if (crypto_write_full(output_fd, &header, sizeof(header)) != 0) {
+        result = -7;
+    } else if (!(ctx = EVP_CIPHER_CTX_new())) {
+        result = -3;
+    } else if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, data_key, header.iv) != 1) {
+        result = -4;
+    } else {
+        result = crypto_ctr_stream(ctx, input_fd, output_fd);
+    }
+
+    OPENSSL_cleanse(data_key, sizeof(data_key));
+    OPENSSL_cleanse(kek, sizeof(kek));
+    EVP_CIPHER_CTX_free(ctx);
+    close(input_fd);
+    close(output_fd);
+    return result;
+}
+
+int aes_envelope_encrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = envelope_encrypt_file(input_path, output_path, key);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
+static int envelope_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    if (input_fd < 0) return -1;
+
+    // Unwrapping fails (integrity check of the key wrap) for a wrong key
+    unsigned char data_key[AES_KEY_LENGTH];
+    unsigned char iv[IV_LENGTH];
+    off64_t data_offset;
+    int result = crypto_envelope_unwrap(input_fd, key, data_key, iv, &data_offset);
+    if (result != 0) {
+        close(input_fd);
+        return result;
+    }
+
+    int output_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    EVP_CIPHER_CTX* ctx = NULL;
+    if (output_fd < 0 || lseek64(input_fd, data_offset, SEEK_SET) < 0) {
+        result = -1;
+    } else if (!(ctx = EVP_CIPHER_CTX_new())) {
+        result = -3;
+    } else if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, data_key, iv) != 1) {
+        result = -4;
+    } else {
+        result = crypto_ctr_stream(ctx, input_fd, output_fd);
+    }
+
+    OPENSSL_cleanse(data_key, sizeof(data_key));
+    EVP_CIPHER_CTX_free(ctx);
+    close(input_fd);
+    if (output_fd >= 0) close(output_fd);
+    return result;
+}
+
+int aes_envelope_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int result = envelope_decrypt_file(input_path, output_path, key);
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
+static int envelope_rewrap(const char* path, const char* old_key, const char* new_key) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    unsigned char old_kek[AES_KEY_LENGTH];
+    unsigned char new_kek[AES_KEY_LENGTH];
+    unsigned char data_key[AES_KEY_LENGTH];
+    envelope_header header;
+    crypto_prepare_key(old_key, old_kek);
+    crypto_prepare_key(new_key, new_kek);
+
+    int result = read_header(fd, &header);
+    if (result == 0) {
+        result = wrap_key(old_kek, header.wrapped_key, data_key, 0);
+    }
+    if (result == 0 && wrap_key(new_kek, data_key, header.wrapped_key, 1) != 0) {
+        result = -4;
+    }
+    // Only the wrapped key field changes; the content is untouched
+    if (result == 0 &&
+        (crypto_pwrite_full(fd, header.wrapped_key, WRAPPED_KEY_LENGTH,
+                            (off64_t)offsetof(envelope_header, wrapped_key)) != 0 ||
+         crypto_fdatasync(fd) != 0)) {
+        result = -7;
+    }
+
+    OPENSSL_cleanse(data_key, sizeof(data_key));
+    OPENSSL_cleanse(old_kek, sizeof(old_kek));
+    OPENSSL_cleanse(new_kek, sizeof(new_kek));
+    close(fd);
+    return result;
+}
+
+int aes_envelope_rewrap(const char* path, const char* old_key, const char* new_key) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_REKEY);
+    int result = envelope_rewrap(path, old_key, new_key);
+    return crypto_metrics_end(AES_METRIC_REKEY, started, 0, result);
+}
@@ -0,0 +1,24 @@
+#ifndef CRYPTO_ENVELOPE_H
+#define CRYPTO_ENVELOPE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Envelope format: the content is encrypted with AES-256-CTR under a random
+// per-file data key, and only that data key is encrypted with the user key
+// (AES-256 key wrap, RFC 3394) in the header. Changing the user key then
+// means re-wrapping a 40-byte field instead of re-encrypting the content.
+
+int aes_envelope_encrypt_file(const char* input_path, const char* output_path, const char* key);
+int aes_envelope_decrypt_file(const char* input_path, const char* output_path, const char* key);
+
+// Re-wrap the data key of an envelope file from old_key to new_key in place.
+// Only the header is rewritten. Returns -10 if old_key does not unwrap it.
+int aes_envelope_rewrap(const char* path, const char* old_key, const char* new_key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_ENVELOPE_H
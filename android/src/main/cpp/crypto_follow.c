@@ -0,0 +1,236 @@
+#include "crypto_follow.h"
+#include "crypto_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define FOLLOW_CHUNK_SIZE (1024 * 1024)
+#define FOLLOW_POLL_MS 250           // Growth check interval without inotify
+#define FOLLOW_INOTIFY_POLL_MS 2000  // Safety net when inotify misses writes (FUSE)
+
+struct aes_follow {
+    pthread_t thread;
+    int input_fd;
+    int output_fd;
+    int inotify_fd;
+    int wake_fds[2];        // finish() writes here to interrupt the wait
+    int flags;
+
+    EVP_CIPHER_CTX* ctx;
+    unsigned char iv[IV_LENGTH];
+    off64_t data_offset;
+    unsigned char* buffer;
+
+    _Atomic int64_t encrypted;
+    atomic_int stop;
+    int result;
+};
+
+// Encrypt plaintext [position, position + length) into the output
+static int encrypt_range(aes_follow* follow, uint64_t position, size_t length) {
+    ssize_t bytes_read = crypto_pread_full(follow->input_fd, follow->buffer, length, (off64_t)position);
+    if (bytes_read < 0) return -1;
+
+    int out_length;
+    if (crypto_ctr_seek(follow->ctx, follow->iv, position) != 0 ||
+        EVP_EncryptUpdate(follow->ctx, follow->buffer, &out_length, follow->buffer, (int)bytes_read) != 1) {
+        return -5;
+    }
+    if (crypto_pwrite_full(follow->output_fd, follow->buffer, (size_t)out_length,
+                           follow->data_offset + (off64_t)position) != 0) {
+        return -7;
+    }
+    return 0;
+}
+
+// The AESFILE1 header (length filled in on finish) or the legacy IV prefix
+static int write_preamble(aes_follow* follow) {
+    if (follow->flags & AES_FOLLOW_HEADER) {
+        unsigned char header[AES_FILE_HEADER_SIZE];
+        crypto_header_init(header, 0, follow->iv);
+        follow->data_offset = AES_FILE_HEADER_SIZE;
+        return crypto_pwrite_full(follow->output_fd, header, sizeof(header), 0);
+    }
+    follow->data_offset = IV_LENGTH;
+    return crypto_pwrite_full(follow->output_fd, follow->iv, IV_LENGTH, 0);
+}
+
+// The writer truncated the file, so ciphertext already written may be for
+// bytes it will write differently. Encrypting the new bytes at the same
+// counter positions would let anyone holding both versions XOR out the
+// plaintext: start the output over under a fresh IV instead.
+static int restart_output(aes_follow* follow) {
+    if (RAND_bytes(follow->iv, IV_LENGTH) != 1) return -4;
+    if (ftruncate64(follow->output_fd, 0) != 0 || write_preamble(follow) != 0) return -7;
+    return 0;
+}
+
+static int current_size(aes_follow* follow, uint64_t* size) {
+    struct stat64 st;
+    if (fstat64(follow->input_fd, &st) != 0) return -1;
+    *size = (uint64_t)st.st_size;
+    return 0;
+}
+
+// Wait for growth, a finish request or the writer closing the file.
+// Returns 1 when the writer closed the file.
+static int wait_for_change(aes_follow* follow) {
+    struct pollfd fds[2];
+    int count = 0;
+    fds[count].fd = follow->wake_fds[0];
+    fds[count++].events = POLLIN;
+    if (follow->inotify_fd >= 0) {
+        fds[count].fd = follow->inotify_fd;
+        fds[count++].events = POLLIN;
+    }
+
+    int timeout = follow->inotify_fd >= 0 ? FOLLOW_INOTIFY_POLL_MS : FOLLOW_POLL_MS;
+    if (poll(fds, (nfds_t)count, timeout) <= 0 || count < 2 || !(fds[1].revents & POLLIN)) {
+        return 0;
+    }
+
+    int closed = 0;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length = read(follow->inotify_fd, events, sizeof(events));
+    for (ssize_t offset = 0; offset < length;) {
+        const struct inotify_event* event = (const struct inotify_event*)(events + offset);
+        if (event->mask & IN_CLOSE_WRITE) closed = 1;
+        offset += (ssize_t)sizeof(struct inotify_event) + event->len;
+    }
+    return closed;
+}
+
+static void* follow_thread(void* arg) {
+    aes_follow* follow = (aes_follow*)arg;
+    int result = 0;
+    uint64_t size = 0;
+
+    // Encrypt complete chunks past the head as the writer produces them. The
+    // head may still be patched, so it is encrypted once, on finish: every
+    // counter position is used for one plaintext only.
+    uint64_t done = AES_FOLLOW_HEAD_REWRITE;
+    while (result == 0 && !atomic_load(&follow->stop)) {
+        if (current_size(follow, &size) != 0) {
+            result = -1;
+            break;
+        }
+        if (size < done && done > AES_FOLLOW_HEAD_REWRITE) {
+            result = restart_output(follow);
+            done = AES_FOLLOW_HEAD_REWRITE;
+        }
+        while (result == 0 && size > done && size - done >= FOLLOW_CHUNK_SIZE && !atomic_load(&follow->stop)) {
+            result = encrypt_range(follow, done, FOLLOW_CHUNK_SIZE);
+            done += FOLLOW_CHUNK_SIZE;
+        }
+        atomic_store(&follow->encrypted, (int64_t)(done - AES_FOLLOW_HEAD_REWRITE));
+
+        if (result == 0 && wait_for_change(follow) && (follow->flags & AES_FOLLOW_FINISH_ON_CLOSE)) {
+            break;
+        }
+    }
+
+    // Finalize: the tail, then the head as the writer left it on stop
+    if (result == 0 && current_size(follow, &size) != 0) {
+        result = -1;
+    }
+    if (result == 0 && size < done && done > AES_FOLLOW_HEAD_REWRITE) {
+        result = restart_output(follow);
+        done = AES_FOLLOW_HEAD_REWRITE;
+    }
+    while (result == 0 && done < size) {
+        size_t length = size - done < FOLLOW_CHUNK_SIZE ? (size_t)(size - done) : FOLLOW_CHUNK_SIZE;
+        result = encrypt_range(follow, done, length);
+        done += length;
+    }
+    uint64_t head = size < AES_FOLLOW_HEAD_REWRITE ? size : AES_FOLLOW_HEAD_REWRITE;
+    for (uint64_t position = 0; result == 0 && position < head; position += FOLLOW_CHUNK_SIZE) {
+        size_t length = head - position < FOLLOW_CHUNK_SIZE ? (size_t)(head - position) : FOLLOW_CHUNK_SIZE;
+        result = encrypt_range(follow, position, length);
+    }
+    if (result == 0) {
+        atomic_store(&follow->encrypted, (int64_t)size);
+        if (ftruncate64(follow->output_fd, follow->data_offset + (off64_t)size) != 0 ||
+            ((follow->flags & AES_FOLLOW_HEADER) && crypto_header_set_length(follow->output_fd, size) != 0) ||
+            crypto_fsync(follow->output_fd) != 0) {
+            result = -7;
+        }
+    }
+
+    follow->result = result;
+    return NULL;
+}
+
+static void free_follow(aes_follow* follow) {
+    if (follow->ctx) EVP_CIPHER_CTX_free(follow->ctx);
+    if (follow->buffer) {
+        OPENSSL_cleanse(follow->buffer, FOLLOW_CHUNK_SIZE);
+        crypto_mem_release_shared(follow->buffer, FOLLOW_CHUNK_SIZE);
+    }
+    if (follow->input_fd >= 0) close(follow->input_fd);
+    if (follow->output_fd >= 0) close(follow->output_fd);
+    if (follow->inotify_fd >= 0) close(follow->inotify_fd);
+    if (follow->wake_fds[0] >= 0) close(follow->wake_fds[0]);
+    if (follow->wake_fds[1] >= 0) close(follow->wake_fds[1]);
+    free(follow);
+}
+
+aes_follow* aes_follow_start(const char* input_path, const char* output_path, const char* key, int flags) {
+    aes_follow* follow = (aes_follow*)calloc(1, sizeof(aes_follow));
+    if (!follow) return NULL;
+    follow->flags = flags;
+    follow->wake_fds[0] = follow->wake_fds[1] = -1;
+    follow->input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    follow->output_fd = open(output_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+    // inotify is an optimisation only; without it growth is polled
+    follow->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (follow->inotify_fd >= 0 &&
+        inotify_add_watch(follow->inotify_fd, input_path, IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+        close(follow->inotify_fd);
+        follow->inotify_fd = -1;
+    }
+
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+    follow->ctx = EVP_CIPHER_CTX_new();
+    follow->buffer = (unsigned char*)crypto_mem_acquire_shared(FOLLOW_CHUNK_SIZE, 1);
+    int ok = follow->input_fd >= 0 && follow->output_fd >= 0 && follow->ctx && follow->buffer &&
+             pipe2(follow->wake_fds, O_CLOEXEC | O_NONBLOCK) == 0 &&
+             RAND_bytes(follow->iv, IV_LENGTH) == 1 &&
+             EVP_EncryptInit_ex(follow->ctx, EVP_aes_256_ctr(), NULL, prepared_key, follow->iv) == 1;
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+
+    ok = ok && write_preamble(follow) == 0;
+
+    if (!ok || pthread_create(&follow->thread, NULL, follow_thread, follow) != 0) {
+        free_follow(follow);
+        return NULL;
+    }
+    return follow;
+}
+
+int64_t aes_follow_progress(aes_follow* follow) {
+    return atomic_load(&follow->encrypted);
+}
+
+int aes_follow_finish(aes_follow* follow) {
+    atomic_store(&follow->stop, 1);
+    char wake = 1;
+    while (write(follow->wake_fds[1], &wake, 1) < 0 && errno == EINTR) {
+    }
+    pthread_join(follow->thread, NULL);
+
+    int result = follow->result;
+    free_follow(follow);
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef CRYPTO_FOLLOW_H
+#define CRYPTO_FOLLOW_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Follow mode: encrypt a file while another writer is still appending to it
+// (e.g. a camera recording). A background thread waits for growth (inotify,
+// with a polling fallback) and encrypts each 1MB chunk as soon as it is
+// complete, so finishing only has to encrypt the tail.
+
+#define AES_FOLLOW_HEADER 1           // Write the AESFILE1 layout instead of the legacy one
+#define AES_FOLLOW_FINISH_ON_CLOSE 2  // Finalize by itself when the writer closes the file
+
+// Bytes at the start of the file that are re-encrypted on finish, because
+// container muxers patch their headers there when recording stops (MP4
+// mdat size, moov written into reserved space)
+#define AES_FOLLOW_HEAD_REWRITE (4 * 1024 * 1024)
+
+typedef struct aes_follow aes_follow;
+
+aes_follow* aes_follow_start(const char* input_path, const char* output_path, const char* key, int flags);
+
+// Plaintext bytes encrypted so far
+int64_t aes_follow_progress(aes_follow* follow);
+
+// Finalize (unless already finalized on close), wait for the background
+// thread and release the follower. Returns 0 or the first error.
+int aes_follow_finish(aes_follow* follow);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_FOLLOW_H
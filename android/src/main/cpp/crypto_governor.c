@@ -0,0 +1,270 @@
+#include "crypto_governor.h"
+#include "crypto_internal.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+
+#define DEFAULT_MIN_BUDGET (16LL * 1024 * 1024)
+#define DEFAULT_MAX_BUDGET (256LL * 1024 * 1024)
+#define POOL_GRANULE (64 * 1024)  // Pooled size classes are multiples of this, plus slack
+#define POOL_MAX_BLOCKS 8
+#define PRESSURE_NS (30 * 1000000000LL)  // Budget stays halved this long after a complete trim
+// Longest wait for memory. Past it the reservation goes over budget, in
+// case the memory waited for is held by a thread waiting on this one
+#define MAX_WAIT_NS (2 * 1000000000LL)
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t released = PTHREAD_COND_INITIALIZER;
+static int64_t budget;
+static int64_t in_use;
+static int64_t pooled;
+static int64_t peak;
+static int64_t waits;
+static int64_t pressure_until;
+static void* pool[POOL_MAX_BLOCKS];
+static size_t pool_sizes[POOL_MAX_BLOCKS];
+static int pool_count;
+
+// Registered caches; trimmed with this lock held
+static pthread_mutex_t caches_lock = PTHREAD_MUTEX_INITIALIZER;
+static crypto_cache* caches;
+
+// Operation buffers this thread got from crypto_mem_acquire and still holds.
+// Only a thread holding none waits: an operation is admitted at its first
+// buffer, and two operations each holding one and waiting for a second can't
+// deadlock. Its remaining buffers may overshoot the budget briefly. Shared
+// blocks (caches, readers, follow sessions) outlive the call that made them
+// and may be freed on another thread, so they are not counted here.
+static __thread int held;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t default_budget(void) {
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    int64_t bytes = pages > 0 && page_size > 0 ? (int64_t)pages * page_size / 32 : 0;
+    if (bytes < DEFAULT_MIN_BUDGET) bytes = DEFAULT_MIN_BUDGET;
+    if (bytes > DEFAULT_MAX_BUDGET) bytes = DEFAULT_MAX_BUDGET;
+    return bytes;
+}
+
+// Callers hold lock
+static int64_t current_budget(void) {
+    if (budget == 0) budget = default_budget();
+    return pressure_until > now_ns() ? budget / 2 : budget;
+}
+
+static void note_peak(void) {
+    if (in_use + pooled > peak) peak = in_use + pooled;
+}
+
+// I/O buffers (whatever buffer size is tuned) are rounded up to a multiple
+// of POOL_GRANULE, with room for a cipher block on top, so an in and an out
+// buffer share a class and can be pooled; smaller requests are not pooled
+static int poolable(size_t size) {
+    return size >= POOL_GRANULE;
+}
+
+static size_t block_size(size_t size) {
+    if (!poolable(size)) return size;
+    size_t body = size > EVP_MAX_BLOCK_LENGTH ? size - EVP_MAX_BLOCK_LENGTH : 0;
+    return (body + POOL_GRANULE - 1) / POOL_GRANULE * POOL_GRANULE + EVP_MAX_BLOCK_LENGTH;
+}
+
+// Remove entry index, keeping the rest oldest first
+static void* take_pool_entry(int index) {
+    void* block = pool[index];
+    pooled -= (int64_t)pool_sizes[index];
+    pool_count--;
+    memmove(&pool[index], &pool[index + 1], (size_t)(pool_count - index) * sizeof(pool[0]));
+    memmove(&pool_sizes[index], &pool_sizes[index + 1], (size_t)(pool_count - index) * sizeof(pool_sizes[0]));
+    return block;
+}
+
+static void drop_pool(void) {
+    while (pool_count > 0) {
+        free(take_pool_entry(pool_count - 1));
+    }
+}
+
+// wait = 0 when called under pressure from an operation that may hold a
+// cache's lock: busy caches are skipped instead of waited for
+static void trim_caches(int wait) {
+    if (wait) {
+        pthread_mutex_lock(&caches_lock);
+    } else if (pthread_mutex_trylock(&caches_lock) != 0) {
+        return;
+    }
+    for (crypto_cache* cache = caches; cache; cache = cache->next) {
+        cache->trim(cache, wait);
+    }
+    pthread_mutex_unlock(&caches_lock);
+}
+
+static void* reserve(size_t size, int wait) {
+    int64_t bytes = (int64_t)block_size(size);
+
+    pthread_mutex_lock(&lock);
+    for (int i = pool_count - 1; poolable(size) && i >= 0; i--) {
+        if (pool_sizes[i] != (size_t)bytes) continue;
+        void* block = take_pool_entry(i);
+        in_use += bytes;
+        pthread_mutex_unlock(&lock);
+        return block;
+    }
+
+    int trimmed = 0;
+    int waited = 0;
+    struct timespec deadline;
+    // A lone reservation always goes through, however large
+    while (in_use > 0 && in_use + pooled + bytes > current_budget()) {
+        if (pool_count > 0) {
+            drop_pool();
+            continue;
+        }
+        if (!trimmed) {
+            trimmed = 1;
+            pthread_mutex_unlock(&lock);
+            trim_caches(0);
+            pthread_mutex_lock(&lock);
+            continue;
+        }
+        if (!wait) {
+            pthread_mutex_unlock(&lock);
+            return NULL;
+        }
+        if (held > 0) break;
+        if (!waited) {
+            waited = 1;
+            waits++;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += MAX_WAIT_NS / 1000000000LL;
+        }
+        if (pthread_cond_timedwait(&released, &lock, &deadline) == ETIMEDOUT) break;
+    }
+    in_use += bytes;
+    note_peak();
+    pthread_mutex_unlock(&lock);
+
+    void* block = malloc((size_t)bytes);
+    if (!block) {
+        pthread_mutex_lock(&lock);
+        in_use -= bytes;
+        pthread_cond_broadcast(&released);
+        pthread_mutex_unlock(&lock);
+    }
+    return block;
+}
+
+void* crypto_mem_acquire(size_t size) {
+    void* block = reserve(size, 1);
+    if (block) held++;
+    return block;
+}
+
+void* crypto_mem_acquire_shared(size_t size, int wait) {
+    return reserve(size, wait);
+}
+
+static void give_back(void* block, size_t size) {
+    int64_t bytes = (int64_t)block_size(size);
+    // Pooled blocks may have held plaintext or key material
+    if (poolable(size)) OPENSSL_cleanse(block, (size_t)bytes);
+
+    pthread_mutex_lock(&lock);
+    in_use -= bytes;
+    if (poolable(size) && pressure_until <= now_ns()) {
+        // A full pool gives up its oldest entry, so blocks of a size no
+        // longer in use (after retuning) age out
+        if (pool_count == POOL_MAX_BLOCKS) free(take_pool_entry(0));
+        if (in_use + pooled + bytes <= current_budget()) {
+            pool[pool_count] = block;
+            pool_sizes[pool_count] = (size_t)bytes;
+            pool_count++;
+            pooled += bytes;
+            block = NULL;
+        }
+    }
+    pthread_cond_broadcast(&released);
+    pthread_mutex_unlock(&lock);
+    free(block);
+}
+
+void crypto_mem_release(void* block, size_t size) {
+    if (!block) return;
+    if (held > 0) held--;
+    give_back(block, size);
+}
+
+void crypto_mem_release_shared(void* block, size_t size) {
+    if (block) give_back(block, size);
+}
+
+int crypto_mem_threads(int threads, size_t per_thread) {
+    pthread_mutex_lock(&lock);
+    int64_t available = current_budget() - in_use;
+    pthread_mutex_unlock(&lock);
+    int64_t fit = per_thread > 0 ? available / (int64_t)per_thread : threads;
+    if (fit < threads) threads = (int)fit;
+    return threads < 1 ? 1 : threads;
+}
+
+void crypto_mem_register(crypto_cache* cache) {
+    pthread_mutex_lock(&caches_lock);
+    cache->prev = NULL;
+    cache->next = caches;
+    if (caches) caches->prev = cache;
+    caches = cache;
+    pthread_mutex_unlock(&caches_lock);
+}
+
+void crypto_mem_unregister(crypto_cache* cache) {
+    pthread_mutex_lock(&caches_lock);
+    if (cache->prev) {
+        cache->prev->next = cache->next;
+    } else {
+        caches = cache->next;
+    }
+    if (cache->next) cache->next->prev = cache->prev;
+    pthread_mutex_unlock(&caches_lock);
+}
+
+void aes_memory_set_budget(int64_t bytes) {
+    pthread_mutex_lock(&lock);
+    budget = bytes > 0 ? bytes : default_budget();
+    pthread_cond_broadcast(&released);
+    pthread_mutex_unlock(&lock);
+}
+
+void aes_memory_trim(int level) {
+    pthread_mutex_lock(&lock);
+    drop_pool();
+    if (level >= AES_TRIM_COMPLETE) pressure_until = now_ns() + PRESSURE_NS;
+    pthread_mutex_unlock(&lock);
+
+    trim_caches(1);
+    crypto_alloc_trim();
+
+    pthread_mutex_lock(&lock);
+    peak = in_use + pooled;
+    pthread_mutex_unlock(&lock);
+}
+
+void aes_memory_snapshot(aes_memory_report* report) {
+    pthread_mutex_lock(&lock);
+    report->budget = current_budget();
+    report->in_use = in_use;
+    report->pooled = pooled;
+    report->peak = peak;
+    report->waits = waits;
+    pthread_mutex_unlock(&lock);
+    crypto_alloc_snapshot(&report->openssl_in_use, &report->openssl_cached, &report->openssl_mallocs);
+}
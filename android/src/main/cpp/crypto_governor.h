@@ -0,0 +1,44 @@
+#ifndef CRYPTO_GOVERNOR_H
+#define CRYPTO_GOVERNOR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide budget for the engine's native memory. I/O buffers, reader
+// caches and parallel workers all reserve from it; when it is exhausted,
+// operations wait for buffers held by others (and extra workers are not
+// started) instead of failing, and caches give memory back. Released I/O
+// buffers are kept in a small pool for the next operation.
+
+#define AES_TRIM_MODERATE 1  // Drop pooled buffers and idle cache entries
+#define AES_TRIM_COMPLETE 2  // Same, and halve the budget for a while
+
+typedef struct {
+    int64_t budget;           // Current limit in bytes (after any pressure cut)
+    int64_t in_use;           // Reserved by running operations and caches
+    int64_t pooled;           // Free buffers kept for reuse
+    int64_t peak;             // Highest in_use + pooled since start or trim
+    int64_t waits;            // Reservations that had to wait for memory
+    int64_t openssl_in_use;   // Held by OpenSSL (cipher contexts, provider state)
+    int64_t openssl_cached;   // Free blocks kept for OpenSSL's next allocations
+    int64_t openssl_mallocs;  // Heap allocations made for OpenSSL so far
+} aes_memory_report;
+
+// Limit in bytes; 0 restores the default (1/32 of physical memory, between
+// 16MB and 256MB)
+void aes_memory_set_budget(int64_t bytes);
+
+// Give memory back, e.g. from Android's onTrimMemory. OpenSSL's cached
+// blocks are freed at every level.
+void aes_memory_trim(int level);
+
+void aes_memory_snapshot(aes_memory_report* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_GOVERNOR_H
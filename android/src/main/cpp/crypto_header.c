@@ -0,0 +1,267 @@
+#include "crypto_header.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define PROBE_LENGTH 128  // Enough for the largest known header
+
+static const char HEADER_MAGIC[8] = { 'A', 'E', 'S', 'F', 'I', 'L', 'E', '1' };
+
+typedef struct {
+    char magic[8];
+    uint16_t version;
+    uint16_t header_size;     // Body starts here; later versions may grow the header
+    uint8_t algorithm;
+    uint8_t flags;
+    uint16_t reserved0;
+    uint32_t chunk_size;
+    uint32_t reserved1;
+    uint64_t plaintext_size;
+    unsigned char iv[IV_LENGTH];
+    unsigned char reserved2[16];
+} file_header;
+
+_Static_assert(sizeof(file_header) == AES_FILE_HEADER_SIZE, "file header layout");
+
+static int parse_header(const unsigned char* head, size_t length, file_header* header) {
+    if (length < sizeof(HEADER_MAGIC) || memcmp(head, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0) {
+        return -12;
+    }
+    // The magic is there, so a short read is a cut-off header, not legacy
+    if (length < sizeof(*header)) return -2;
+    memcpy(header, head, sizeof(*header));
+    if (header->version == 0 || header->version > AES_FILE_HEADER_VERSION ||
+        header->header_size < AES_FILE_HEADER_SIZE ||
+        header->algorithm != AES_ALGORITHM_AES_256_CTR) {
+        return -2;
+    }
+    return 0;
+}
+
+int crypto_read_stream_layout(int fd, crypto_stream_layout* layout) {
+    struct stat64 st;
+    unsigned char head[PROBE_LENGTH];
+    if (fstat64(fd, &st) != 0 || st.st_size < IV_LENGTH) return -2;
+    ssize_t head_length = crypto_pread_full(fd, head, sizeof(head), 0);
+    if (head_length < IV_LENGTH) return -2;
+
+    aes_file_metadata other;
+    memset(&other, 0, sizeof(other));
+    if (crypto_chunked_probe(head, (size_t)head_length, &other) == 0 ||
+        crypto_envelope_probe(head, (size_t)head_length, &other) == 0 ||
+        crypto_sparse_probe(head, (size_t)head_length, &other) == 0) {
+        return -12;
+    }
+
+    file_header header;
+    int parsed = parse_header(head, (size_t)head_length, &header);
+    if (parsed == -12) {
+        // Legacy: bare IV in front of the body
+        memcpy(layout->iv, head, IV_LENGTH);
+        layout->iv_offset = 0;
+        layout->data_offset = IV_LENGTH;
+        layout->has_header = 0;
+    } else if (parsed == 0 && (uint64_t)st.st_size >= header.header_size) {
+        memcpy(layout->iv, header.iv, IV_LENGTH);
+        layout->iv_offset = (off64_t)offsetof(file_header, iv);
+        layout->data_offset = (off64_t)header.header_size;
+        layout->has_header = 1;
+    } else {
+        return -2;
+    }
+    layout->body_length = (uint64_t)(st.st_size - layout->data_offset);
+    return 0;
+}
+
+int crypto_read_stream_layout_sequential(int fd, crypto_stream_layout* layout) {
+    unsigned char head[AES_FILE_HEADER_SIZE];
+    if (crypto_read_full(fd, head, IV_LENGTH) != IV_LENGTH) return -2;
+
+    aes_file_metadata other;
+    memset(&other, 0, sizeof(other));
+    if (crypto_chunked_probe(head, IV_LENGTH, &other) == 0 ||
+        crypto_envelope_probe(head, IV_LENGTH, &other) == 0 ||
+        crypto_sparse_probe(head, IV_LENGTH, &other) == 0) {
+        return -12;
+    }
+
+    memset(layout, 0, sizeof(*layout));
+    if (memcmp(head, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0) {
+        memcpy(layout->iv, head, IV_LENGTH);
+        layout->data_offset = IV_LENGTH;
+        return 0;
+    }
+
+    // Rest of the header, then skip any fields a newer version appended
+    file_header header;
+    size_t rest = AES_FILE_HEADER_SIZE - IV_LENGTH;
+    if (crypto_read_full(fd, head + IV_LENGTH, rest) != (ssize_t)rest ||
+        parse_header(head, sizeof(head), &header) != 0) {
+        return -2;
+    }
+    for (size_t skip = header.header_size - AES_FILE_HEADER_SIZE; skip > 0;) {
+        size_t step = skip < sizeof(head) ? skip : sizeof(head);
+        if (crypto_read_full(fd, head, step) != (ssize_t)step) return -2;
+        skip -= step;
+    }
+    memcpy(layout->iv, header.iv, IV_LENGTH);
+    layout->iv_offset = (off64_t)offsetof(file_header, iv);
+    layout->data_offset = (off64_t)header.header_size;
+    layout->has_header = 1;
+    return 0;
+}
+
+int crypto_header_set_length(int fd, uint64_t plaintext_size) {
+    return crypto_pwrite_full(fd, &plaintext_size, sizeof(plaintext_size),
+                              (off64_t)offsetof(file_header, plaintext_size));
+}
+
+void crypto_header_init(void* out, uint64_t plaintext_size, const unsigned char* iv) {
+    file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    header.version = AES_FILE_HEADER_VERSION;
+    header.header_size = AES_FILE_HEADER_SIZE;
+    header.algorithm = AES_ALGORITHM_AES_256_CTR;
+    header.plaintext_size = plaintext_size;
+    memcpy(header.iv, iv, IV_LENGTH);
+    memcpy(out, &header, sizeof(header));
+}
+
+static int encrypt_fd_with_header(int input_fd, int output_fd, const char* key, const char* iv_string) {
+    file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    header.version = AES_FILE_HEADER_VERSION;
+    header.header_size = AES_FILE_HEADER_SIZE;
+    header.algorithm = AES_ALGORITHM_AES_256_CTR;
+
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = NULL;
+    if (iv_string != NULL && strlen(iv_string) > 0) {
+        crypto_prepare_iv(iv_string, header.iv);
+    } else if (RAND_bytes(header.iv, IV_LENGTH) != 1) {
+        result = -2;
+    }
+
+    // Regular files announce their length up front; otherwise it is patched
+    // in afterwards, which needs a seekable output
+    struct stat64 st;
+    int known_length = fstat64(input_fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (known_length) {
+        header.plaintext_size = (uint64_t)st.st_size;
+    }
+    off64_t header_offset = lseek64(output_fd, 0, SEEK_CUR);
+    if (result == 0 && !known_length && header_offset < 0) {
+        result = -1;
+    }
+    if (result == 0) {
+        if (crypto_write_full(output_fd, &header, sizeof(header)) != 0) {
+            result = -7;
+        } else if (!(ctx = EVP_CIPHER_CTX_new())) {
+            result = -3;
+        } else if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, header.iv) != 1) {
+            result = -4;
+        } else {
+            result = crypto_ctr_stream(ctx, input_fd, output_fd);
+        }
+    }
+
+    // The input may have changed size while it was read; record what was written
+    off64_t end = result == 0 && header_offset >= 0 ? lseek64(output_fd, 0, SEEK_CUR) : -1;
+    if (end >= 0) {
+        uint64_t written = (uint64_t)(end - header_offset - AES_FILE_HEADER_SIZE);
+        if (written != header.plaintext_size &&
+            crypto_pwrite_full(output_fd, &written, sizeof(written),
+                               header_offset + (off64_t)offsetof(file_header, plaintext_size)) != 0) {
+            result = -7;
+        }
+    }
+
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+    EVP_CIPHER_CTX_free(ctx);
+    return result;
+}
+
+int aes_encrypt_fd_with_header(int input_fd, int output_fd, const char* key, const char* iv_string) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    off64_t position = lseek64(output_fd, 0, SEEK_CUR);
+    int result = encrypt_fd_with_header(input_fd, output_fd, key, iv_string);
+    int64_t written = position < 0 ? 0 : lseek64(output_fd, 0, SEEK_CUR) - position;
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, written, result);
+}
+
+static int encrypt_file_with_header(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    int output_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (input_fd < 0 || output_fd < 0) {
+        if (input_fd >= 0) close(input_fd);
+        if (output_fd >= 0) close(output_fd);
+        return -1;
+    }
+
+    int result = aes_encrypt_fd_with_header(input_fd, output_fd, key, iv_string);
+
+    close(input_fd);
+    close(output_fd);
+    return result;
+}
+
+int aes_encrypt_file_with_header(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = encrypt_file_with_header(input_path, output_path, key, iv_string);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
+int aes_file_info(const char* path, aes_file_metadata* info) {
+    memset(info, 0, sizeof(*info));
+    info->plaintext_size = -1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    // Only stat and one small pread; the body is never touched
+    struct stat64 st;
+    unsigned char head[PROBE_LENGTH];
+    ssize_t head_length = -1;
+    if (fstat64(fd, &st) == 0) {
+        head_length = crypto_pread_full(fd, head, sizeof(head), 0);
+    }
+    close(fd);
+    if (head_length < 0) return -1;
+    info->file_size = (int64_t)st.st_size;
+
+    file_header header;
+    int parsed = parse_header(head, (size_t)head_length, &header);
+    if (parsed == 0) {
+        info->format = AES_FILE_FORMAT_HEADER;
+        info->version = header.version;
+        info->algorithm = header.algorithm;
+        info->chunk_size = header.chunk_size;
+        info->header_size = header.header_size;
+        info->plaintext_size = (int64_t)header.plaintext_size;
+        info->has_iv = 1;
+        memcpy(info->iv, header.iv, IV_LENGTH);
+    } else if (parsed == -12 &&
+               crypto_chunked_probe(head, (size_t)head_length, info) != 0 &&
+               crypto_envelope_probe(head, (size_t)head_length, info) != 0 &&
+               crypto_sparse_probe(head, (size_t)head_length, info) != 0 &&
+               head_length >= IV_LENGTH) {
+        // No magic: assume the legacy IV-prefixed layout
+        info->format = AES_FILE_FORMAT_LEGACY;
+        info->algorithm = AES_ALGORITHM_AES_256_CTR;
+        info->header_size = IV_LENGTH;
+        info->plaintext_size = info->file_size - IV_LENGTH;
+        info->has_iv = 1;
+        memcpy(info->iv, head, IV_LENGTH);
+    }
+    return 0;
+}
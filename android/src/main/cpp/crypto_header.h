@@ -0,0 +1,56 @@
+#ifndef CRYPTO_HEADER_H
+#define CRYPTO_HEADER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Self-describing file format: a 64-byte header (magic "AESFILE1", version,
+// header size, algorithm, chunk size, plaintext length, IV) followed by the
+// AES-256-CTR body. Decrypt, append, rekey and the random access reader
+// accept it as well as the legacy IV-prefixed layout.
+
+#define AES_FILE_HEADER_SIZE 64
+#define AES_FILE_HEADER_VERSION 1
+
+#define AES_ALGORITHM_AES_256_CTR 1
+
+// Container formats reported by aes_file_info
+#define AES_FILE_FORMAT_UNKNOWN 0
+#define AES_FILE_FORMAT_LEGACY 1    // 16-byte IV + CTR body, no metadata
+#define AES_FILE_FORMAT_HEADER 2    // AESFILE1 header + CTR body
+#define AES_FILE_FORMAT_CHUNKED 3   // crypto_chunked.h
+#define AES_FILE_FORMAT_ENVELOPE 4  // crypto_envelope.h
+#define AES_FILE_FORMAT_SPARSE 5    // crypto_sparse.h
+
+typedef struct {
+    int format;
+    uint32_t version;
+    uint32_t algorithm;
+    uint32_t chunk_size;      // 0 for a single CTR stream
+    uint32_t header_size;     // Bytes before the encrypted body
+    int64_t file_size;
+    int64_t plaintext_size;
+    int has_iv;
+    unsigned char iv[16];
+} aes_file_metadata;
+
+// Encrypt into the headered format. iv_string may be NULL for a random IV.
+int aes_encrypt_file_with_header(const char* input_path, const char* output_path, const char* key, const char* iv_string);
+
+// Same, between caller-owned descriptors (neither is closed). The input is
+// read sequentially; the output must be seekable unless the input is a
+// regular file whose size does not change, so the length can be recorded.
+int aes_encrypt_fd_with_header(int input_fd, int output_fd, const char* key, const char* iv_string);
+
+// Describe an encrypted file from stat and its first bytes only; the body is
+// never read. Returns 0, or -1 if the file cannot be opened or read.
+int aes_file_info(const char* path, aes_file_metadata* info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_HEADER_H
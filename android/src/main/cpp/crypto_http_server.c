@@ -0,0 +1,447 @@
+#include "crypto_http_server.h"
+#include "crypto_internal.h"
+#include "crypto_reader.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#define HTTP_MAX_SESSIONS 32
+#define HTTP_MAX_CONNECTIONS 16
+#define HTTP_HEADER_LIMIT 8192
+#define HTTP_SEND_BUFFER (256 * 1024)  // Plaintext sent per reader call
+#define HTTP_IDLE_TIMEOUT_SEC 30       // Keep-alive connections idle longer are closed
+
+typedef struct {
+    char token[AES_HTTP_TOKEN_LENGTH + 1];
+    char mime_type[64];
+    aes_reader* reader;
+    int registered;         // Cleared by aes_http_server_remove
+    int refs;               // Connections currently serving this session
+} http_session;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static http_session g_sessions[HTTP_MAX_SESSIONS];
+static int g_client_fds[HTTP_MAX_CONNECTIONS];
+static int g_client_fds_ready = 0;
+static int g_listen_fd = -1;
+static int g_port = 0;
+static pthread_t g_accept_thread;
+
+// Session table
+
+static http_session* acquire_session(const char* token, size_t token_len) {
+    if (token_len != AES_HTTP_TOKEN_LENGTH) return NULL;
+
+    http_session* found = NULL;
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        http_session* session = &g_sessions[i];
+        if (session->registered &&
+            CRYPTO_memcmp(session->token, token, AES_HTTP_TOKEN_LENGTH) == 0) {
+            session->refs++;
+            found = session;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return found;
+}
+
+// Caller must hold g_lock
+static void drop_session_locked(http_session* session) {
+    if (!session->registered && session->refs == 0 && session->reader) {
+        aes_reader_close(session->reader);
+        session->reader = NULL;
+    }
+}
+
+static void release_session(http_session* session) {
+    pthread_mutex_lock(&g_lock);
+    session->refs--;
+    drop_session_locked(session);
+    pthread_mutex_unlock(&g_lock);
+}
+
+int aes_http_server_add(const char* path, const char* key, const char* mime_type, char* token_out) {
+    unsigned char random[AES_HTTP_TOKEN_LENGTH / 2];
+    if (RAND_bytes(random, sizeof(random)) != 1) return -2;
+
+    aes_reader* reader = aes_reader_open(path, key);
+    if (!reader) return -1;
+
+    pthread_mutex_lock(&g_lock);
+    http_session* session = NULL;
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        if (!g_sessions[i].registered && !g_sessions[i].reader) {
+            session = &g_sessions[i];
+            break;
+        }
+    }
+    if (!session) {
+        pthread_mutex_unlock(&g_lock);
+        aes_reader_close(reader);
+        return -3;
+    }
+
+    for (size_t i = 0; i < sizeof(random); i++) {
+        snprintf(session->token + i * 2, 3, "%02x", random[i]);
+    }
+    snprintf(session->mime_type, sizeof(session->mime_type), "%s",
+             mime_type && mime_type[0] ? mime_type : "application/octet-stream");
+    session->reader = reader;
+    session->refs = 0;
+    session->registered = 1;
+    memcpy(token_out, session->token, AES_HTTP_TOKEN_LENGTH + 1);
+    pthread_mutex_unlock(&g_lock);
+
+    return 0;
+}
+
+void aes_http_server_remove(const char* token) {
+    if (!token || strlen(token) != AES_HTTP_TOKEN_LENGTH) return;
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        http_session* session = &g_sessions[i];
+        if (session->registered &&
+            CRYPTO_memcmp(session->token, token, AES_HTTP_TOKEN_LENGTH) == 0) {
+            session->registered = 0;
+            drop_session_locked(session);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+// Request handling
+
+static int send_all(int fd, const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    while (length > 0) {
+        ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static int send_status(int fd, const char* status, int keep_alive) {
+    char response[256];
+    int n = snprintf(response, sizeof(response),
+                     "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+                     status, keep_alive ? "keep-alive" : "close");
+    return send_all(fd, response, (size_t)n);
+}
+
+// Find a header value in a NUL-terminated header block (case-insensitive name)
+static const char* find_header(const char* headers, const char* name) {
+    size_t name_len = strlen(name);
+    const char* line = strstr(headers, "\r\n");
+    while (line && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char* value = line + name_len + 1;
+            while (*value == ' ' || *value == '\t') value++;
+            return value;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+// Parse "bytes=a-b", "bytes=a-" or "bytes=-n" (first range only).
+// Returns 1 if a satisfiable range was found, 0 if absent, -1 if unsatisfiable.
+static int parse_range(const char* value, int64_t size, int64_t* start, int64_t* end) {
+    if (!value) return 0;
+    if (strncasecmp(value, "bytes=", 6) != 0) return 0;
+    value += 6;
+
+    char* next;
+    if (*value == '-') {
+        long long suffix = strtoll(value + 1, &next, 10);
+        if (next == value + 1 || suffix <= 0 || size == 0) return -1;
+        *start = suffix >= size ? 0 : size - suffix;
+        *end = size - 1;
+        return 1;
+    }
+
+    long long first = strtoll(value, &next, 10);
+    if (next == value || *next != '-' || first < 0) return 0;
+    if (first >= size) return -1;
+    value = next + 1;
+    long long last = strtoll(value, &next, 10);
+    if (next == value || last >= size) last = size - 1;
+    if (last < first) return 0;
+
+    *start = first;
+    *end = last;
+    return 1;
+}
+
+// Serve one request; returns 1 to keep the connection open
+static int handle_request(int fd, char* request, unsigned char* body) {
+    char method[8];
+    const char* target = strchr(request, ' ');
+    size_t method_len = target ? (size_t)(target - request) : 0;
+    if (!target || method_len >= sizeof(method)) {
+        send_status(fd, "400 Bad Request", 0);
+        return 0;
+    }
+    memcpy(method, request, method_len);
+    method[method_len] = '\0';
+    target++;
+
+    const char* connection = find_header(request, "Connection");
+    int keep_alive = !(connection && strncasecmp(connection, "close", 5) == 0) &&
+                     strstr(request, "HTTP/1.0\r\n") == NULL;
+
+    int head_only = strcmp(method, "HEAD") == 0;
+    if (!head_only && strcmp(method, "GET") != 0) {
+        return send_status(fd, "405 Method Not Allowed", keep_alive) == 0 && keep_alive;
+    }
+
+    // The first path segment is the session token
+    if (*target != '/') {
+        return send_status(fd, "400 Bad Request", keep_alive) == 0 && keep_alive;
+    }
+    const char* token = target + 1;
+    size_t token_len = strcspn(token, "/? ");
+    http_session* session = acquire_session(token, token_len);
+    if (!session) {
+        return send_status(fd, "404 Not Found", keep_alive) == 0 && keep_alive;
+    }
+
+    int64_t size = aes_reader_size(session->reader);
+    int64_t start = 0;
+    int64_t end = size - 1;
+    int ranged = parse_range(find_header(request, "Range"), size, &start, &end);
+
+    char header[512];
+    int header_len;
+    if (ranged < 0) {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                              "Content-Range: bytes */%lld\r\n"
+                              "Content-Length: 0\r\nConnection: %s\r\n\r\n",
+                              (long long)size, keep_alive ? "keep-alive" : "close");
+        int ok = send_all(fd, header, (size_t)header_len) == 0;
+        release_session(session);
+        return ok && keep_alive;
+    }
+
+    int64_t content_length = size == 0 ? 0 : end - start + 1;
+    if (ranged) {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 206 Partial Content\r\n"
+                              "Content-Type: %s\r\nContent-Length: %lld\r\n"
+                              "Content-Range: bytes %lld-%lld/%lld\r\n"
+                              "Accept-Ranges: bytes\r\nCache-Control: no-store\r\n"
+                              "Connection: %s\r\n\r\n",
+                              session->mime_type, (long long)content_length,
+                              (long long)start, (long long)end, (long long)size,
+                              keep_alive ? "keep-alive" : "close");
+    } else {
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: %s\r\nContent-Length: %lld\r\n"
+                              "Accept-Ranges: bytes\r\nCache-Control: no-store\r\n"
+                              "Connection: %s\r\n\r\n",
+                              session->mime_type, (long long)content_length,
+                              keep_alive ? "keep-alive" : "close");
+    }
+
+    int ok = send_all(fd, header, (size_t)header_len) == 0;
+    int64_t offset = start;
+    int64_t remaining = head_only ? 0 : content_length;
+    while (ok && remaining > 0) {
+        size_t want = remaining < HTTP_SEND_BUFFER ? (size_t)remaining : HTTP_SEND_BUFFER;
+        ssize_t n = aes_reader_pread(session->reader, body, want, offset);
+        if (n <= 0) {
+            ok = 0;
+            break;
+        }
+        ok = send_all(fd, body, (size_t)n) == 0;
+        offset += n;
+        remaining -= n;
+    }
+
+    release_session(session);
+    return ok && keep_alive;
+}
+
+static void* connection_main(void* arg) {
+    int slot = (int)(intptr_t)arg;
+    pthread_mutex_lock(&g_lock);
+    int fd = g_client_fds[slot];
+    pthread_mutex_unlock(&g_lock);
+
+    char* request = (char*)malloc(HTTP_HEADER_LIMIT + 1);
+    unsigned char* body = (unsigned char*)crypto_mem_acquire(HTTP_SEND_BUFFER);
+    size_t buffered = 0;
+
+    int keep_alive = request && body;
+    while (keep_alive) {
+        // Read until the end of the header block
+        char* end = NULL;
+        while (!end) {
+            request[buffered] = '\0';
+            end = strstr(request, "\r\n\r\n");
+            if (end) break;
+            if (buffered == HTTP_HEADER_LIMIT) break;
+            ssize_t n = recv(fd, request + buffered, HTTP_HEADER_LIMIT - buffered, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            buffered += (size_t)n;
+        }
+        if (!end) break;
+
+        // Terminate the header block in place, keep any pipelined bytes after it
+        size_t header_len = (size_t)(end - request) + 4;
+        char saved = request[header_len];
+        request[header_len] = '\0';
+        keep_alive = handle_request(fd, request, body);
+        request[header_len] = saved;
+
+        buffered -= header_len;
+        memmove(request, request + header_len, buffered);
+    }
+
+    free(request);
+    crypto_mem_release(body, HTTP_SEND_BUFFER);
+
+    pthread_mutex_lock(&g_lock);
+    g_client_fds[slot] = -1;
+    pthread_mutex_unlock(&g_lock);
+    close(fd);
+    return NULL;
+}
+
+static void* accept_main(void* arg) {
+    int listen_fd = (int)(intptr_t)arg;
+
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // Listening socket was shut down
+        }
+
+        struct timeval timeout = { HTTP_IDLE_TIMEOUT_SEC, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        pthread_mutex_lock(&g_lock);
+        int slot = -1;
+        for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+            if (g_client_fds[i] < 0) {
+                slot = i;
+                g_client_fds[i] = fd;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&g_lock);
+
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (slot < 0) {
+            send_status(fd, "503 Service Unavailable", 0);
+            close(fd);
+        } else if (pthread_create(&thread, &attr, connection_main, (void*)(intptr_t)slot) != 0) {
+            pthread_mutex_lock(&g_lock);
+            g_client_fds[slot] = -1;
+            pthread_mutex_unlock(&g_lock);
+            close(fd);
+        }
+        pthread_attr_destroy(&attr);
+    }
+    return NULL;
+}
+
+int aes_http_server_start(void) {
+    pthread_mutex_lock(&g_lock);
+    if (g_listen_fd >= 0) {
+        int port = g_port;
+        pthread_mutex_unlock(&g_lock);
+        return port;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        pthread_mutex_unlock(&g_lock);
+        return -1;
+    }
+
+    // Loopback only, ephemeral port
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addr_len = sizeof(addr);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(fd, HTTP_MAX_CONNECTIONS) != 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        close(fd);
+        pthread_mutex_unlock(&g_lock);
+        return -2;
+    }
+
+    // Slots stay owned by their connection threads across restarts
+    if (!g_client_fds_ready) {
+        for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+            g_client_fds[i] = -1;
+        }
+        g_client_fds_ready = 1;
+    }
+    if (pthread_create(&g_accept_thread, NULL, accept_main, (void*)(intptr_t)fd) != 0) {
+        close(fd);
+        pthread_mutex_unlock(&g_lock);
+        return -3;
+    }
+
+    g_listen_fd = fd;
+    g_port = ntohs(addr.sin_port);
+    int port = g_port;
+    pthread_mutex_unlock(&g_lock);
+    return port;
+}
+
+void aes_http_server_stop(void) {
+    pthread_mutex_lock(&g_lock);
+    int fd = g_listen_fd;
+    if (fd < 0) {
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+    g_listen_fd = -1;
+    g_port = 0;
+
+    // Wake the accept loop and every connection blocked in recv/send
+    shutdown(fd, SHUT_RDWR);
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        if (g_client_fds[i] >= 0) shutdown(g_client_fds[i], SHUT_RDWR);
+    }
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        g_sessions[i].registered = 0;
+        drop_session_locked(&g_sessions[i]);
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    pthread_join(g_accept_thread, NULL);
+    close(fd);
+}
@@ -0,0 +1,32 @@
+#ifndef CRYPTO_HTTP_SERVER_H
+#define CRYPTO_HTTP_SERVER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_HTTP_TOKEN_LENGTH 32  // Hex characters, excluding the terminator
+
+// Loopback HTTP server that streams decrypted byte ranges of encrypted files
+// to media players. It binds to 127.0.0.1 only and every registered file is
+// reachable solely through its random session token:
+//   http://127.0.0.1:<port>/<token>[/any-name.ext]
+
+// Start the server (no-op if already running). Returns the bound port or a negative error.
+int aes_http_server_start(void);
+void aes_http_server_stop(void);
+
+// Register an encrypted file. Writes the session token (AES_HTTP_TOKEN_LENGTH + 1
+// bytes including the terminator) into token_out. Returns 0 on success.
+int aes_http_server_add(const char* path, const char* key, const char* mime_type, char* token_out);
+
+// Unregister a session; open connections finish their current response
+void aes_http_server_remove(const char* token);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_HTTP_SERVER_H
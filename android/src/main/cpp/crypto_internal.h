@@ -0,0 +1,226 @@
+#ifndef CRYPTO_INTERNAL_H
+#define CRYPTO_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <openssl/evp.h>
+#include "crypto_governor.h"
+#include "crypto_header.h"
+#include "crypto_metrics.h"
+#include "crypto_sched.h"
+#include "crypto_stats.h"
+#include "crypto_verify.h"
+
+// Helpers shared between the native modules; not part of the public API
+
+#define BUFFER_SIZE (256 * 1024)  // 256KB buffer for better performance
+#define AES_KEY_LENGTH 32         // AES-256
+#define IV_LENGTH 16              // AES block size
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Key / IV preparation (same rules as the iOS and Dart implementations)
+void crypto_prepare_key(const char* input_key, unsigned char* output_key);
+void crypto_prepare_iv(const char* input_iv, unsigned char* output_iv);
+
+// CTR counter arithmetic
+void crypto_ctr_iv_at(const unsigned char* iv, uint64_t block_index, unsigned char* out_iv);
+int crypto_ctr_seek(EVP_CIPHER_CTX* ctx, const unsigned char* iv, uint64_t offset);
+
+// Stream input_fd through a keyed CTR context into output_fd until end of
+// file. Returns 0, -1 (read), -3 (alloc), -5 (cipher) or -7 (write).
+int crypto_ctr_stream(EVP_CIPHER_CTX* ctx, int input_fd, int output_fd);
+
+// Where the IV and CTR body of a legacy or AESFILE1 file live (crypto_header.c).
+// Returns 0, -2 (truncated or bad header) or -12 (another container format).
+typedef struct {
+    unsigned char iv[IV_LENGTH];
+    off64_t iv_offset;
+    off64_t data_offset;
+    uint64_t body_length;
+    int has_header;
+} crypto_stream_layout;
+int crypto_read_stream_layout(int fd, crypto_stream_layout* layout);
+
+// Same, consuming the IV or header from the current position of a possibly
+// unseekable fd; body_length is left at 0 (unknown)
+int crypto_read_stream_layout_sequential(int fd, crypto_stream_layout* layout);
+
+// Fill AES_FILE_HEADER_SIZE bytes at out with a version 1 AESFILE1 header
+void crypto_header_init(void* out, uint64_t plaintext_size, const unsigned char* iv);
+
+// Record a new plaintext length in an AESFILE1 header
+int crypto_header_set_length(int fd, uint64_t plaintext_size);
+
+// Fill info from the first bytes of a file if they carry this module's
+// header; return 0 on a match (crypto_chunked.c, crypto_envelope.c, crypto_sparse.c)
+int crypto_chunked_probe(const unsigned char* head, size_t length, aes_file_metadata* info);
+int crypto_envelope_probe(const unsigned char* head, size_t length, aes_file_metadata* info);
+int crypto_sparse_probe(const unsigned char* head, size_t length, aes_file_metadata* info);
+
+// Unwrap an envelope file's data key (crypto_envelope.c). Returns 0, -2 (bad
+// header), -10 (the key does not unwrap it) or -12 (not an envelope file).
+int crypto_envelope_unwrap(int fd, const char* key, unsigned char* data_key, unsigned char* iv, off64_t* data_offset);
+
+// Decrypt a chunked container into output_fd, written sequentially (crypto_chunked.c)
+int crypto_chunked_decrypt_fd(int input_fd, int output_fd, const char* key);
+
+// Decrypt a sparse file into output_fd with pwrite, recreating its holes, and
+// leave the fd positioned at the end (crypto_sparse.c)
+int crypto_sparse_decrypt_fd(int input_fd, int output_fd, const char* key);
+
+// Decrypt a sparse file's data runs in plaintext order and hand each to sink
+// at its plaintext offset; holes are passed with data NULL (crypto_sparse.c).
+// A non-zero sink result stops the walk and is returned.
+typedef int (*crypto_sparse_sink)(void* arg, uint64_t offset, const unsigned char* data, size_t length);
+int crypto_sparse_walk(int fd, const char* key, crypto_sparse_sink sink, void* arg);
+
+// Decrypt a chunked container into buffer (crypto_chunked.c). Returns -2 if
+// the plaintext does not fit in capacity.
+int crypto_chunked_decrypt_buffer(int input_fd, const char* key, unsigned char* buffer, size_t capacity, size_t* length);
+
+// Verify a chunked container chunk by chunk, feeding the plaintext to digest
+// and stopping at the first fingerprint mismatch (crypto_chunked.c)
+int crypto_chunked_verify(int fd, const char* key, int flags, EVP_MD_CTX* digest, aes_verify_report* report);
+
+// fd I/O that retries on EINTR and short transfers (crypto_io.c).
+// Reads return the byte count (short only at end of file) or -1.
+ssize_t crypto_read_full(int fd, void* buffer, size_t length);
+ssize_t crypto_pread_full(int fd, void* buffer, size_t length, off64_t offset);
+int crypto_write_full(int fd, const void* buffer, size_t length);
+int crypto_pwrite_full(int fd, const void* buffer, size_t length, off64_t offset);
+
+// fsync / fdatasync inside an "aes_fsync" trace span
+int crypto_fsync(int fd);
+int crypto_fdatasync(int fd);
+
+// Copy length bytes between file offsets with copy_file_range, falling back
+// to pread/pwrite where the kernel or filesystem can't. Returns 0, -1, -3 or -7.
+int crypto_copy_range(int input_fd, off64_t input_offset, int output_fd, off64_t output_offset, uint64_t length);
+
+// Run fn over [0, total) split into up to `threads` contiguous ranges, one per
+// thread (crypto_parallel.c). Range boundaries are multiples of `alignment`.
+// threads <= 0 picks one per online CPU. Returns the first non-zero result.
+typedef int (*crypto_range_fn)(void* arg, uint64_t start, uint64_t end);
+int crypto_parallel_ranges(uint64_t total, int threads, uint64_t alignment, crypto_range_fn fn, void* arg);
+int crypto_cpu_count(void);
+
+// Operation statistics for the calling thread (crypto_stats.c). Wrap each
+// read, write or cipher call as `t = crypto_stats_clock(); ...;
+// crypto_stats_read(t);`; all of these are no-ops unless aes_stats_begin ran.
+int crypto_stats_active(void);
+int64_t crypto_stats_clock(void);
+void crypto_stats_read(int64_t started);
+void crypto_stats_write(int64_t started);
+void crypto_stats_crypto(int64_t started, size_t bytes);
+
+// Fold a worker thread's statistics into the calling thread's
+void crypto_stats_merge(const aes_op_stats* worker, int threads);
+
+// Count a heap allocation made for OpenSSL on this thread
+void crypto_stats_alloc(void);
+
+// Report the I/O buffer size the operation runs with
+void crypto_stats_buffer(size_t size);
+
+// Process-wide metrics (crypto_metrics.c). Public entry points run their
+// work as `t = crypto_metrics_begin(op); ...; return crypto_metrics_end(op, t,
+// bytes, result);`; only the outermost entry point on a thread is counted,
+// traced as a span named after the operation. Negative results count as errors.
+int64_t crypto_metrics_begin(int op);
+int crypto_metrics_end(int op, int64_t started, int64_t bytes, int result);
+int64_t crypto_metrics_clock(void);
+void crypto_metrics_queue_wait(int64_t started);
+int64_t crypto_metrics_file_size(const char* path);
+
+// Scheduling (crypto_sched.c). crypto_sched_begin / end bracket each
+// outermost operation (from crypto_metrics) so background threads know when
+// foreground work is running; crypto_sched_io is called before each
+// buffer-sized read or write and pauses / throttles background threads.
+int crypto_sched_background(void);
+int crypto_sched_threads(int threads);
+void crypto_sched_begin(void);
+void crypto_sched_end(void);
+void crypto_sched_io(size_t bytes);
+
+// Wait until no operation of either priority has started or ended for
+// quiet_ns, giving up after timeout_ns. Returns a mark for
+// crypto_sched_idle_since, or 0 on timeout. crypto_sched_idle_since tells
+// whether the engine has stayed idle since the mark was taken.
+uint64_t crypto_sched_wait_idle(int64_t quiet_ns, int64_t timeout_ns);
+int crypto_sched_idle_since(uint64_t mark);
+
+// Take bytes from the background budget without waiting; later background
+// I/O pays off the debt
+void crypto_sched_charge(size_t bytes);
+
+// Memory budget (crypto_governor.c). Buffers held for the length of an
+// operation come from crypto_mem_acquire, which waits while the budget is
+// exhausted, and go back with crypto_mem_release and the same size, on the
+// same thread. Blocks that outlive the call (cache entries, reader and
+// follow buffers) use the _shared pair instead, which any thread may
+// release; with wait = 0 it returns NULL instead of waiting, for caches that
+// can evict an entry instead. crypto_mem_threads caps a worker count so each
+// worker's per_thread bytes fit in what is left.
+void* crypto_mem_acquire(size_t size);
+void crypto_mem_release(void* block, size_t size);
+void* crypto_mem_acquire_shared(size_t size, int wait);
+void crypto_mem_release_shared(void* block, size_t size);
+int crypto_mem_threads(int threads, size_t per_thread);
+
+// Allocator installed for OpenSSL at load time (crypto_alloc.c).
+// crypto_alloc_trim frees its cached blocks; the snapshot reports bytes
+// OpenSSL holds, bytes cached in the free lists and heap allocations so far.
+void crypto_alloc_trim(void);
+void crypto_alloc_snapshot(int64_t* bytes_in_use, int64_t* bytes_cached, int64_t* heap_allocations);
+
+// Per-filesystem tuning (crypto_tune.c): the settings for an operation on
+// fd's filesystem, after any explicit options. Also records buffer_size in
+// the operation's statistics.
+typedef struct {
+    size_t buffer_size;
+    int threads;      // 0 = one per CPU
+    int read_ahead;   // Reader chunks fetched ahead
+} crypto_tuning;
+void crypto_tune_for_fd(int fd, crypto_tuning* tuning);
+
+// Caches register to be trimmed on aes_memory_trim and when a reservation
+// finds the budget exhausted. trim releases what it can; with wait = 0 it
+// must not block on the cache's own lock (the caller may hold it).
+typedef struct crypto_cache crypto_cache;
+struct crypto_cache {
+    void (*trim)(crypto_cache* cache, int wait);
+    crypto_cache* prev;
+    crypto_cache* next;
+};
+void crypto_mem_register(crypto_cache* cache);
+void crypto_mem_unregister(crypto_cache* cache);
+
+// Trace spans (crypto_trace.c), compiled in only with AES_ENABLE_TRACE.
+// Spans nest per thread and each BEGIN needs an END on the same thread;
+// spans still open when an operation returns early (error paths) are closed
+// by crypto_metrics_end through CRYPTO_TRACE_UNWIND.
+#ifdef AES_ENABLE_TRACE
+void crypto_trace_begin(const char* name);
+void crypto_trace_end(void);
+unsigned int crypto_trace_depth(void);
+void crypto_trace_unwind(unsigned int depth);
+#define CRYPTO_TRACE_BEGIN(name) crypto_trace_begin(name)
+#define CRYPTO_TRACE_END() crypto_trace_end()
+#define CRYPTO_TRACE_DEPTH() crypto_trace_depth()
+#define CRYPTO_TRACE_UNWIND(depth) crypto_trace_unwind(depth)
+#else
+#define CRYPTO_TRACE_BEGIN(name) ((void)0)
+#define CRYPTO_TRACE_END() ((void)0)
+#define CRYPTO_TRACE_DEPTH() 0u
+#define CRYPTO_TRACE_UNWIND(depth) ((void)(depth))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_INTERNAL_H
@@ -0,0 +1,125 @@
+#include "crypto_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define COPY_STEP (1024 * 1024 * 1024)  // Per copy_file_range call
+
+ssize_t crypto_read_full(int fd, void* buffer, size_t length) {
+    crypto_sched_io(length);
+    size_t done = 0;
+    int failed = 0;
+    CRYPTO_TRACE_BEGIN("aes_read");
+    while (done < length) {
+        int64_t started = crypto_stats_clock();
+        ssize_t n = read(fd, (unsigned char*)buffer + done, length - done);
+        crypto_stats_read(started);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) failed = 1;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    CRYPTO_TRACE_END();
+    return failed ? -1 : (ssize_t)done;
+}
+
+ssize_t crypto_pread_full(int fd, void* buffer, size_t length, off64_t offset) {
+    crypto_sched_io(length);
+    size_t done = 0;
+    int failed = 0;
+    CRYPTO_TRACE_BEGIN("aes_read");
+    while (done < length) {
+        int64_t started = crypto_stats_clock();
+        ssize_t n = pread64(fd, (unsigned char*)buffer + done, length - done, offset + (off64_t)done);
+        crypto_stats_read(started);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) failed = 1;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    CRYPTO_TRACE_END();
+    return failed ? -1 : (ssize_t)done;
+}
+
+int crypto_write_full(int fd, const void* buffer, size_t length) {
+    crypto_sched_io(length);
+    size_t done = 0;
+    CRYPTO_TRACE_BEGIN("aes_write");
+    while (done < length) {
+        int64_t started = crypto_stats_clock();
+        ssize_t n = write(fd, (const unsigned char*)buffer + done, length - done);
+        crypto_stats_write(started);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    CRYPTO_TRACE_END();
+    return done < length ? -1 : 0;
+}
+
+int crypto_pwrite_full(int fd, const void* buffer, size_t length, off64_t offset) {
+    crypto_sched_io(length);
+    size_t done = 0;
+    CRYPTO_TRACE_BEGIN("aes_write");
+    while (done < length) {
+        int64_t started = crypto_stats_clock();
+        ssize_t n = pwrite64(fd, (const unsigned char*)buffer + done, length - done, offset + (off64_t)done);
+        crypto_stats_write(started);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    CRYPTO_TRACE_END();
+    return done < length ? -1 : 0;
+}
+
+int crypto_fsync(int fd) {
+    CRYPTO_TRACE_BEGIN("aes_fsync");
+    int result = fsync(fd);
+    CRYPTO_TRACE_END();
+    return result;
+}
+
+int crypto_fdatasync(int fd) {
+    CRYPTO_TRACE_BEGIN("aes_fsync");
+    int result = fdatasync(fd);
+    CRYPTO_TRACE_END();
+    return result;
+}
+
+int crypto_copy_range(int input_fd, off64_t input_offset, int output_fd, off64_t output_offset, uint64_t length) {
+#ifdef SYS_copy_file_range
+    // In-kernel copy (no round trip through user space, shared extents where
+    // the filesystem supports them); bionic only wraps it from API 34
+    while (length > 0) {
+        loff_t in = input_offset;
+        loff_t out = output_offset;
+        size_t step = length < COPY_STEP ? (size_t)length : COPY_STEP;
+        ssize_t n = syscall(SYS_copy_file_range, input_fd, &in, output_fd, &out, step, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;  // Unsupported here (ENOSYS, EXDEV, ...): copy the rest by hand
+        input_offset += n;
+        output_offset += n;
+        length -= (uint64_t)n;
+    }
+#endif
+    if (length == 0) return 0;
+
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    if (!buffer) return -3;
+    int result = 0;
+    while (result == 0 && length > 0) {
+        size_t step = length < BUFFER_SIZE ? (size_t)length : BUFFER_SIZE;
+        if (crypto_pread_full(input_fd, buffer, step, input_offset) != (ssize_t)step) {
+            result = -1;
+        } else if (crypto_pwrite_full(output_fd, buffer, step, output_offset) != 0) {
+            result = -7;
+        }
+        input_offset += (off64_t)step;
+        output_offset += (off64_t)step;
+        length -= step;
+    }
+    crypto_mem_release(buffer, BUFFER_SIZE);
+    return result;
+}
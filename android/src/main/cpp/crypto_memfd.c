@@ -0,0 +1,117 @@
+#include "crypto_memfd.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+// memfd_create(2) / file sealing values; older NDK headers lack some of them
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#define F_SEAL_WRITE 0x0008
+#endif
+
+// CTR formats: decrypt the body of input_fd from data_offset to its end
+static int decrypt_ctr_body(int input_fd, int output_fd, const unsigned char* key,
+                            const unsigned char* iv, off64_t data_offset) {
+    if (lseek64(input_fd, data_offset, SEEK_SET) < 0) return -1;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int result;
+    if (!ctx) {
+        result = -3;
+    } else if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, key, iv) != 1) {
+        result = -4;
+    } else {
+        result = crypto_ctr_stream(ctx, input_fd, output_fd);
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    return result;
+}
+
+static int decrypt_to_memfd(const char* path, const char* key, const char* name) {
+    aes_file_metadata info;
+    int input_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (input_fd < 0 || aes_file_info(path, &info) != 0) {
+        if (input_fd >= 0) close(input_fd);
+        return -1;
+    }
+
+    // Called through syscall() so the library still loads where libc has no wrapper
+    int memfd = (int)syscall(SYS_memfd_create, name != NULL ? name : "aes_decrypted",
+                             MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd < 0) {
+        close(input_fd);
+        return -3;
+    }
+
+    // Reserve the plaintext size up front so the tmpfs file doesn't grow per write
+    if (info.plaintext_size > 0) {
+        ftruncate64(memfd, (off64_t)info.plaintext_size);
+    }
+
+    int result;
+    unsigned char data_key[AES_KEY_LENGTH];
+    unsigned char iv[IV_LENGTH];
+    off64_t data_offset;
+    crypto_stream_layout layout;
+    switch (info.format) {
+        case AES_FILE_FORMAT_CHUNKED:
+            result = crypto_chunked_decrypt_fd(input_fd, memfd, key);
+            break;
+        case AES_FILE_FORMAT_SPARSE:
+            result = crypto_sparse_decrypt_fd(input_fd, memfd, key);
+            break;
+        case AES_FILE_FORMAT_ENVELOPE:
+            result = crypto_envelope_unwrap(input_fd, key, data_key, iv, &data_offset);
+            if (result == 0) {
+                result = decrypt_ctr_body(input_fd, memfd, data_key, iv, data_offset);
+            }
+            break;
+        case AES_FILE_FORMAT_LEGACY:
+        case AES_FILE_FORMAT_HEADER:
+            result = crypto_read_stream_layout(input_fd, &layout);
+            if (result == 0) {
+                crypto_prepare_key(key, data_key);
+                result = decrypt_ctr_body(input_fd, memfd, data_key, layout.iv, layout.data_offset);
+            }
+            break;
+        default:
+            result = -2;
+            break;
+    }
+    OPENSSL_cleanse(data_key, sizeof(data_key));
+    close(input_fd);
+
+    // Trim to what was written, then make the plaintext immutable
+    off64_t length = result == 0 ? lseek64(memfd, 0, SEEK_CUR) : -1;
+    if (result == 0 &&
+        (length < 0 || ftruncate64(memfd, length) != 0 ||
+         fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0 ||
+         lseek64(memfd, 0, SEEK_SET) != 0)) {
+        result = -7;
+    }
+    if (result != 0) {
+        close(memfd);
+        return result;
+    }
+    return memfd;
+}
+
+int aes_decrypt_to_memfd(const char* path, const char* key, const char* name) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int fd = decrypt_to_memfd(path, key, name);
+    int64_t size = fd >= 0 ? lseek64(fd, 0, SEEK_END) : 0;
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, size, fd);
+}
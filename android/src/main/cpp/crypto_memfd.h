@@ -0,0 +1,19 @@
+#ifndef CRYPTO_MEMFD_H
+#define CRYPTO_MEMFD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Decrypt path (any supported format) into an anonymous memory file created
+// with memfd_create and sealed against writes, resizing and further sealing
+// once complete. Returns the fd (owned by the caller, O_CLOEXEC) or a
+// negative error; -3 also covers kernels without memfd_create (< 3.17).
+// Other code in the process can open the plaintext as /proc/self/fd/<fd>.
+int aes_decrypt_to_memfd(const char* path, const char* key, const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_MEMFD_H
@@ -0,0 +1,168 @@
+#include "crypto_memory.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+// CTR formats: read the body into buffer and decrypt it in place
+static int decrypt_ctr_buffer(int fd, const unsigned char* key, const unsigned char* iv, off64_t data_offset,
+                              uint64_t body_length, unsigned char* buffer, size_t capacity, size_t* length) {
+    if (body_length > capacity) return -2;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return -3;
+    int result = 0;
+    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, key, iv) != 1) {
+        result = -4;
+    }
+
+    // EVP lengths are int, so large bodies go through in BUFFER_SIZE steps
+    uint64_t position = 0;
+    while (result == 0 && position < body_length) {
+        size_t step = body_length - position < BUFFER_SIZE ? (size_t)(body_length - position) : BUFFER_SIZE;
+        unsigned char* target = buffer + position;
+        int out_length;
+        if (crypto_pread_full(fd, target, step, data_offset + (off64_t)position) != (ssize_t)step) {
+            result = -1;
+        } else if (EVP_DecryptUpdate(ctx, target, &out_length, target, (int)step) != 1) {
+            result = -5;
+        }
+        position += step;
+    }
+    *length = result == 0 ? (size_t)body_length : 0;
+
+    EVP_CIPHER_CTX_free(ctx);
+    return result;
+}
+
+typedef struct {
+    unsigned char* buffer;
+    size_t capacity;
+} buffer_sink;
+
+// Holes are left as the zeros the buffer was cleared to
+static int copy_run(void* arg, uint64_t offset, const unsigned char* data, size_t length) {
+    buffer_sink* out = (buffer_sink*)arg;
+    if (offset > out->capacity || length > out->capacity - offset) return -2;
+    if (data) memcpy(out->buffer + offset, data, length);
+    return 0;
+}
+
+static int decrypt_file_to_buffer(const char* path, const char* key, unsigned char* buffer,
+                                  size_t capacity, size_t* length) {
+    *length = 0;
+    aes_file_metadata info;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || aes_file_info(path, &info) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    int result;
+    unsigned char data_key[AES_KEY_LENGTH];
+    unsigned char iv[IV_LENGTH];
+    off64_t data_offset;
+    crypto_stream_layout layout;
+    switch (info.format) {
+        case AES_FILE_FORMAT_CHUNKED:
+            result = crypto_chunked_decrypt_buffer(fd, key, buffer, capacity, length);
+            break;
+        case AES_FILE_FORMAT_ENVELOPE:
+            result = crypto_envelope_unwrap(fd, key, data_key, iv, &data_offset);
+            if (result == 0) {
+                result = decrypt_ctr_buffer(fd, data_key, iv, data_offset,
+                                            (uint64_t)(info.file_size - data_offset), buffer, capacity, length);
+            }
+            break;
+        case AES_FILE_FORMAT_LEGACY:
+        case AES_FILE_FORMAT_HEADER:
+            result = crypto_read_stream_layout(fd, &layout);
+            if (result == 0) {
+                crypto_prepare_key(key, data_key);
+                result = decrypt_ctr_buffer(fd, data_key, layout.iv, layout.data_offset,
+                                            layout.body_length, buffer, capacity, length);
+            }
+            break;
+        case AES_FILE_FORMAT_SPARSE:
+            if (info.plaintext_size < 0 || (uint64_t)info.plaintext_size > capacity) {
+                result = -2;
+            } else {
+                buffer_sink out = { buffer, capacity };
+                memset(buffer, 0, (size_t)info.plaintext_size);
+                result = crypto_sparse_walk(fd, key, copy_run, &out);
+                if (result == 0) *length = (size_t)info.plaintext_size;
+            }
+            break;
+        default:
+            result = -2;
+            break;
+    }
+
+    OPENSSL_cleanse(data_key, sizeof(data_key));
+    close(fd);
+    return result;
+}
+
+int aes_decrypt_file_to_buffer(const char* path, const char* key, unsigned char* buffer,
+                               size_t capacity, size_t* length) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int result = decrypt_file_to_buffer(path, key, buffer, capacity, length);
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, (int64_t)*length, result);
+}
+
+static int encrypt_buffer_to_file(const unsigned char* data, size_t length, const char* path,
+                                  const char* key, int header) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) return -1;
+
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    unsigned char iv[IV_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    unsigned char* out_buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    if (!ctx || !out_buffer) {
+        result = -3;
+    } else if (RAND_bytes(iv, IV_LENGTH) != 1) {
+        result = -2;
+    } else if (header) {
+        unsigned char file_header[AES_FILE_HEADER_SIZE];
+        crypto_header_init(file_header, (uint64_t)length, iv);
+        if (crypto_write_full(fd, file_header, sizeof(file_header)) != 0) result = -7;
+    } else if (crypto_write_full(fd, iv, IV_LENGTH) != 0) {
+        result = -7;
+    }
+    if (result == 0 && EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, iv) != 1) {
+        result = -4;
+    }
+
+    size_t position = 0;
+    while (result == 0 && position < length) {
+        size_t step = length - position < BUFFER_SIZE ? length - position : BUFFER_SIZE;
+        int out_length;
+        if (EVP_EncryptUpdate(ctx, out_buffer, &out_length, data + position, (int)step) != 1) {
+            result = -5;
+        } else if (crypto_write_full(fd, out_buffer, (size_t)out_length) != 0) {
+            result = -7;
+        }
+        position += step;
+    }
+
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+    EVP_CIPHER_CTX_free(ctx);
+    crypto_mem_release(out_buffer, BUFFER_SIZE);
+    close(fd);
+    return result;
+}
+
+int aes_encrypt_buffer_to_file(const unsigned char* data, size_t length, const char* path,
+                               const char* key, int header) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = encrypt_buffer_to_file(data, length, path, key, header);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, (int64_t)length, result);
+}
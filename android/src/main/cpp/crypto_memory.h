@@ -0,0 +1,27 @@
+#ifndef CRYPTO_MEMORY_H
+#define CRYPTO_MEMORY_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Decrypt path (any supported format) straight into buffer: the ciphertext
+// is read into place and decrypted there, with no intermediate copy (sparse
+// files' data runs go through a scratch buffer, holes are zero-filled). Size
+// the buffer from aes_file_info's plaintext_size. Returns 0, or -2 if the
+// plaintext does not fit in capacity.
+int aes_decrypt_file_to_buffer(const char* path, const char* key, unsigned char* buffer,
+                               size_t capacity, size_t* length);
+
+// Encrypt length bytes of data into path, in the legacy layout or, with
+// header != 0, in the AESFILE1 layout. data is not modified.
+int aes_encrypt_buffer_to_file(const unsigned char* data, size_t length, const char* path,
+                               const char* key, int header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_MEMORY_H
@@ -0,0 +1,230 @@
+#include "crypto_metrics.h"
+#include "crypto_internal.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Log-linear buckets: values below 2^SUB_BITS get a bucket each, every
+// power of two above that is split into 2^SUB_BITS equal buckets
+#define SUB_BITS 5
+#define SUB_COUNT (1 << SUB_BITS)
+#define BUCKETS ((64 - SUB_BITS) * SUB_COUNT)
+
+typedef struct {
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    int64_t sum;
+    int64_t max;
+} histogram;
+
+typedef struct {
+    uint64_t errors_by_code[AES_METRIC_ERROR_CODES];
+    int64_t bytes;
+    histogram latency;
+} op_metrics;
+
+static op_metrics metrics[AES_METRIC_OPS];
+static op_metrics queue_wait;
+
+static const char* const OP_NAMES[AES_METRIC_OPS] = {
+    "encrypt", "decrypt", "rekey", "append", "verify", "read"
+};
+
+#ifdef AES_ENABLE_TRACE
+static const char* const SPAN_NAMES[AES_METRIC_OPS] = {
+    "aes_encrypt", "aes_decrypt", "aes_rekey", "aes_append", "aes_verify", "aes_reader_pread"
+};
+#endif
+
+// Nesting depth on this thread, so an entry point that calls another one
+// (aes_encrypt_file -> aes_encrypt_file_with_iv) is only counted once, and
+// the trace depth the outermost one started at
+static __thread int depth;
+static __thread unsigned int trace_depth;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bucket_of(uint64_t value) {
+    if (value < SUB_COUNT) return (int)value;
+    int magnitude = 63 - __builtin_clzll(value);
+    int group = magnitude - SUB_BITS + 1;
+    return group * SUB_COUNT + (int)((value >> (group - 1)) & (SUB_COUNT - 1));
+}
+
+static int64_t bucket_upper(int bucket) {
+    if (bucket < SUB_COUNT) return bucket;
+    int group = bucket / SUB_COUNT;
+    uint64_t lower = (uint64_t)(SUB_COUNT + bucket % SUB_COUNT) << (group - 1);
+    return (int64_t)(lower + ((uint64_t)1 << (group - 1)) - 1);
+}
+
+static void histogram_add(histogram* h, int64_t value) {
+    if (value < 0) value = 0;
+    __atomic_fetch_add(&h->counts[bucket_of((uint64_t)value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+    int64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (value > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Fill count, total, max and percentiles from one pass over the buckets.
+// Concurrent updates may make the copy slightly inconsistent, never invalid.
+static void histogram_read(const histogram* h, aes_op_metrics* out) {
+    static const double QUANTILES[3] = { 0.5, 0.99, 0.999 };
+    int64_t* targets[3] = { &out->p50_ns, &out->p99_ns, &out->p999_ns };
+    uint64_t counts[BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        counts[i] = __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+        total += counts[i];
+    }
+    out->count = (int64_t)total;
+    out->total_ns = __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+    out->max_ns = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    out->p50_ns = out->p99_ns = out->p999_ns = 0;
+    if (total == 0) return;
+
+    uint64_t seen = 0;
+    int next = 0;
+    for (int i = 0; i < BUCKETS && next < 3; i++) {
+        seen += counts[i];
+        while (next < 3 && seen >= (uint64_t)(QUANTILES[next] * (double)total + 0.5)) {
+            int64_t value = bucket_upper(i);
+            *targets[next++] = value < out->max_ns ? value : out->max_ns;
+        }
+    }
+}
+
+int64_t crypto_metrics_begin(int op) {
+    if (depth++ == 0) {
+        trace_depth = CRYPTO_TRACE_DEPTH();
+        CRYPTO_TRACE_BEGIN(SPAN_NAMES[op]);
+        crypto_sched_begin();
+    }
+    return now_ns();
+}
+
+int crypto_metrics_end(int op, int64_t started, int64_t bytes, int result) {
+    if (--depth > 0) return result;
+    crypto_sched_end();
+    CRYPTO_TRACE_UNWIND(trace_depth);
+    op_metrics* m = &metrics[op];
+    histogram_add(&m->latency, now_ns() - started);
+    if (result < 0) {
+        int slot = result >= -(AES_METRIC_ERROR_CODES - 1) ? -result : 0;
+        __atomic_fetch_add(&m->errors_by_code[slot], 1, __ATOMIC_RELAXED);
+    } else if (bytes > 0) {
+        __atomic_fetch_add(&m->bytes, bytes, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+void crypto_metrics_queue_wait(int64_t started) {
+    histogram_add(&queue_wait.latency, now_ns() - started);
+}
+
+int64_t crypto_metrics_clock(void) {
+    return now_ns();
+}
+
+int64_t crypto_metrics_file_size(const char* path) {
+    struct stat st;
+    return path != NULL && stat(path, &st) == 0 ? (int64_t)st.st_size : 0;
+}
+
+const char* aes_metrics_op_name(int op) {
+    return op >= 0 && op < AES_METRIC_OPS ? OP_NAMES[op] : NULL;
+}
+
+static void read_op(const op_metrics* m, aes_op_metrics* out) {
+    histogram_read(&m->latency, out);
+    out->bytes = __atomic_load_n(&m->bytes, __ATOMIC_RELAXED);
+    out->errors = 0;
+    for (int i = 0; i < AES_METRIC_ERROR_CODES; i++) {
+        out->errors_by_code[i] = (int64_t)__atomic_load_n(&m->errors_by_code[i], __ATOMIC_RELAXED);
+        out->errors += out->errors_by_code[i];
+    }
+}
+
+void aes_metrics_snapshot(aes_metrics_report* report) {
+    for (int op = 0; op < AES_METRIC_OPS; op++) {
+        read_op(&metrics[op], &report->ops[op]);
+    }
+    read_op(&queue_wait, &report->queue_wait);
+}
+
+void aes_metrics_reset(void) {
+    for (int op = 0; op < AES_METRIC_OPS; op++) {
+        memset(&metrics[op], 0, sizeof(metrics[op]));
+    }
+    memset(&queue_wait, 0, sizeof(queue_wait));
+}
+
+typedef struct {
+    char* buffer;
+    size_t capacity;
+    size_t length;
+} text_writer;
+
+static void append(text_writer* w, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = w->length < w->capacity ? w->capacity - w->length : 0;
+    int written = vsnprintf(room > 0 ? w->buffer + w->length : NULL, room, format, args);
+    va_end(args);
+    if (written > 0) w->length += (size_t)written;
+}
+
+static void append_summary(text_writer* w, const char* name, const char* labels, const aes_op_metrics* m) {
+    const char* sep = labels[0] ? "," : "";
+    append(w, "%s{%s%squantile=\"0.5\"} %.9f\n", name, labels, sep, m->p50_ns / 1e9);
+    append(w, "%s{%s%squantile=\"0.99\"} %.9f\n", name, labels, sep, m->p99_ns / 1e9);
+    append(w, "%s{%s%squantile=\"0.999\"} %.9f\n", name, labels, sep, m->p999_ns / 1e9);
+    const char* open = labels[0] ? "{" : "";
+    const char* close = labels[0] ? "}" : "";
+    append(w, "%s_sum%s%s%s %.9f\n", name, open, labels, close, m->total_ns / 1e9);
+    append(w, "%s_count%s%s%s %lld\n", name, open, labels, close, (long long)m->count);
+}
+
+size_t aes_metrics_prometheus(char* buffer, size_t capacity) {
+    aes_metrics_report report;
+    aes_metrics_snapshot(&report);
+    text_writer w = { buffer, capacity, 0 };
+    if (capacity > 0) buffer[0] = '\0';
+    char labels[32];
+
+    append(&w, "# HELP aes_operations_total Completed operations.\n# TYPE aes_operations_total counter\n");
+    for (int op = 0; op < AES_METRIC_OPS; op++) {
+        append(&w, "aes_operations_total{op=\"%s\"} %lld\n", OP_NAMES[op], (long long)report.ops[op].count);
+    }
+    append(&w, "# HELP aes_bytes_total Bytes produced by successful operations.\n# TYPE aes_bytes_total counter\n");
+    for (int op = 0; op < AES_METRIC_OPS; op++) {
+        append(&w, "aes_bytes_total{op=\"%s\"} %lld\n", OP_NAMES[op], (long long)report.ops[op].bytes);
+    }
+    append(&w, "# HELP aes_errors_total Failed operations by error code.\n# TYPE aes_errors_total counter\n");
+    for (int op = 0; op < AES_METRIC_OPS; op++) {
+        for (int slot = 0; slot < AES_METRIC_ERROR_CODES; slot++) {
+            if (report.ops[op].errors_by_code[slot] == 0) continue;
+            char code[8] = "other";
+            if (slot) snprintf(code, sizeof(code), "%d", -slot);
+            append(&w, "aes_errors_total{op=\"%s\",code=\"%s\"} %lld\n", OP_NAMES[op], code,
+                   (long long)report.ops[op].errors_by_code[slot]);
+        }
+    }
+    append(&w, "# HELP aes_operation_duration_seconds Operation latency.\n# TYPE aes_operation_duration_seconds summary\n");
+    for (int op = 0; op < AES_METRIC_OPS; op++) {
+        snprintf(labels, sizeof(labels), "op=\"%s\"", OP_NAMES[op]);
+        append_summary(&w, "aes_operation_duration_seconds", labels, &report.ops[op]);
+    }
+    append(&w, "# HELP aes_queue_wait_seconds Time queued work waited for a thread.\n# TYPE aes_queue_wait_seconds summary\n");
+    append_summary(&w, "aes_queue_wait_seconds", "", &report.queue_wait);
+    return w.length;
+}
@@ -0,0 +1,61 @@
+#ifndef CRYPTO_METRICS_H
+#define CRYPTO_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide metrics for every public entry point, kept in lock-free
+// counters and log-linear (HDR-style) latency histograms with about 3%
+// relative error. Unlike aes_op_stats they are always on and aggregate over
+// all threads, to show throughput and tail latency under load.
+
+enum {
+    AES_METRIC_ENCRYPT,     // All encrypt formats, fd and buffer variants
+    AES_METRIC_DECRYPT,
+    AES_METRIC_REKEY,       // Key rotation and envelope rewrap
+    AES_METRIC_APPEND,
+    AES_METRIC_VERIFY,
+    AES_METRIC_READ,        // aes_reader_pread calls
+    AES_METRIC_OPS
+};
+
+#define AES_METRIC_ERROR_CODES 13   // Slot n counts error -n; slot 0 any other code
+
+typedef struct {
+    int64_t count;
+    int64_t errors;
+    int64_t bytes;              // Bytes produced (written or returned)
+    int64_t total_ns;
+    int64_t p50_ns;
+    int64_t p99_ns;
+    int64_t p999_ns;
+    int64_t max_ns;
+    int64_t errors_by_code[AES_METRIC_ERROR_CODES];
+} aes_op_metrics;
+
+typedef struct {
+    aes_op_metrics ops[AES_METRIC_OPS];
+    aes_op_metrics queue_wait;  // Time work waited for a thread to pick it up
+} aes_metrics_report;
+
+// Name of an AES_METRIC_* operation, e.g. "encrypt"
+const char* aes_metrics_op_name(int op);
+
+// Copy the current counters and percentiles into report
+void aes_metrics_snapshot(aes_metrics_report* report);
+
+// Render the metrics in the Prometheus text exposition format. Returns the
+// full length like snprintf; the output is truncated to capacity - 1.
+size_t aes_metrics_prometheus(char* buffer, size_t capacity);
+
+void aes_metrics_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_METRICS_H
@@ -0,0 +1,98 @@
+#include "crypto_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define PARALLEL_MAX_THREADS 8
+#define PARALLEL_MIN_RANGE (4 * 1024 * 1024)  // Smaller ranges aren't worth a thread
+#define PARALLEL_THREAD_MEMORY (2 * BUFFER_SIZE)  // A worker's buffer plus its touched stack, roughly
+
+typedef struct {
+    crypto_range_fn fn;
+    void* arg;
+    uint64_t start;
+    uint64_t end;
+    int result;
+    int record_stats;
+    int background;
+    aes_op_stats stats;
+    int64_t queued;
+} range_task;
+
+static void* range_main(void* arg) {
+    range_task* task = (range_task*)arg;
+    task->result = task->fn(task->arg, task->start, task->end);
+    return NULL;
+}
+
+// Worker thread entry: statistics are thread-local, so record them here and
+// hand them back to the caller
+static void* worker_main(void* arg) {
+    range_task* task = (range_task*)arg;
+    crypto_metrics_queue_wait(task->queued);
+    if (task->background) aes_sched_set_thread_priority(AES_PRIORITY_BACKGROUND);
+    if (task->record_stats) aes_stats_begin();
+    range_main(task);
+    if (task->record_stats) aes_stats_collect(&task->stats);
+    return NULL;
+}
+
+int crypto_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+int crypto_parallel_ranges(uint64_t total, int threads, uint64_t alignment, crypto_range_fn fn, void* arg) {
+    threads = crypto_sched_threads(threads);
+    if (threads <= 0) threads = crypto_cpu_count();
+    if (threads > PARALLEL_MAX_THREADS) threads = PARALLEL_MAX_THREADS;
+    if ((uint64_t)threads > total / PARALLEL_MIN_RANGE) threads = (int)(total / PARALLEL_MIN_RANGE);
+    // Fewer workers rather than workers stalled on the memory budget
+    if (threads > 1) threads = crypto_mem_threads(threads, PARALLEL_THREAD_MEMORY);
+    if (threads < 1) threads = 1;
+    if (alignment == 0) alignment = 1;
+
+    if (threads == 1) {
+        return fn(arg, 0, total);
+    }
+
+    range_task tasks[PARALLEL_MAX_THREADS];
+    pthread_t handles[PARALLEL_MAX_THREADS];
+    int started[PARALLEL_MAX_THREADS] = {0};
+
+    uint64_t step = (total / (uint64_t)threads + alignment - 1) / alignment * alignment;
+    uint64_t start = 0;
+    int count = 0;
+    for (int i = 0; i < threads && start < total; i++) {
+        uint64_t end = i == threads - 1 || start + step > total ? total : start + step;
+        tasks[count].fn = fn;
+        tasks[count].arg = arg;
+        tasks[count].start = start;
+        tasks[count].end = end;
+        tasks[count].result = 0;
+        tasks[count].record_stats = crypto_stats_active();
+        tasks[count].background = crypto_sched_background();
+        count++;
+        start = end;
+    }
+
+    // Ranges 1..n run on worker threads, range 0 on the caller
+    for (int i = 1; i < count; i++) {
+        tasks[i].queued = crypto_metrics_clock();
+        started[i] = pthread_create(&handles[i], NULL, worker_main, &tasks[i]) == 0;
+        if (!started[i]) {
+            range_main(&tasks[i]);
+        }
+    }
+    range_main(&tasks[0]);
+
+    int result = tasks[0].result;
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(handles[i], NULL);
+            if (tasks[i].record_stats) crypto_stats_merge(&tasks[i].stats, count);
+        }
+        if (result == 0) result = tasks[i].result;
+    }
+    return result;
+}
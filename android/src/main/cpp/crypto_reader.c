@@ -0,0 +1,258 @@
+#include "crypto_reader.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+
+#define READER_CHUNK_SIZE (64 * 1024)  // Decryption / cache granularity
+#define READER_CACHE_CHUNKS 32         // 2MB of decrypted data per reader
+
+typedef struct {
+    int64_t index;          // Chunk index, -1 when the slot is unused
+    size_t length;          // Valid plaintext bytes in the slot
+    uint64_t last_used;     // LRU clock value of the last access
+    unsigned char* data;
+} reader_chunk;
+
+struct aes_reader {
+    crypto_cache trim_hook; // First, so the hook converts back to its reader
+    int fd;
+    int64_t plaintext_size;
+    off64_t data_offset;    // Start of the CTR body (after the IV or header)
+    unsigned char iv[IV_LENGTH];
+    EVP_CIPHER_CTX* ctx;
+    pthread_mutex_t lock;
+
+    reader_chunk cache[READER_CACHE_CHUNKS];
+    uint64_t clock;
+
+    int64_t last_end;       // Plaintext offset right after the previous read
+    int readahead;          // Current read-ahead window in chunks
+    int max_readahead;      // Tuned for the file's filesystem
+    size_t scratch_size;
+    unsigned char* scratch; // Ciphertext staging for one batched pread
+};
+
+// Give every cached chunk back to the memory budget
+static void reader_trim(crypto_cache* cache, int wait) {
+    aes_reader* reader = (aes_reader*)cache;
+    if (wait) {
+        pthread_mutex_lock(&reader->lock);
+    } else if (pthread_mutex_trylock(&reader->lock) != 0) {
+        return;
+    }
+    for (int i = 0; i < READER_CACHE_CHUNKS; i++) {
+        crypto_mem_release_shared(reader->cache[i].data, READER_CHUNK_SIZE);
+        reader->cache[i].data = NULL;
+        reader->cache[i].index = -1;
+    }
+    pthread_mutex_unlock(&reader->lock);
+}
+
+aes_reader* aes_reader_open(const char* path, const char* key) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    crypto_stream_layout layout;
+    if (crypto_read_stream_layout(fd, &layout) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    aes_reader* reader = (aes_reader*)calloc(1, sizeof(aes_reader));
+    if (!reader) {
+        close(fd);
+        return NULL;
+    }
+    pthread_mutex_init(&reader->lock, NULL);
+    reader->fd = fd;
+    reader->plaintext_size = (int64_t)layout.body_length;
+    reader->data_offset = layout.data_offset;
+    memcpy(reader->iv, layout.iv, IV_LENGTH);
+    reader->last_end = -1;
+    for (int i = 0; i < READER_CACHE_CHUNKS; i++) {
+        reader->cache[i].index = -1;
+    }
+    crypto_tuning tuning;
+    crypto_tune_for_fd(fd, &tuning);
+    reader->max_readahead = tuning.read_ahead;
+    reader->scratch_size = (size_t)(1 + tuning.read_ahead) * READER_CHUNK_SIZE;
+    reader->trim_hook.trim = reader_trim;
+    crypto_mem_register(&reader->trim_hook);
+
+    // Key schedule is set up once and reused for every chunk
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+    reader->ctx = EVP_CIPHER_CTX_new();
+    reader->scratch = (unsigned char*)crypto_mem_acquire_shared(reader->scratch_size, 1);
+    if (!reader->ctx || !reader->scratch ||
+        EVP_DecryptInit_ex(reader->ctx, EVP_aes_256_ctr(), NULL, prepared_key, layout.iv) != 1) {
+        aes_reader_close(reader);
+        return NULL;
+    }
+
+    return reader;
+}
+
+static reader_chunk* find_chunk(aes_reader* reader, int64_t index) {
+    for (int i = 0; i < READER_CACHE_CHUNKS; i++) {
+        if (reader->cache[i].index == index) {
+            return &reader->cache[i];
+        }
+    }
+    return NULL;
+}
+
+// Pick a slot for a new chunk: an unused slot, else the least recently used
+// one. An unused slot without a buffer only gets one if the memory budget
+// has room (or, with wait, once it has); otherwise the cache stops growing
+// and recycles its oldest chunk. Chunks used after keep_after are kept.
+static reader_chunk* evict_chunk(aes_reader* reader, uint64_t keep_after, int wait) {
+    reader_chunk* unused = NULL;
+    reader_chunk* oldest = NULL;
+    for (int i = 0; i < READER_CACHE_CHUNKS; i++) {
+        reader_chunk* slot = &reader->cache[i];
+        if (slot->index < 0) {
+            if (slot->data) {
+                unused = slot;
+                break;
+            }
+            if (!unused) unused = slot;
+        } else if (slot->last_used <= keep_after && (!oldest || slot->last_used < oldest->last_used)) {
+            oldest = slot;
+        }
+    }
+
+    reader_chunk* victim = unused && unused->data ? unused : NULL;
+    if (!victim && unused && (unused->data = (unsigned char*)crypto_mem_acquire_shared(READER_CHUNK_SIZE, 0))) {
+        victim = unused;
+    }
+    if (!victim) victim = oldest;
+    if (!victim && unused && wait && (unused->data = (unsigned char*)crypto_mem_acquire_shared(READER_CHUNK_SIZE, 1))) {
+        victim = unused;
+    }
+    if (!victim) return NULL;
+    victim->index = -1;
+    return victim;
+}
+
+// Load `count` consecutive chunks starting at `first` with a single pread
+static int load_chunks(aes_reader* reader, int64_t first, int count) {
+    int64_t last_chunk = (reader->plaintext_size - 1) / READER_CHUNK_SIZE;
+    if (first + count - 1 > last_chunk) {
+        count = (int)(last_chunk - first + 1);
+    }
+    // Don't re-read chunks that are already cached
+    for (int i = 1; i < count; i++) {
+        if (find_chunk(reader, first + i)) {
+            count = i;
+            break;
+        }
+    }
+
+    int64_t offset = first * READER_CHUNK_SIZE;
+    size_t want = (size_t)count * READER_CHUNK_SIZE;
+    if (offset + (int64_t)want > reader->plaintext_size) {
+        want = (size_t)(reader->plaintext_size - offset);
+    }
+
+    ssize_t read_bytes = crypto_pread_full(reader->fd, reader->scratch, want, reader->data_offset + (off64_t)offset);
+    if (read_bytes != (ssize_t)want) return -2;
+    size_t got = want;
+
+    if (crypto_ctr_seek(reader->ctx, reader->iv, (uint64_t)offset) != 0) {
+        return -3;
+    }
+    uint64_t batch_start = reader->clock;
+    for (int i = 0; i < count; i++) {
+        size_t start = (size_t)i * READER_CHUNK_SIZE;
+        size_t length = got - start < READER_CHUNK_SIZE ? got - start : READER_CHUNK_SIZE;
+        // Only the requested chunk may wait for memory; read-ahead stops
+        // short instead of evicting what this batch just decrypted
+        reader_chunk* slot = evict_chunk(reader, batch_start, i == 0);
+        if (!slot && i > 0) break;
+        int out_length;
+        if (!slot || EVP_DecryptUpdate(reader->ctx, slot->data, &out_length,
+                                       reader->scratch + start, (int)length) != 1) {
+            return -3;
+        }
+        slot->index = first + i;
+        slot->length = (size_t)out_length;
+        slot->last_used = ++reader->clock;
+    }
+    return 0;
+}
+
+static ssize_t reader_pread(aes_reader* reader, void* buffer, size_t length, int64_t offset) {
+    if (!reader || !buffer || offset < 0) return -1;
+    if (offset >= reader->plaintext_size || length == 0) return 0;
+    if ((int64_t)length > reader->plaintext_size - offset) {
+        length = (size_t)(reader->plaintext_size - offset);
+    }
+
+    pthread_mutex_lock(&reader->lock);
+
+    // Grow the read-ahead window while the caller keeps reading sequentially,
+    // drop it as soon as it seeks somewhere else
+    if (offset == reader->last_end) {
+        reader->readahead = reader->readahead == 0 ? 1 : reader->readahead * 2;
+        if (reader->readahead > reader->max_readahead) reader->readahead = reader->max_readahead;
+    } else {
+        reader->readahead = 0;
+    }
+
+    size_t copied = 0;
+    while (copied < length) {
+        int64_t position = offset + (int64_t)copied;
+        int64_t index = position / READER_CHUNK_SIZE;
+
+        reader_chunk* chunk = find_chunk(reader, index);
+        if (!chunk) {
+            int result = load_chunks(reader, index, 1 + reader->readahead);
+            if (result != 0) {
+                pthread_mutex_unlock(&reader->lock);
+                return result;
+            }
+            chunk = find_chunk(reader, index);
+        }
+        chunk->last_used = ++reader->clock;
+
+        size_t in_chunk = (size_t)(position - index * READER_CHUNK_SIZE);
+        size_t n = chunk->length - in_chunk;
+        if (n > length - copied) n = length - copied;
+        memcpy((unsigned char*)buffer + copied, chunk->data + in_chunk, n);
+        copied += n;
+    }
+
+    reader->last_end = offset + (int64_t)copied;
+    pthread_mutex_unlock(&reader->lock);
+    return (ssize_t)copied;
+}
+
+ssize_t aes_reader_pread(aes_reader* reader, void* buffer, size_t length, int64_t offset) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_READ);
+    ssize_t count = reader_pread(reader, buffer, length, offset);
+    crypto_metrics_end(AES_METRIC_READ, started, count > 0 ? count : 0, count < 0 ? (int)count : 0);
+    return count;
+}
+
+int64_t aes_reader_size(aes_reader* reader) {
+    return reader ? reader->plaintext_size : -1;
+}
+
+void aes_reader_close(aes_reader* reader) {
+    if (!reader) return;
+
+    crypto_mem_unregister(&reader->trim_hook);
+    EVP_CIPHER_CTX_free(reader->ctx);
+    pthread_mutex_destroy(&reader->lock);
+    for (int i = 0; i < READER_CACHE_CHUNKS; i++) {
+        crypto_mem_release_shared(reader->cache[i].data, READER_CHUNK_SIZE);
+    }
+    crypto_mem_release_shared(reader->scratch, reader->scratch_size);
+    close(reader->fd);
+    free(reader);
+}
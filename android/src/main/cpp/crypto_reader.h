@@ -0,0 +1,32 @@
+#ifndef CRYPTO_READER_H
+#define CRYPTO_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Seekable reader over a file produced by aes_encrypt_file*. The file
+// descriptor and key schedule stay alive between reads and decrypted chunks
+// are kept in a small LRU cache, so random reads only pay for what they touch.
+typedef struct aes_reader aes_reader;
+
+aes_reader* aes_reader_open(const char* path, const char* key);
+
+// Read up to `length` plaintext bytes starting at plaintext `offset`.
+// Returns the number of bytes read (0 at end of file) or a negative error.
+ssize_t aes_reader_pread(aes_reader* reader, void* buffer, size_t length, int64_t offset);
+
+// Plaintext length of the underlying file
+int64_t aes_reader_size(aes_reader* reader);
+
+void aes_reader_close(aes_reader* reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_READER_H
@@ -0,0 +1,172 @@
+#include "crypto_rekey.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+typedef struct {
+    int input_fd;
+    int output_fd;
+    unsigned char old_key[AES_KEY_LENGTH];
+    unsigned char new_key[AES_KEY_LENGTH];
+    unsigned char old_iv[IV_LENGTH];
+    unsigned char new_iv[IV_LENGTH];
+    off64_t data_offset;
+    size_t buffer_size;
+} rekey_job;
+
+// Worker: transform plaintext range [start, end) of the body
+static int rekey_range(void* arg, uint64_t start, uint64_t end) {
+    rekey_job* job = (rekey_job*)arg;
+
+    EVP_CIPHER_CTX* decrypt_ctx = EVP_CIPHER_CTX_new();
+    EVP_CIPHER_CTX* encrypt_ctx = EVP_CIPHER_CTX_new();
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(job->buffer_size);
+    int result = 0;
+    if (!decrypt_ctx || !encrypt_ctx || !buffer) {
+        result = -3;
+    } else if (EVP_DecryptInit_ex(decrypt_ctx, EVP_aes_256_ctr(), NULL, job->old_key, job->old_iv) != 1 ||
+               EVP_EncryptInit_ex(encrypt_ctx, EVP_aes_256_ctr(), NULL, job->new_key, job->new_iv) != 1 ||
+               crypto_ctr_seek(decrypt_ctx, job->old_iv, start) != 0 ||
+               crypto_ctr_seek(encrypt_ctx, job->new_iv, start) != 0) {
+        result = -4;
+    }
+
+    uint64_t position = start;
+    while (result == 0 && position < end) {
+        size_t length = end - position < job->buffer_size ? (size_t)(end - position) : job->buffer_size;
+        off64_t file_offset = job->data_offset + (off64_t)position;
+        int out_length;
+        if (crypto_pread_full(job->input_fd, buffer, length, file_offset) != (ssize_t)length) {
+            result = -1;
+            break;
+        }
+        // Old keystream off, new keystream on; plaintext only ever lives in this buffer
+        int64_t started = crypto_stats_clock();
+        CRYPTO_TRACE_BEGIN("aes_crypt");
+        int updated = EVP_DecryptUpdate(decrypt_ctx, buffer, &out_length, buffer, (int)length) == 1 &&
+                      EVP_EncryptUpdate(encrypt_ctx, buffer, &out_length, buffer, (int)length) == 1;
+        CRYPTO_TRACE_END();
+        if (!updated) {
+            result = -5;
+            break;
+        }
+        crypto_stats_crypto(started, length);
+        if (crypto_pwrite_full(job->output_fd, buffer, length, file_offset) != 0) {
+            result = -7;
+        }
+        position += length;
+    }
+
+    if (buffer) OPENSSL_cleanse(buffer, job->buffer_size);
+    EVP_CIPHER_CTX_free(decrypt_ctx);
+    EVP_CIPHER_CTX_free(encrypt_ctx);
+    crypto_mem_release(buffer, job->buffer_size);
+    return result;
+}
+
+static int rekey_file(const char* input_path, const char* output_path,
+                      const char* old_key, const char* new_key, int threads) {
+    int in_place = output_path == NULL || strcmp(output_path, input_path) == 0;
+    // Another path to the same file ("./a", a symlink, /sdcard vs
+    // /storage/emulated/0) must not be truncated as the output
+    struct stat64 input_stat;
+    struct stat64 output_stat;
+    if (!in_place && stat64(input_path, &input_stat) == 0 && stat64(output_path, &output_stat) == 0 &&
+        input_stat.st_dev == output_stat.st_dev && input_stat.st_ino == output_stat.st_ino) {
+        in_place = 1;
+    }
+
+    rekey_job job;
+    job.input_fd = open(input_path, (in_place ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (job.input_fd < 0) return -1;
+
+    // Legacy IV prefix or AESFILE1 header; a header is carried over unchanged.
+    // Checked before a separate output is created, so a file in another
+    // format doesn't cost the caller whatever was at output_path.
+    crypto_stream_layout layout;
+    int result = crypto_read_stream_layout(job.input_fd, &layout);
+    if (result != 0) {
+        close(job.input_fd);
+        return result;
+    }
+    job.output_fd = in_place ? job.input_fd
+                             : open(output_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (job.output_fd < 0) {
+        close(job.input_fd);
+        return -1;
+    }
+
+    // Buffer size and, unless given, worker count from the output's filesystem
+    crypto_tuning tuning;
+    crypto_tune_for_fd(job.output_fd, &tuning);
+    job.buffer_size = tuning.buffer_size;
+    if (threads <= 0) threads = tuning.threads;
+
+    if (RAND_bytes(job.new_iv, IV_LENGTH) != 1) {
+        result = -2;
+    }
+    if (result == 0) {
+        memcpy(job.old_iv, layout.iv, IV_LENGTH);
+        job.data_offset = layout.data_offset;
+    }
+    crypto_prepare_key(old_key, job.old_key);
+    crypto_prepare_key(new_key, job.new_key);
+
+    // Size the output up front so the workers can write their segments anywhere
+    uint64_t body_length = result == 0 ? layout.body_length : 0;
+    if (result == 0 && !in_place && ftruncate64(job.output_fd, layout.data_offset + (off64_t)body_length) != 0) {
+        result = -7;
+    }
+    if (result == 0 && !in_place && layout.has_header) {
+        size_t header_length = (size_t)layout.data_offset;
+        unsigned char* header = (unsigned char*)malloc(header_length);
+        if (!header) {
+            result = -3;
+        } else if (crypto_pread_full(job.input_fd, header, header_length, 0) != (ssize_t)header_length) {
+            result = -1;
+        } else if (crypto_pwrite_full(job.output_fd, header, header_length, 0) != 0) {
+            result = -7;
+        }
+        free(header);
+    }
+    if (result == 0) {
+        result = crypto_parallel_ranges(body_length, threads, job.buffer_size, rekey_range, &job);
+    }
+
+    // The new IV goes in only after the whole body is rewritten
+    if (result == 0 && crypto_fdatasync(job.output_fd) != 0) {
+        result = -7;
+    }
+    if (result == 0 && (crypto_pwrite_full(job.output_fd, job.new_iv, IV_LENGTH, layout.iv_offset) != 0 ||
+                        crypto_fsync(job.output_fd) != 0)) {
+        result = -7;
+    }
+
+    OPENSSL_cleanse(job.old_key, sizeof(job.old_key));
+    OPENSSL_cleanse(job.new_key, sizeof(job.new_key));
+    if (!in_place) {
+        if (close(job.output_fd) != 0 && result == 0) {
+            result = -7;
+        }
+        // A partial output has an unset IV and decrypts to garbage
+        if (result != 0) {
+            unlink(output_path);
+        }
+    }
+    close(job.input_fd);
+    return result;
+}
+
+int aes_rekey_file(const char* input_path, const char* output_path,
+                   const char* old_key, const char* new_key, int threads) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_REKEY);
+    int result = rekey_file(input_path, output_path, old_key, new_key, threads);
+    int64_t size = crypto_metrics_file_size(output_path != NULL ? output_path : input_path);
+    return crypto_metrics_end(AES_METRIC_REKEY, started, size, result);
+}
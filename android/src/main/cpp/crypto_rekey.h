@@ -0,0 +1,26 @@
+#ifndef CRYPTO_REKEY_H
+#define CRYPTO_REKEY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Re-encrypt a file produced by aes_encrypt_file* under new_key and a fresh
+// random IV in a single streaming pass: every chunk goes through old-key CTR
+// decryption and new-key CTR encryption in memory, so no plaintext reaches
+// storage. Segments of the file are processed in parallel (threads <= 0 uses
+// the output filesystem's tuned count, by default one thread per CPU).
+//
+// output_path NULL (or naming the same file as input_path, by any path)
+// rewrites the file in place. The new IV is written last, but an interrupted
+// in-place rekey leaves a file that neither key decrypts; write to a new path
+// and rename when that matters. A separate output is only created once the
+// input's layout checks out, and is removed again if the rekey fails.
+int aes_rekey_file(const char* input_path, const char* output_path,
+                   const char* old_key, const char* new_key, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_REKEY_H
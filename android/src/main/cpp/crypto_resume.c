@@ -0,0 +1,247 @@
+#include "crypto_resume.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#define CHECKPOINT_INTERVAL (64LL * 1024 * 1024)  // Bytes encrypted between checkpoints
+
+static const char CHECKPOINT_MAGIC[8] = { 'A', 'E', 'S', 'C', 'K', 'P', 'T', '1' };
+
+// On-disk journal record, written atomically via rename
+typedef struct {
+    char magic[8];
+    uint64_t bytes_done;          // Plaintext bytes durably written to the output
+    uint64_t input_size;
+    int64_t input_mtime_sec;
+    int64_t input_mtime_nsec;
+    unsigned char iv[IV_LENGTH];
+    unsigned char key_check[16];  // Truncated hash of the key, rejects resuming with another key
+} checkpoint_record;
+
+static void compute_key_check(const unsigned char* prepared_key, unsigned char* key_check) {
+    static const char domain[] = "aes_encrypt_file checkpoint";
+    unsigned char material[sizeof(domain) + AES_KEY_LENGTH];
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    memcpy(material, domain, sizeof(domain));
+    memcpy(material + sizeof(domain), prepared_key, AES_KEY_LENGTH);
+    SHA256(material, sizeof(material), digest);
+    memcpy(key_check, digest, 16);
+}
+
+static int load_checkpoint(const char* journal_path, checkpoint_record* record) {
+    int fd = open(journal_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = crypto_read_full(fd, record, sizeof(*record));
+    close(fd);
+    if (n != (ssize_t)sizeof(*record) || memcmp(record->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int write_checkpoint(const char* journal_path, const checkpoint_record* record) {
+    char temp_path[PATH_MAX];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", journal_path) >= (int)sizeof(temp_path)) {
+        return -1;
+    }
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    int ok = crypto_write_full(fd, record, sizeof(*record)) == 0 && crypto_fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(temp_path, journal_path) != 0) {
+        unlink(temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int encrypt_file_resumable(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    char journal_path[PATH_MAX];
+    if (snprintf(journal_path, sizeof(journal_path), "%s.ckpt", output_path) >= (int)sizeof(journal_path)) {
+        return -1;
+    }
+
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    struct stat64 input_stat;
+    if (input_fd < 0 || fstat64(input_fd, &input_stat) != 0) {
+        if (input_fd >= 0) close(input_fd);
+        return -1;
+    }
+
+    // Prepare 32-byte key
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+    unsigned char key_check[16];
+    compute_key_check(prepared_key, key_check);
+
+    unsigned char requested_iv[IV_LENGTH];
+    int has_requested_iv = iv_string != NULL && strlen(iv_string) > 0;
+    if (has_requested_iv) {
+        crypto_prepare_iv(iv_string, requested_iv);
+    }
+
+    // Resume only if the journal matches this input, key and IV
+    checkpoint_record record;
+    int resume = load_checkpoint(journal_path, &record) == 0 &&
+                 record.input_size == (uint64_t)input_stat.st_size &&
+                 record.input_mtime_sec == (int64_t)input_stat.st_mtim.tv_sec &&
+                 record.input_mtime_nsec == (int64_t)input_stat.st_mtim.tv_nsec &&
+                 record.bytes_done <= record.input_size &&
+                 memcmp(record.key_check, key_check, sizeof(key_check)) == 0 &&
+                 (!has_requested_iv || memcmp(record.iv, requested_iv, IV_LENGTH) == 0);
+
+    // ...and the partial output carries the same IV and at least the checkpointed bytes
+    int output_fd = -1;
+    if (resume) {
+        output_fd = open(output_path, O_RDWR | O_CLOEXEC);
+        struct stat64 output_stat;
+        unsigned char stored_iv[IV_LENGTH];
+        resume = output_fd >= 0 &&
+                 fstat64(output_fd, &output_stat) == 0 &&
+                 (uint64_t)output_stat.st_size >= IV_LENGTH + record.bytes_done &&
+                 crypto_pread_full(output_fd, stored_iv, IV_LENGTH, 0) == IV_LENGTH &&
+                 memcmp(stored_iv, record.iv, IV_LENGTH) == 0 &&
+                 ftruncate64(output_fd, (off64_t)(IV_LENGTH + record.bytes_done)) == 0;
+        if (!resume && output_fd >= 0) {
+            close(output_fd);
+            output_fd = -1;
+        }
+    }
+
+    if (!resume) {
+        memset(&record, 0, sizeof(record));
+        memcpy(record.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        record.input_size = (uint64_t)input_stat.st_size;
+        record.input_mtime_sec = (int64_t)input_stat.st_mtim.tv_sec;
+        record.input_mtime_nsec = (int64_t)input_stat.st_mtim.tv_nsec;
+        memcpy(record.key_check, key_check, sizeof(key_check));
+
+        // Prepare or generate IV
+        if (has_requested_iv) {
+            memcpy(record.iv, requested_iv, IV_LENGTH);
+        } else if (RAND_bytes(record.iv, IV_LENGTH) != 1) {
+            OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+            close(input_fd);
+            return -2;
+        }
+
+        output_fd = open(output_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (output_fd < 0) {
+            OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+            close(input_fd);
+            return -1;
+        }
+        if (crypto_write_full(output_fd, record.iv, IV_LENGTH) != 0) {
+            OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+            close(input_fd);
+            close(output_fd);
+            return -7;
+        }
+        if (write_checkpoint(journal_path, &record) != 0) {
+            OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+            close(input_fd);
+            close(output_fd);
+            return -9;
+        }
+    }
+
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = NULL;
+    unsigned char* in_buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    unsigned char* out_buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE + EVP_MAX_BLOCK_LENGTH);
+    if (!in_buffer || !out_buffer) {
+        result = -3;
+        goto done;
+    }
+
+    // Position input, output and the CTR counter at the checkpoint
+    if (lseek64(input_fd, (off64_t)record.bytes_done, SEEK_SET) < 0 ||
+        lseek64(output_fd, (off64_t)(IV_LENGTH + record.bytes_done), SEEK_SET) < 0) {
+        result = -1;
+        goto done;
+    }
+    ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        result = -3;
+        goto done;
+    }
+    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, record.iv) != 1 ||
+        crypto_ctr_seek(ctx, record.iv, record.bytes_done) != 0) {
+        result = -4;
+        goto done;
+    }
+
+    long long since_checkpoint = 0;
+    ssize_t bytes_read;
+    int out_length;
+    while ((bytes_read = crypto_read_full(input_fd, in_buffer, BUFFER_SIZE)) > 0) {
+        int64_t started = crypto_stats_clock();
+        CRYPTO_TRACE_BEGIN("aes_crypt");
+        int updated = EVP_EncryptUpdate(ctx, out_buffer, &out_length, in_buffer, (int)bytes_read) == 1;
+        CRYPTO_TRACE_END();
+        if (!updated) {
+            result = -5;
+            goto done;
+        }
+        crypto_stats_crypto(started, (size_t)bytes_read);
+        if (crypto_write_full(output_fd, out_buffer, (size_t)out_length) != 0) {
+            result = -7;
+            goto done;
+        }
+        record.bytes_done += (uint64_t)bytes_read;
+        since_checkpoint += bytes_read;
+
+        // Only checkpoint bytes that are durably on disk
+        if (since_checkpoint >= CHECKPOINT_INTERVAL) {
+            if (crypto_fdatasync(output_fd) != 0 || write_checkpoint(journal_path, &record) != 0) {
+                result = -9;
+                goto done;
+            }
+            since_checkpoint = 0;
+        }
+    }
+    if (bytes_read < 0) {
+        result = -1;
+        goto done;
+    }
+
+    // Finalize encryption
+    if (EVP_EncryptFinal_ex(ctx, out_buffer, &out_length) != 1) {
+        result = -6;
+        goto done;
+    }
+    if (out_length > 0 && crypto_write_full(output_fd, out_buffer, (size_t)out_length) != 0) {
+        result = -7;
+        goto done;
+    }
+    if (crypto_fsync(output_fd) != 0) {
+        result = -7;
+        goto done;
+    }
+    unlink(journal_path);
+
+done:
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+    EVP_CIPHER_CTX_free(ctx);
+    crypto_mem_release(in_buffer, BUFFER_SIZE);
+    crypto_mem_release(out_buffer, BUFFER_SIZE + EVP_MAX_BLOCK_LENGTH);
+    close(input_fd);
+    close(output_fd);
+    return result;
+}
+
+int aes_encrypt_file_resumable(const char* input_path, const char* output_path, const char* key, const char* iv_string) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = encrypt_file_resumable(input_path, output_path, key, iv_string);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, crypto_metrics_file_size(output_path), result);
+}
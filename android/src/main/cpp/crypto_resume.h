@@ -0,0 +1,20 @@
+#ifndef CRYPTO_RESUME_H
+#define CRYPTO_RESUME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Resumable AES-256-CTR encryption. Progress is checkpointed to
+// "<output_path>.ckpt" (bytes done, IV, input size and mtime); when called
+// again after an interruption with the same input, output and key, the
+// partial output is validated and encryption continues from the last
+// checkpoint. The journal is removed once the output is complete.
+// The output format is identical to aes_encrypt_file_with_iv.
+int aes_encrypt_file_resumable(const char* input_path, const char* output_path, const char* key, const char* iv_string);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_RESUME_H
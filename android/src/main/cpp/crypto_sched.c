@@ -0,0 +1,160 @@
+#include "crypto_sched.h"
+#include "crypto_internal.h"
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+// Longest pause per read or write. Bounded so a background thread holding a
+// lock a foreground operation needs still makes progress
+#define MAX_PAUSE_NS (250 * 1000000LL)
+#define BURST_SECONDS 0.1
+
+static __thread int thread_priority = AES_PRIORITY_FOREGROUND;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t foreground_done = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t activity = PTHREAD_COND_INITIALIZER;
+static int active_foreground;
+static int active_background;
+static uint64_t started_operations;  // Of either priority, ever
+static int64_t last_activity;        // When one last started or ended
+
+// Token bucket; tokens may go negative, the debt is paid by sleeping
+static int64_t rate;
+static double tokens;
+static int64_t refilled_at;
+static int max_threads;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// CLOCK_REALTIME deadline ns from now, for pthread_cond_timedwait
+static void deadline_after(int64_t ns, struct timespec* deadline) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += (time_t)(ns / 1000000000LL);
+    deadline->tv_nsec += (long)(ns % 1000000000LL);
+    deadline->tv_sec += deadline->tv_nsec / 1000000000L;
+    deadline->tv_nsec %= 1000000000L;
+}
+
+void aes_sched_set_thread_priority(int priority) {
+    thread_priority = priority == AES_PRIORITY_BACKGROUND ? AES_PRIORITY_BACKGROUND : AES_PRIORITY_FOREGROUND;
+}
+
+void aes_sched_set_background_budget(int64_t bytes_per_second, int threads) {
+    pthread_mutex_lock(&lock);
+    rate = bytes_per_second > 0 ? bytes_per_second : 0;
+    tokens = 0;
+    refilled_at = now_ns();
+    __atomic_store_n(&max_threads, threads > 0 ? threads : 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&lock);
+}
+
+int crypto_sched_background(void) {
+    return thread_priority == AES_PRIORITY_BACKGROUND;
+}
+
+int crypto_sched_threads(int threads) {
+    if (!crypto_sched_background()) return threads;
+    int limit = __atomic_load_n(&max_threads, __ATOMIC_RELAXED);
+    return limit > 0 && (threads <= 0 || threads > limit) ? limit : threads;
+}
+
+void crypto_sched_begin(void) {
+    pthread_mutex_lock(&lock);
+    if (crypto_sched_background()) {
+        active_background++;
+    } else {
+        active_foreground++;
+    }
+    started_operations++;
+    last_activity = now_ns();
+    pthread_cond_broadcast(&activity);
+    pthread_mutex_unlock(&lock);
+}
+
+void crypto_sched_end(void) {
+    pthread_mutex_lock(&lock);
+    if (crypto_sched_background()) {
+        if (active_background > 0) active_background--;
+    } else if (--active_foreground == 0) {
+        pthread_cond_broadcast(&foreground_done);
+    }
+    last_activity = now_ns();
+    pthread_cond_broadcast(&activity);
+    pthread_mutex_unlock(&lock);
+}
+
+uint64_t crypto_sched_wait_idle(int64_t quiet_ns, int64_t timeout_ns) {
+    int64_t give_up = now_ns() + timeout_ns;
+    uint64_t mark = 0;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        int64_t now = now_ns();
+        int busy = active_foreground > 0 || active_background > 0;
+        int64_t quiet_at = last_activity + quiet_ns;
+        if (!busy && now >= quiet_at) {
+            mark = started_operations + 1;
+            break;
+        }
+        if (now >= give_up) break;
+        struct timespec deadline;
+        deadline_after((busy || quiet_at > give_up ? give_up : quiet_at) - now, &deadline);
+        pthread_cond_timedwait(&activity, &lock, &deadline);
+    }
+    pthread_mutex_unlock(&lock);
+    return mark;
+}
+
+int crypto_sched_idle_since(uint64_t mark) {
+    pthread_mutex_lock(&lock);
+    int idle = mark == started_operations + 1 && active_foreground == 0 && active_background == 0;
+    pthread_mutex_unlock(&lock);
+    return idle;
+}
+
+void crypto_sched_charge(size_t bytes) {
+    pthread_mutex_lock(&lock);
+    if (rate > 0) {
+        int64_t now = now_ns();
+        double burst = (double)rate * BURST_SECONDS;
+        tokens += (double)(now - refilled_at) * (double)rate / 1e9;
+        if (tokens > burst) tokens = burst;
+        refilled_at = now;
+        tokens -= (double)bytes;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void crypto_sched_io(size_t bytes) {
+    if (!crypto_sched_background()) return;
+
+    int64_t wait_ns = 0;
+    pthread_mutex_lock(&lock);
+    if (active_foreground > 0) {
+        struct timespec deadline;
+        deadline_after(MAX_PAUSE_NS, &deadline);
+        while (active_foreground > 0 &&
+               pthread_cond_timedwait(&foreground_done, &lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+    if (rate > 0) {
+        int64_t now = now_ns();
+        double burst = (double)rate * BURST_SECONDS;
+        tokens += (double)(now - refilled_at) * (double)rate / 1e9;
+        if (tokens > burst) tokens = burst;
+        refilled_at = now;
+        tokens -= (double)bytes;
+        if (tokens < 0) wait_ns = (int64_t)(-tokens * 1e9 / (double)rate);
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (wait_ns > 0) {
+        struct timespec pause = { (time_t)(wait_ns / 1000000000LL), (long)(wait_ns % 1000000000LL) };
+        while (nanosleep(&pause, &pause) != 0 && errno == EINTR) {
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef CRYPTO_SCHED_H
+#define CRYPTO_SCHED_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Foreground / background scheduling for the native engine. Every thread is
+// foreground unless marked otherwise. Background threads yield at each
+// buffer-sized read or write while any foreground operation is running, so
+// a tap that needs one small file decrypted is not queued behind a bulk
+// job's I/O, and their reads and writes draw from a shared token bucket.
+
+#define AES_PRIORITY_FOREGROUND 0
+#define AES_PRIORITY_BACKGROUND 1
+
+// Mark the calling thread (and the workers its operations start)
+void aes_sched_set_thread_priority(int priority);
+
+// Budget shared by all background work: read + write bytes per second and
+// worker threads per operation; 0 means unlimited (the default)
+void aes_sched_set_background_budget(int64_t bytes_per_second, int max_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_SCHED_H
@@ -0,0 +1,412 @@
+#include "crypto_segment.h"
+#include "crypto_internal.h"
+#include "crypto_tune.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#define SEGMENT_MAX_COUNT 100000  // Five-digit part numbers
+#define SEGMENT_NAME_MAX 255
+
+static const char MANIFEST_MAGIC[] = "AESSEG1";
+
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+    unsigned char digest[SHA256_DIGEST_LENGTH];  // Of the whole part file, header included
+    char name[SEGMENT_NAME_MAX + 1];
+} segment_entry;
+
+typedef struct {
+    int fd;                            // Plaintext: input when encrypting, output when joining
+    unsigned char key[AES_KEY_LENGTH];
+    unsigned char iv[IV_LENGTH];       // Counter base shared by all parts
+    uint64_t segment_size;
+    uint64_t plaintext_size;
+    char directory[PATH_MAX];          // Where the parts live, "" or ending in '/'
+    segment_entry* entries;
+    uint32_t count;
+} segment_job;
+
+static int segment_path(const segment_job* job, const segment_entry* entry, char* path, size_t size) {
+    return snprintf(path, size, "%s%s", job->directory, entry->name) < (int)size ? 0 : -1;
+}
+
+static int set_directory(segment_job* job, const char* path) {
+    const char* slash = strrchr(path, '/');
+    size_t length = slash ? (size_t)(slash - path) + 1 : 0;
+    if (length >= sizeof(job->directory)) return -1;
+    memcpy(job->directory, path, length);
+    job->directory[length] = '\0';
+    return 0;
+}
+
+static int encrypt_segment(segment_job* job, segment_entry* entry, unsigned char* buffer) {
+    char path[PATH_MAX];
+    char temp_path[PATH_MAX];
+    if (segment_path(job, entry, path, sizeof(path)) != 0 ||
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return -1;
+    }
+
+    // A standalone AESFILE1 file, its counter starting at the part's offset
+    unsigned char iv[IV_LENGTH];
+    unsigned char header[AES_FILE_HEADER_SIZE];
+    crypto_ctr_iv_at(job->iv, entry->offset / IV_LENGTH, iv);
+    crypto_header_init(header, entry->length, iv);
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) return -1;
+
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    EVP_MD_CTX* digest = EVP_MD_CTX_new();
+    if (!ctx || !digest) {
+        result = -3;
+    } else if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, job->key, iv) != 1 ||
+               EVP_DigestInit_ex(digest, EVP_sha256(), NULL) != 1) {
+        result = -4;
+    } else if (EVP_DigestUpdate(digest, header, sizeof(header)) != 1) {
+        result = -5;
+    } else if (crypto_write_full(fd, header, sizeof(header)) != 0) {
+        result = -7;
+    }
+
+    uint64_t position = 0;
+    while (result == 0 && position < entry->length) {
+        size_t length = entry->length - position < BUFFER_SIZE ? (size_t)(entry->length - position) : BUFFER_SIZE;
+        int out_length;
+        if (crypto_pread_full(job->fd, buffer, length, (off64_t)(entry->offset + position)) != (ssize_t)length) {
+            result = -1;
+        } else if (EVP_EncryptUpdate(ctx, buffer, &out_length, buffer, (int)length) != 1 ||
+                   EVP_DigestUpdate(digest, buffer, length) != 1) {
+            result = -5;
+        } else if (crypto_write_full(fd, buffer, length) != 0) {
+            result = -7;
+        }
+        position += length;
+    }
+    if (result == 0 && EVP_DigestFinal_ex(digest, entry->digest, NULL) != 1) {
+        result = -6;
+    }
+
+    // Publish under the final name only once complete
+    if (close(fd) != 0 && result == 0) {
+        result = -7;
+    }
+    if (result == 0 && rename(temp_path, path) != 0) {
+        result = -7;
+    }
+    if (result != 0) {
+        unlink(temp_path);
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_MD_CTX_free(digest);
+    return result;
+}
+
+static int decrypt_segment(segment_job* job, const segment_entry* entry, unsigned char* buffer) {
+    char path[PATH_MAX];
+    if (segment_path(job, entry, path, sizeof(path)) != 0) return -1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -2;
+
+    int result = 0;
+    crypto_stream_layout layout;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    EVP_MD_CTX* digest = EVP_MD_CTX_new();
+    if (!ctx || !digest) {
+        result = -3;
+    } else if (crypto_read_stream_layout(fd, &layout) != 0 || !layout.has_header ||
+               layout.body_length != entry->length || layout.data_offset > BUFFER_SIZE) {
+        result = -2;
+    } else if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, job->key, layout.iv) != 1 ||
+               EVP_DigestInit_ex(digest, EVP_sha256(), NULL) != 1) {
+        result = -4;
+    } else if (crypto_pread_full(fd, buffer, (size_t)layout.data_offset, 0) != (ssize_t)layout.data_offset) {
+        result = -1;
+    } else if (EVP_DigestUpdate(digest, buffer, (size_t)layout.data_offset) != 1) {
+        result = -5;
+    }
+
+    // Digest the ciphertext as it goes by, then decrypt it in place
+    uint64_t position = 0;
+    while (result == 0 && position < entry->length) {
+        size_t length = entry->length - position < BUFFER_SIZE ? (size_t)(entry->length - position) : BUFFER_SIZE;
+        int out_length;
+        if (crypto_pread_full(fd, buffer, length, layout.data_offset + (off64_t)position) != (ssize_t)length) {
+            result = -1;
+        } else if (EVP_DigestUpdate(digest, buffer, length) != 1 ||
+                   EVP_DecryptUpdate(ctx, buffer, &out_length, buffer, (int)length) != 1) {
+            result = -5;
+        } else if (crypto_pwrite_full(job->fd, buffer, length, (off64_t)(entry->offset + position)) != 0) {
+            result = -7;
+        }
+        position += length;
+    }
+
+    unsigned char actual[SHA256_DIGEST_LENGTH];
+    if (result == 0 && EVP_DigestFinal_ex(digest, actual, NULL) != 1) {
+        result = -6;
+    }
+    if (result == 0 && CRYPTO_memcmp(actual, entry->digest, sizeof(actual)) != 0) {
+        result = -2;
+    }
+
+    close(fd);
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_MD_CTX_free(digest);
+    return result;
+}
+
+// Workers: every part starting inside plaintext range [start, end). Ranges
+// are aligned to the segment size, so each part belongs to exactly one.
+static int encrypt_range(void* arg, uint64_t start, uint64_t end) {
+    segment_job* job = (segment_job*)arg;
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    if (!buffer) return -3;
+
+    int result = 0;
+    for (uint32_t index = (uint32_t)(start / job->segment_size);
+         result == 0 && index < job->count && job->entries[index].offset < end; index++) {
+        result = encrypt_segment(job, &job->entries[index], buffer);
+    }
+
+    OPENSSL_cleanse(buffer, BUFFER_SIZE);
+    crypto_mem_release(buffer, BUFFER_SIZE);
+    return result;
+}
+
+static int decrypt_range(void* arg, uint64_t start, uint64_t end) {
+    segment_job* job = (segment_job*)arg;
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    if (!buffer) return -3;
+
+    int result = 0;
+    for (uint32_t index = (uint32_t)(start / job->segment_size);
+         result == 0 && index < job->count && job->entries[index].offset < end; index++) {
+        result = decrypt_segment(job, &job->entries[index], buffer);
+    }
+
+    OPENSSL_cleanse(buffer, BUFFER_SIZE);
+    crypto_mem_release(buffer, BUFFER_SIZE);
+    return result;
+}
+
+static uint32_t segment_count(uint64_t plaintext_size, uint64_t segment_size) {
+    // An empty input still produces one (empty) part
+    uint64_t count = plaintext_size == 0 ? 1 : (plaintext_size + segment_size - 1) / segment_size;
+    return count > SEGMENT_MAX_COUNT ? 0 : (uint32_t)count;
+}
+
+static int write_manifest(const char* output_prefix, const segment_job* job) {
+    char path[PATH_MAX];
+    char temp_path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s.manifest", output_prefix) >= (int)sizeof(path) ||
+        snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return -1;
+    }
+
+    FILE* file = fopen(temp_path, "w");
+    if (!file) return -1;
+
+    fprintf(file, "%s\nsegment_size %llu\nplaintext_size %llu\nsegments %u\n", MANIFEST_MAGIC,
+            (unsigned long long)job->segment_size, (unsigned long long)job->plaintext_size, job->count);
+    for (uint32_t i = 0; i < job->count; i++) {
+        const segment_entry* entry = &job->entries[i];
+        char hex[SHA256_DIGEST_LENGTH * 2 + 1];
+        for (int j = 0; j < SHA256_DIGEST_LENGTH; j++) {
+            snprintf(hex + j * 2, 3, "%02x", entry->digest[j]);
+        }
+        fprintf(file, "%u %llu %llu %s %s\n", i, (unsigned long long)entry->offset,
+                (unsigned long long)entry->length, hex, entry->name);
+    }
+
+    int ok = !ferror(file) && fflush(file) == 0 && crypto_fsync(fileno(file)) == 0;
+    if (fclose(file) != 0) ok = 0;
+    if (!ok || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return -7;
+    }
+    return 0;
+}
+
+static int read_manifest(const char* manifest_path, segment_job* job) {
+    FILE* file = fopen(manifest_path, "r");
+    if (!file) return -1;
+
+    char magic[16];
+    unsigned long long segment_size = 0;
+    unsigned long long plaintext_size = 0;
+    unsigned int count = 0;
+    int result = 0;
+    if (fscanf(file, "%15s segment_size %llu plaintext_size %llu segments %u",
+               magic, &segment_size, &plaintext_size, &count) != 4 ||
+        strcmp(magic, MANIFEST_MAGIC) != 0 ||
+        segment_size == 0 || segment_size % IV_LENGTH != 0 ||
+        count != segment_count(plaintext_size, segment_size)) {
+        result = -2;
+    } else if (!(job->entries = (segment_entry*)calloc(count, sizeof(segment_entry)))) {
+        result = -3;
+    }
+    job->segment_size = segment_size;
+    job->plaintext_size = plaintext_size;
+    job->count = count;
+
+    // Parts must tile the plaintext exactly, in order
+    for (uint32_t i = 0; result == 0 && i < count; i++) {
+        segment_entry* entry = &job->entries[i];
+        unsigned int index;
+        unsigned long long offset, length;
+        char hex[SHA256_DIGEST_LENGTH * 2 + 1];
+        // The name is the rest of the line after a single space, since
+        // output prefixes ("My Video.mp4") may contain spaces
+        char line[SEGMENT_NAME_MAX + 2];
+        size_t name_length = 0;
+        if (fscanf(file, "%u %llu %llu %64s", &index, &offset, &length, hex) != 4 || fgetc(file) != ' ' ||
+            !fgets(line, sizeof(line), file) ||
+            (name_length = strcspn(line, "\n")) == 0 || line[name_length] != '\n') {
+            result = -2;
+            break;
+        }
+        memcpy(entry->name, line, name_length);
+        entry->name[name_length] = '\0';
+        if (index != i || offset != (unsigned long long)i * segment_size ||
+            length != (i + 1 < count ? segment_size : plaintext_size - offset) ||
+            strlen(hex) != sizeof(hex) - 1 || strchr(entry->name, '/') != NULL) {
+            result = -2;
+            break;
+        }
+        for (int j = 0; j < SHA256_DIGEST_LENGTH; j++) {
+            if (sscanf(hex + j * 2, "%2hhx", &entry->digest[j]) != 1) result = -2;
+        }
+        entry->offset = offset;
+        entry->length = length;
+    }
+
+    fclose(file);
+    return result;
+}
+
+// Worker count when the caller left it to the tuning of the parts' filesystem
+static int tuned_threads(int threads, const segment_job* job) {
+    if (threads > 0) return threads;
+    aes_tune_profile profile;
+    aes_tune_effective(job->directory[0] ? job->directory : ".", &profile);
+    return profile.threads;
+}
+
+static int segment_encrypt_file(const char* input_path, const char* output_prefix, const char* key,
+                                int64_t segment_size, int threads) {
+    segment_job job;
+    memset(&job, 0, sizeof(job));
+    if (segment_size <= 0) segment_size = AES_SEGMENT_DEFAULT_SIZE;
+    job.segment_size = ((uint64_t)segment_size + IV_LENGTH - 1) / IV_LENGTH * IV_LENGTH;
+
+    job.fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    struct stat64 st;
+    if (job.fd < 0 || fstat64(job.fd, &st) != 0 || set_directory(&job, output_prefix) != 0) {
+        if (job.fd >= 0) close(job.fd);
+        return -1;
+    }
+    job.plaintext_size = (uint64_t)st.st_size;
+    job.count = segment_count(job.plaintext_size, job.segment_size);
+
+    int result = 0;
+    const char* base = output_prefix + strlen(job.directory);
+    if (job.count == 0) {
+        result = -2;
+    } else if (strchr(base, '\n') != NULL) {
+        // Part names are written one per manifest line
+        result = -1;
+    } else if (!(job.entries = (segment_entry*)calloc(job.count, sizeof(segment_entry)))) {
+        result = -3;
+    } else if (RAND_bytes(job.iv, IV_LENGTH) != 1) {
+        result = -2;
+    }
+    for (uint32_t i = 0; result == 0 && i < job.count; i++) {
+        segment_entry* entry = &job.entries[i];
+        entry->offset = (uint64_t)i * job.segment_size;
+        entry->length = job.plaintext_size - entry->offset < job.segment_size
+                            ? job.plaintext_size - entry->offset : job.segment_size;
+        if (snprintf(entry->name, sizeof(entry->name), "%s.part%05u", base, i) >= (int)sizeof(entry->name)) {
+            result = -1;
+        }
+    }
+
+    // Parts written before a failure are left in place; without the
+    // manifest the set is incomplete and should be discarded
+    if (result == 0) {
+        crypto_prepare_key(key, job.key);
+        uint64_t total = job.plaintext_size > 0 ? job.plaintext_size : 1;
+        result = crypto_parallel_ranges(total, tuned_threads(threads, &job), job.segment_size, encrypt_range, &job);
+    }
+    if (result == 0) {
+        result = write_manifest(output_prefix, &job);
+    }
+
+    OPENSSL_cleanse(job.key, sizeof(job.key));
+    free(job.entries);
+    close(job.fd);
+    return result == 0 ? (int)job.count : result;
+}
+
+int aes_segment_encrypt_file(const char* input_path, const char* output_prefix, const char* key,
+                             int64_t segment_size, int threads) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = segment_encrypt_file(input_path, output_prefix, key, segment_size, threads);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, crypto_metrics_file_size(input_path), result);
+}
+
+static int segment_join_file(const char* manifest_path, const char* output_path, const char* key, int threads) {
+    segment_job job;
+    memset(&job, 0, sizeof(job));
+    job.fd = -1;
+
+    int result = read_manifest(manifest_path, &job);
+    if (result == 0 && set_directory(&job, manifest_path) != 0) {
+        result = -1;
+    }
+    if (result == 0) {
+        job.fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (job.fd < 0) {
+            result = -1;
+        } else if (ftruncate64(job.fd, (off64_t)job.plaintext_size) != 0) {
+            result = -7;
+        }
+    }
+    if (result == 0) {
+        crypto_prepare_key(key, job.key);
+        uint64_t total = job.plaintext_size > 0 ? job.plaintext_size : 1;
+        result = crypto_parallel_ranges(total, tuned_threads(threads, &job), job.segment_size, decrypt_range, &job);
+    }
+
+    if (job.fd >= 0) {
+        if (close(job.fd) != 0 && result == 0) {
+            result = -7;
+        }
+        // Don't leave plaintext from a partial or tampered set behind
+        if (result != 0) {
+            unlink(output_path);
+        }
+    }
+    OPENSSL_cleanse(job.key, sizeof(job.key));
+    free(job.entries);
+    return result;
+}
+
+int aes_segment_join_file(const char* manifest_path, const char* output_path, const char* key, int threads) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int result = segment_join_file(manifest_path, output_path, key, threads);
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, crypto_metrics_file_size(output_path), result);
+}
@@ -0,0 +1,44 @@
+#ifndef CRYPTO_SEGMENT_H
+#define CRYPTO_SEGMENT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_SEGMENT_DEFAULT_SIZE (64LL * 1024 * 1024)
+
+// Segmented output for multipart uploads: the ciphertext is written directly
+// as "<output_prefix>.part00000", ".part00001", ... of segment_size plaintext
+// bytes each, encrypted in parallel. Every segment is a standalone AESFILE1
+// file whose IV is the shared counter advanced to the segment's offset, so
+// aes_decrypt_file opens any one of them on its own. A part appears under its
+// final name only once complete, so an uploader can start on it right away.
+//
+// "<output_prefix>.manifest" is written last, one text line per segment:
+//   AESSEG1
+//   segment_size <bytes>
+//   plaintext_size <bytes>
+//   segments <count>
+//   <index> <offset> <length> <sha256 of the part file, hex> <part file name>
+// The name runs to the end of the line, so it may contain spaces; a prefix
+// containing a newline is rejected with -1.
+
+// Pass 0 as segment_size for the default (rounded up to a multiple of 16) and
+// threads <= 0 for the parts filesystem's tuned count (by default one thread
+// per CPU). Returns the number of segments (>= 1)
+// or a negative error.
+int aes_segment_encrypt_file(const char* input_path, const char* output_prefix, const char* key,
+                             int64_t segment_size, int threads);
+
+// Decrypt the segments listed in a manifest (resolved next to it) back into
+// one file, in parallel. Each part is checked against its manifest digest;
+// a missing, resized or altered part returns -2 and removes output_path.
+int aes_segment_join_file(const char* manifest_path, const char* output_path, const char* key, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_SEGMENT_H
@@ -0,0 +1,360 @@
+#include "crypto_sparse.h"
+#include "crypto_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define SPARSE_VERSION 1
+#define SPARSE_BLOCK_SIZE 4096     // Zero detection granularity, one filesystem block
+#define SPARSE_DATA_OFFSET 4096    // Body is block aligned so plaintext holes map onto output holes
+
+static const char SPARSE_MAGIC[8] = { 'A', 'E', 'S', 'S', 'P', 'R', 'S', '1' };
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t plaintext_size;
+    uint64_t data_offset;
+    uint64_t map_offset;       // Hole map, right after the body
+    uint64_t hole_count;
+    unsigned char iv[IV_LENGTH];
+} sparse_header;
+
+typedef struct {
+    uint64_t offset;           // Plaintext offset
+    uint64_t length;
+} sparse_hole;
+
+_Static_assert(sizeof(sparse_header) == 64, "sparse header layout");
+_Static_assert(sizeof(sparse_hole) == 16, "sparse hole map layout");
+
+typedef struct {
+    sparse_hole* holes;
+    uint64_t count;
+    uint64_t capacity;
+} hole_map;
+
+int crypto_sparse_probe(const unsigned char* head, size_t length, aes_file_metadata* info) {
+    if (length < sizeof(SPARSE_MAGIC) || memcmp(head, SPARSE_MAGIC, sizeof(SPARSE_MAGIC)) != 0) {
+        return -1;
+    }
+    info->format = AES_FILE_FORMAT_SPARSE;
+    info->algorithm = AES_ALGORITHM_AES_256_CTR;
+    info->header_size = SPARSE_DATA_OFFSET;
+    if (length >= sizeof(sparse_header)) {
+        sparse_header header;
+        memcpy(&header, head, sizeof(header));
+        info->version = header.version;
+        info->header_size = (uint32_t)header.data_offset;
+        info->plaintext_size = (int64_t)header.plaintext_size;
+        info->has_iv = 1;
+        memcpy(info->iv, header.iv, IV_LENGTH);
+    }
+    return 0;
+}
+
+// A block is zero if its first byte is and it equals itself shifted by one;
+// bionic's memcmp is vectorised, so this runs at memory bandwidth
+static int is_zero(const unsigned char* data, size_t length) {
+    return length == 0 || (data[0] == 0 && memcmp(data, data + 1, length - 1) == 0);
+}
+
+static int add_hole(hole_map* map, uint64_t offset, uint64_t length) {
+    if (length == 0) return 0;
+    if (map->count > 0) {
+        sparse_hole* last = &map->holes[map->count - 1];
+        if (last->offset + last->length == offset) {
+            last->length += length;
+            return 0;
+        }
+    }
+    if (map->count == map->capacity) {
+        uint64_t capacity = map->capacity ? map->capacity * 2 : 64;
+        sparse_hole* holes = (sparse_hole*)realloc(map->holes, capacity * sizeof(sparse_hole));
+        if (!holes) return -3;
+        map->holes = holes;
+        map->capacity = capacity;
+    }
+    map->holes[map->count].offset = offset;
+    map->holes[map->count].length = length;
+    map->count++;
+    return 0;
+}
+
+// Encrypt one run of data blocks at its own counter position
+static int encrypt_run(EVP_CIPHER_CTX* ctx, const unsigned char* iv, unsigned char* data, size_t length,
+                       uint64_t position, int output_fd) {
+    int out_length;
+    if (crypto_ctr_seek(ctx, iv, position) != 0 ||
+        EVP_EncryptUpdate(ctx, data, &out_length, data, (int)length) != 1) {
+        return -5;
+    }
+    return crypto_pwrite_full(output_fd, data, length, (off64_t)(SPARSE_DATA_OFFSET + position)) == 0 ? 0 : -7;
+}
+
+// Read a data extent and encrypt it, turning all-zero blocks into holes
+static int encrypt_extent(int input_fd, int output_fd, EVP_CIPHER_CTX* ctx, const unsigned char* iv,
+                          unsigned char* buffer, uint64_t start, uint64_t end, hole_map* map) {
+    uint64_t position = start;
+    while (position < end) {
+        size_t length = end - position < BUFFER_SIZE ? (size_t)(end - position) : BUFFER_SIZE;
+        if (crypto_pread_full(input_fd, buffer, length, (off64_t)position) != (ssize_t)length) {
+            return -1;
+        }
+
+        size_t run_start = 0;
+        size_t offset = 0;
+        while (offset < length) {
+            // Blocks are aligned to absolute plaintext offsets
+            size_t block = SPARSE_BLOCK_SIZE - (size_t)((position + offset) % SPARSE_BLOCK_SIZE);
+            if (block > length - offset) block = length - offset;
+            if (is_zero(buffer + offset, block)) {
+                int result = 0;
+                if (offset > run_start) {
+                    result = encrypt_run(ctx, iv, buffer + run_start, offset - run_start, position + run_start, output_fd);
+                }
+                if (result == 0) {
+                    result = add_hole(map, position + offset, block);
+                }
+                if (result != 0) return result;
+                run_start = offset + block;
+            }
+            offset += block;
+        }
+        if (length > run_start) {
+            int result = encrypt_run(ctx, iv, buffer + run_start, length - run_start, position + run_start, output_fd);
+            if (result != 0) return result;
+        }
+        position += length;
+    }
+    return 0;
+}
+
+static int sparse_encrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    struct stat64 st;
+    if (input_fd < 0 || fstat64(input_fd, &st) != 0) {
+        if (input_fd >= 0) close(input_fd);
+        return -1;
+    }
+    int output_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (output_fd < 0) {
+        close(input_fd);
+        return -1;
+    }
+
+    sparse_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SPARSE_MAGIC, sizeof(SPARSE_MAGIC));
+    header.version = SPARSE_VERSION;
+    header.block_size = SPARSE_BLOCK_SIZE;
+    header.plaintext_size = (uint64_t)st.st_size;
+    header.data_offset = SPARSE_DATA_OFFSET;
+
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+
+    hole_map map;
+    memset(&map, 0, sizeof(map));
+    int result = 0;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    if (!ctx || !buffer) {
+        result = -3;
+    } else if (RAND_bytes(header.iv, IV_LENGTH) != 1) {
+        result = -2;
+    } else if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, header.iv) != 1) {
+        result = -4;
+    }
+
+    // Walk the data extents; unallocated ranges are never read
+    uint64_t position = 0;
+    while (result == 0 && position < header.plaintext_size) {
+        off64_t data = lseek64(input_fd, (off64_t)position, SEEK_DATA);
+        if (data < 0) {
+            // ENXIO: only a hole is left. Anything else: no SEEK_DATA here, scan it all
+            data = errno == ENXIO ? (off64_t)header.plaintext_size : (off64_t)position;
+        }
+        off64_t hole = data < (off64_t)header.plaintext_size ? lseek64(input_fd, data, SEEK_HOLE) : data;
+        if (hole < 0 || (uint64_t)hole > header.plaintext_size) {
+            hole = (off64_t)header.plaintext_size;
+        }
+        result = add_hole(&map, position, (uint64_t)data - position);
+        if (result == 0) {
+            result = encrypt_extent(input_fd, output_fd, ctx, header.iv, buffer, (uint64_t)data, (uint64_t)hole, &map);
+        }
+        position = (uint64_t)hole;
+    }
+
+    // Holes in the body are simply never written; the map follows it
+    header.map_offset = header.data_offset + header.plaintext_size;
+    header.hole_count = map.count;
+    if (result == 0 &&
+        (ftruncate64(output_fd, (off64_t)header.map_offset) != 0 ||
+         crypto_pwrite_full(output_fd, map.holes, (size_t)map.count * sizeof(sparse_hole), (off64_t)header.map_offset) != 0 ||
+         crypto_pwrite_full(output_fd, &header, sizeof(header), 0) != 0)) {
+        result = -7;
+    }
+
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+    if (buffer) OPENSSL_cleanse(buffer, BUFFER_SIZE);
+    EVP_CIPHER_CTX_free(ctx);
+    crypto_mem_release(buffer, BUFFER_SIZE);
+    free(map.holes);
+    close(input_fd);
+    close(output_fd);
+    return result;
+}
+
+int aes_sparse_encrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_ENCRYPT);
+    int result = sparse_encrypt_file(input_path, output_path, key);
+    return crypto_metrics_end(AES_METRIC_ENCRYPT, started, crypto_metrics_file_size(output_path), result);
+}
+
+static int read_map(int fd, sparse_header* header, sparse_hole** holes) {
+    struct stat64 st;
+    if (fstat64(fd, &st) != 0 ||
+        crypto_pread_full(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header)) {
+        return -1;
+    }
+    if (memcmp(header->magic, SPARSE_MAGIC, sizeof(SPARSE_MAGIC)) != 0) return -12;
+    uint64_t map_size = header->hole_count * sizeof(sparse_hole);
+    if (header->version != SPARSE_VERSION ||
+        header->data_offset < sizeof(*header) ||
+        header->map_offset != header->data_offset + header->plaintext_size ||
+        header->hole_count > (uint64_t)st.st_size / sizeof(sparse_hole) ||
+        header->map_offset + map_size != (uint64_t)st.st_size) {
+        return -2;
+    }
+
+    sparse_hole* list = (sparse_hole*)malloc(map_size ? map_size : 1);
+    if (!list) return -3;
+    if (crypto_pread_full(fd, list, map_size, (off64_t)header->map_offset) != (ssize_t)map_size) {
+        free(list);
+        return -1;
+    }
+
+    // Sorted, disjoint and inside the plaintext
+    uint64_t end = 0;
+    for (uint64_t i = 0; i < header->hole_count; i++) {
+        if (list[i].offset < end || list[i].length > header->plaintext_size ||
+            list[i].offset > header->plaintext_size - list[i].length) {
+            free(list);
+            return -2;
+        }
+        end = list[i].offset + list[i].length;
+    }
+    *holes = list;
+    return 0;
+}
+
+int crypto_sparse_walk(int fd, const char* key, crypto_sparse_sink sink, void* arg) {
+    sparse_header header;
+    sparse_hole* holes = NULL;
+    int result = read_map(fd, &header, &holes);
+    if (result != 0) return result;
+
+    unsigned char prepared_key[AES_KEY_LENGTH];
+    crypto_prepare_key(key, prepared_key);
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    if (!ctx || !buffer) {
+        result = -3;
+    } else if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, prepared_key, header.iv) != 1) {
+        result = -4;
+    }
+
+    // Decrypt the gaps between holes, each at its own counter position
+    uint64_t position = 0;
+    for (uint64_t i = 0; result == 0 && i <= header.hole_count; i++) {
+        uint64_t end = i < header.hole_count ? holes[i].offset : header.plaintext_size;
+        if (end > position && crypto_ctr_seek(ctx, header.iv, position) != 0) {
+            result = -4;
+        }
+        while (result == 0 && position < end) {
+            size_t length = end - position < BUFFER_SIZE ? (size_t)(end - position) : BUFFER_SIZE;
+            int out_length;
+            if (crypto_pread_full(fd, buffer, length, (off64_t)(header.data_offset + position)) != (ssize_t)length) {
+                result = -1;
+            } else if (EVP_DecryptUpdate(ctx, buffer, &out_length, buffer, (int)length) != 1) {
+                result = -5;
+            } else {
+                result = sink(arg, position, buffer, length);
+            }
+            position += length;
+        }
+        if (result == 0 && i < header.hole_count) {
+            result = sink(arg, holes[i].offset, NULL, holes[i].length);
+            position = holes[i].offset + holes[i].length;
+        }
+    }
+
+    OPENSSL_cleanse(prepared_key, sizeof(prepared_key));
+    if (buffer) OPENSSL_cleanse(buffer, BUFFER_SIZE);
+    EVP_CIPHER_CTX_free(ctx);
+    crypto_mem_release(buffer, BUFFER_SIZE);
+    free(holes);
+    return result;
+}
+
+// Holes come from the final ftruncate
+static int write_run(void* arg, uint64_t offset, const unsigned char* data, size_t length) {
+    if (!data) return 0;
+    return crypto_pwrite_full(*(int*)arg, data, length, (off64_t)offset) == 0 ? 0 : -7;
+}
+
+int crypto_sparse_decrypt_fd(int input_fd, int output_fd, const char* key) {
+    sparse_header header;
+    if (crypto_pread_full(input_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) return -1;
+
+    int result = crypto_sparse_walk(input_fd, key, write_run, &output_fd);
+
+    // Leave the output positioned at its end, like the sequential decoders
+    if (result == 0 &&
+        (ftruncate64(output_fd, (off64_t)header.plaintext_size) != 0 ||
+         lseek64(output_fd, (off64_t)header.plaintext_size, SEEK_SET) < 0)) {
+        result = -7;
+    }
+    return result;
+}
+
+static int sparse_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int input_fd = open(input_path, O_RDONLY | O_CLOEXEC);
+    if (input_fd < 0) return -1;
+
+    // Validate the map before creating (and truncating) the output
+    sparse_header header;
+    sparse_hole* holes = NULL;
+    int result = read_map(input_fd, &header, &holes);
+    free(holes);
+    if (result != 0) {
+        close(input_fd);
+        return result;
+    }
+
+    int output_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (output_fd < 0) {
+        close(input_fd);
+        return -1;
+    }
+
+    result = crypto_sparse_decrypt_fd(input_fd, output_fd, key);
+
+    close(input_fd);
+    close(output_fd);
+    return result;
+}
+
+int aes_sparse_decrypt_file(const char* input_path, const char* output_path, const char* key) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_DECRYPT);
+    int result = sparse_decrypt_file(input_path, output_path, key);
+    return crypto_metrics_end(AES_METRIC_DECRYPT, started, crypto_metrics_file_size(output_path), result);
+}
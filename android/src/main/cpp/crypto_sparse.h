@@ -0,0 +1,22 @@
+#ifndef CRYPTO_SPARSE_H
+#define CRYPTO_SPARSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sparse format for disk images, preallocated databases and other files with
+// large holes or zero runs. Holes (found with SEEK_DATA / SEEK_HOLE) and
+// all-zero 4KB blocks are recorded in a hole map instead of being encrypted;
+// everything else is AES-256-CTR at its plaintext offset, so holes in the
+// plaintext stay holes in the ciphertext. The header points to the map,
+// which follows the body; decryption recreates the holes.
+
+int aes_sparse_encrypt_file(const char* input_path, const char* output_path, const char* key);
+int aes_sparse_decrypt_file(const char* input_path, const char* output_path, const char* key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_SPARSE_H
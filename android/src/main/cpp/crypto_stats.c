@@ -0,0 +1,112 @@
+#include "crypto_stats.h"
+#include "crypto_internal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/auxv.h>
+#if defined(__arm__) || defined(__aarch64__)
+#include <asm/hwcap.h>
+#endif
+#include <openssl/crypto.h>
+
+typedef struct {
+    int active;
+    int64_t wall_start;
+    int64_t cpu_start;
+    aes_op_stats totals;
+} stats_state;
+
+static __thread stats_state current;
+
+static pthread_once_t backend_once = PTHREAD_ONCE_INIT;
+static char backend_name[AES_STATS_BACKEND_LENGTH];
+
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// OpenSSL picks its AES code path from the same CPU features at startup
+static void describe_backend(void) {
+    const char* path = "C";
+#if defined(__aarch64__) && defined(HWCAP_AES)
+    path = (getauxval(AT_HWCAP) & HWCAP_AES) ? "ARMv8 CE" : "NEON";
+#elif defined(__arm__) && defined(HWCAP2_AES)
+    path = (getauxval(AT_HWCAP2) & HWCAP2_AES) ? "ARMv8 CE" : "NEON";
+#elif defined(__x86_64__) || defined(__i386__)
+    path = __builtin_cpu_supports("aes") ? "AES-NI" : "SSSE3";
+#endif
+    snprintf(backend_name, sizeof(backend_name), "OpenSSL %s AES-256-CTR (%s)",
+             OpenSSL_version(OPENSSL_VERSION_STRING), path);
+}
+
+void aes_stats_begin(void) {
+    memset(&current, 0, sizeof(current));
+    current.active = 1;
+    current.totals.buffer_size = BUFFER_SIZE;
+    current.totals.threads = 1;
+    current.wall_start = clock_ns(CLOCK_MONOTONIC);
+    current.cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void aes_stats_collect(aes_op_stats* stats) {
+    pthread_once(&backend_once, describe_backend);
+    if (current.active) {
+        current.totals.wall_ns = clock_ns(CLOCK_MONOTONIC) - current.wall_start;
+        current.totals.cpu_ns += clock_ns(CLOCK_THREAD_CPUTIME_ID) - current.cpu_start;
+        *stats = current.totals;
+        current.active = 0;
+    } else {
+        memset(stats, 0, sizeof(*stats));
+    }
+    memcpy(stats->backend, backend_name, sizeof(stats->backend));
+}
+
+int crypto_stats_active(void) {
+    return current.active;
+}
+
+int64_t crypto_stats_clock(void) {
+    return current.active ? clock_ns(CLOCK_MONOTONIC) : 0;
+}
+
+void crypto_stats_read(int64_t started) {
+    if (!current.active) return;
+    current.totals.read_ns += clock_ns(CLOCK_MONOTONIC) - started;
+    current.totals.read_calls++;
+}
+
+void crypto_stats_write(int64_t started) {
+    if (!current.active) return;
+    current.totals.write_ns += clock_ns(CLOCK_MONOTONIC) - started;
+    current.totals.write_calls++;
+}
+
+void crypto_stats_crypto(int64_t started, size_t bytes) {
+    if (!current.active) return;
+    current.totals.crypto_ns += clock_ns(CLOCK_MONOTONIC) - started;
+    current.totals.bytes_processed += (int64_t)bytes;
+}
+
+void crypto_stats_alloc(void) {
+    if (current.active) current.totals.allocations++;
+}
+
+void crypto_stats_buffer(size_t size) {
+    if (current.active) current.totals.buffer_size = (int32_t)size;
+}
+
+void crypto_stats_merge(const aes_op_stats* worker, int threads) {
+    if (!current.active) return;
+    current.totals.bytes_processed += worker->bytes_processed;
+    current.totals.read_ns += worker->read_ns;
+    current.totals.crypto_ns += worker->crypto_ns;
+    current.totals.write_ns += worker->write_ns;
+    current.totals.read_calls += worker->read_calls;
+    current.totals.write_calls += worker->write_calls;
+    current.totals.cpu_ns += worker->cpu_ns;
+    current.totals.allocations += worker->allocations;
+    if (threads > current.totals.threads) current.totals.threads = threads;
+}
@@ -0,0 +1,43 @@
+#ifndef CRYPTO_STATS_H
+#define CRYPTO_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_STATS_BACKEND_LENGTH 64
+
+// What an operation spent its time on, to tell I/O-bound jobs from CPU-bound
+// ones. Times are in nanoseconds; read, crypto, write and CPU time are summed
+// over every thread the operation used, so with threads > 1 they can exceed
+// wall_ns.
+typedef struct {
+    int64_t bytes_processed;    // Bytes through the cipher
+    int64_t wall_ns;
+    int64_t read_ns;
+    int64_t crypto_ns;
+    int64_t write_ns;
+    int64_t read_calls;         // read/pread/fread calls issued
+    int64_t write_calls;        // write/pwrite/fwrite calls issued
+    int64_t cpu_ns;             // Thread CPU time (CLOCK_THREAD_CPUTIME_ID)
+    int64_t allocations;        // Heap allocations OpenSSL's free lists could not serve
+    int32_t buffer_size;
+    int32_t threads;
+    char backend[AES_STATS_BACKEND_LENGTH];  // Cipher implementation, e.g. "OpenSSL 3.1.1 AES-256-CTR (ARMv8 CE)"
+} aes_op_stats;
+
+// Start recording statistics for the operations that follow on the calling
+// thread. Recording is off (and costs nothing) until this is called.
+void aes_stats_begin(void);
+
+// Fill stats with everything recorded since aes_stats_begin on this thread
+// and stop recording.
+void aes_stats_collect(aes_op_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_STATS_H
@@ -0,0 +1,137 @@
+#include "crypto_trace.h"
+#include "crypto_internal.h"
+
+#ifdef AES_ENABLE_TRACE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#ifdef __ANDROID__
+#include <android/trace.h>
+#endif
+
+#define MAX_TRACKED_DEPTH 64
+
+static int trace_enabled = 1;
+
+// Per-thread span stack: a bit per level records whether its begin was
+// emitted, so toggling tracing in the middle of a span never unbalances it
+static __thread unsigned int span_depth;
+static __thread uint64_t span_emitted;
+
+#ifndef __ANDROID__
+static pthread_mutex_t file_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE* trace_file;
+static int trace_events;
+
+static void write_event(const char* name, char phase) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double micros = (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+    pthread_mutex_lock(&file_lock);
+    if (trace_file != NULL) {
+        fprintf(trace_file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld}",
+                trace_events++ ? ",\n" : "", name, phase, micros, (int)getpid(), (long)syscall(SYS_gettid));
+    }
+    pthread_mutex_unlock(&file_lock);
+}
+#endif
+
+static int should_emit(void) {
+    if (!__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) return 0;
+#ifdef __ANDROID__
+    return ATrace_isEnabled();
+#else
+    return __atomic_load_n(&trace_file, __ATOMIC_RELAXED) != NULL;
+#endif
+}
+
+void crypto_trace_begin(const char* name) {
+    int emit = should_emit();
+    if (span_depth < MAX_TRACKED_DEPTH) {
+        uint64_t bit = (uint64_t)1 << span_depth;
+        span_emitted = emit ? span_emitted | bit : span_emitted & ~bit;
+    } else {
+        emit = 0;
+    }
+    span_depth++;
+    if (!emit) return;
+#ifdef __ANDROID__
+    ATrace_beginSection(name);
+#else
+    write_event(name, 'B');
+#endif
+}
+
+void crypto_trace_end(void) {
+    if (span_depth == 0) return;
+    span_depth--;
+    if (span_depth >= MAX_TRACKED_DEPTH || !((span_emitted >> span_depth) & 1)) return;
+#ifdef __ANDROID__
+    ATrace_endSection();
+#else
+    write_event("", 'E');
+#endif
+}
+
+unsigned int crypto_trace_depth(void) {
+    return span_depth;
+}
+
+void crypto_trace_unwind(unsigned int depth) {
+    while (span_depth > depth) {
+        crypto_trace_end();
+    }
+}
+
+void aes_trace_set_enabled(int enabled) {
+    __atomic_store_n(&trace_enabled, enabled != 0, __ATOMIC_RELAXED);
+}
+
+#ifdef __ANDROID__
+int aes_trace_open_file(const char* path) {
+    return -1;
+}
+
+void aes_trace_close_file(void) {
+}
+#else
+int aes_trace_open_file(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) return -1;
+    fputs("[\n", file);
+    aes_trace_close_file();
+    pthread_mutex_lock(&file_lock);
+    trace_events = 0;
+    __atomic_store_n(&trace_file, file, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&file_lock);
+    return 0;
+}
+
+void aes_trace_close_file(void) {
+    pthread_mutex_lock(&file_lock);
+    FILE* file = trace_file;
+    __atomic_store_n(&trace_file, NULL, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&file_lock);
+    if (file != NULL) {
+        fputs("\n]\n", file);
+        fclose(file);
+    }
+}
+#endif
+
+#else // !AES_ENABLE_TRACE
+
+void aes_trace_set_enabled(int enabled) {
+}
+
+int aes_trace_open_file(const char* path) {
+    return -1;
+}
+
+void aes_trace_close_file(void) {
+}
+
+#endif
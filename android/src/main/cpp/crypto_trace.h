@@ -0,0 +1,32 @@
+#ifndef CRYPTO_TRACE_H
+#define CRYPTO_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Trace spans around the engine phases (open, key setup, read / crypt /
+// write per buffer, finalize, fsync) and around each public operation.
+// They only exist in builds compiled with AES_ENABLE_TRACE; otherwise these
+// calls do nothing and the spans compile away.
+//
+// On Android spans go to ATrace, so they show up in Perfetto / systrace
+// captures that include the app's trace tag. Elsewhere they are written to
+// a Chrome trace-event JSON file opened with aes_trace_open_file.
+
+// Runtime switch, on by default in tracing builds
+void aes_trace_set_enabled(int enabled);
+
+// Start writing spans to a Chrome trace-event file (chrome://tracing,
+// ui.perfetto.dev). Returns 0, or -1 if the file cannot be created or this
+// build cannot write trace files (Android, or tracing compiled out).
+int aes_trace_open_file(const char* path);
+
+// Terminate the JSON array and close the trace file
+void aes_trace_close_file(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_TRACE_H
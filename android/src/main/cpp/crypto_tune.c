@@ -0,0 +1,364 @@
+#include "crypto_tune.h"
+#include "crypto_internal.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#define TABLE_SIZE 8                              // Filesystems with their own profile
+#define DEFAULT_READ_AHEAD 4
+#define MAX_READ_AHEAD 15
+#define MIN_BUFFER_SIZE (16 * 1024)
+#define MAX_BUFFER_SIZE (4 * 1024 * 1024)
+#define MAX_THREADS 64
+
+#define CALIBRATE_BYTES (16 * 1024 * 1024)        // Data moved per candidate
+#define CALIBRATE_MARGIN 1.05                     // A larger setting must be 5% faster to win
+#define CALIBRATE_CHUNK (64 * 1024)               // Reader chunk size, for the read-ahead sweep
+#define CALIBRATE_BUFFER (1024 * 1024)            // Largest candidate buffer / read batch
+#define CALIBRATE_QUIET_NS (1000 * 1000000LL)     // Engine idle this long before measuring
+#define CALIBRATE_WAIT_NS (30 * 1000000000LL)     // Give up waiting for that after this long
+
+static const int32_t buffer_candidates[] = { 64 * 1024, 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024 };
+static const int thread_candidates[] = { 1, 2, 4, 8 };
+static const int depth_candidates[] = { 1, 2, 4, 8, 16 };  // Chunks per read: 1 + read-ahead
+
+typedef struct {
+    int used;
+    dev_t device;
+    aes_tune_profile profile;
+} tune_entry;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static tune_entry table[TABLE_SIZE];
+static int next_slot;
+static aes_tune_profile fallback = { BUFFER_SIZE, 0, DEFAULT_READ_AHEAD, 0, 0, 0 };
+static aes_tune_options overrides;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int32_t clamp(int32_t value, int32_t low, int32_t high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+// Callers hold lock
+static void resolve(const aes_tune_profile* profile, crypto_tuning* tuning) {
+    tuning->buffer_size = (size_t)(overrides.buffer_size > 0 ? overrides.buffer_size : profile->buffer_size);
+    tuning->threads = overrides.threads > 0 ? overrides.threads : profile->threads;
+    tuning->read_ahead = overrides.read_ahead > 0 ? overrides.read_ahead : profile->read_ahead;
+}
+
+static const aes_tune_profile* find_profile(int have_device, dev_t device) {
+    for (int i = 0; have_device && i < TABLE_SIZE; i++) {
+        if (table[i].used && table[i].device == device) return &table[i].profile;
+    }
+    return &fallback;
+}
+
+void crypto_tune_for_fd(int fd, crypto_tuning* tuning) {
+    struct stat64 st;
+    int have_device = fd >= 0 && fstat64(fd, &st) == 0;
+    pthread_mutex_lock(&lock);
+    resolve(find_profile(have_device, have_device ? st.st_dev : 0), tuning);
+    pthread_mutex_unlock(&lock);
+    crypto_stats_buffer(tuning->buffer_size);
+}
+
+int aes_tune_apply(const char* directory, const aes_tune_profile* profile) {
+    struct stat64 st;
+    if (!profile || (directory && stat64(directory, &st) != 0)) return -1;
+
+    aes_tune_profile checked = *profile;
+    checked.buffer_size = checked.buffer_size > 0
+        ? clamp(checked.buffer_size, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE) / 4096 * 4096
+        : BUFFER_SIZE;
+    checked.threads = clamp(checked.threads, 0, MAX_THREADS);
+    checked.read_ahead = clamp(checked.read_ahead, 0, MAX_READ_AHEAD);
+
+    pthread_mutex_lock(&lock);
+    if (!directory) {
+        fallback = checked;
+    } else {
+        tune_entry* entry = NULL;
+        for (int i = 0; i < TABLE_SIZE && !entry; i++) {
+            if (table[i].used && table[i].device == st.st_dev) entry = &table[i];
+        }
+        if (!entry) {
+            entry = &table[next_slot];
+            next_slot = (next_slot + 1) % TABLE_SIZE;
+        }
+        entry->used = 1;
+        entry->device = st.st_dev;
+        entry->profile = checked;
+    }
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+void aes_tune_set_options(const aes_tune_options* options) {
+    pthread_mutex_lock(&lock);
+    if (options) {
+        overrides.buffer_size = options->buffer_size > 0
+            ? clamp(options->buffer_size, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE) / 4096 * 4096
+            : 0;
+        overrides.threads = clamp(options->threads, 0, MAX_THREADS);
+        overrides.read_ahead = clamp(options->read_ahead, 0, MAX_READ_AHEAD);
+    } else {
+        memset(&overrides, 0, sizeof(overrides));
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void aes_tune_effective(const char* directory, aes_tune_profile* profile) {
+    struct stat64 st;
+    int have_device = directory && stat64(directory, &st) == 0;
+    crypto_tuning tuning;
+    pthread_mutex_lock(&lock);
+    *profile = *find_profile(have_device, have_device ? st.st_dev : 0);
+    resolve(profile, &tuning);
+    pthread_mutex_unlock(&lock);
+    profile->buffer_size = (int32_t)tuning.buffer_size;
+    profile->threads = tuning.threads;
+    profile->read_ahead = tuning.read_ahead;
+}
+
+int aes_tune_mount_point(const char* directory, char* out, size_t capacity) {
+    char resolved[PATH_MAX];
+    if (!directory || !realpath(directory, resolved)) return -1;
+    FILE* mounts = fopen("/proc/self/mountinfo", "re");
+    if (!mounts) return -1;
+
+    // "id parent major:minor root mount_point options ..."; the longest mount
+    // point containing the directory wins, the last one mounted on a tie
+    char line[1024];
+    char point[PATH_MAX];
+    size_t best = 0;
+    int found = 0;
+    while (fgets(line, sizeof(line), mounts)) {
+        if (sscanf(line, "%*s %*s %*s %*s %4095s", point) != 1) continue;
+        size_t length = strlen(point);
+        int contains = strncmp(resolved, point, length) == 0 &&
+                       (length == 1 || resolved[length] == '/' || resolved[length] == '\0');
+        if (contains && length >= best && length < capacity) {
+            memcpy(out, point, length + 1);
+            best = length;
+            found = 1;
+        }
+    }
+    fclose(mounts);
+    return found ? 0 : -1;
+}
+
+typedef struct {
+    int source_fd;
+    int target_fd;
+    size_t buffer_size;
+    unsigned char key[AES_KEY_LENGTH];
+    unsigned char iv[IV_LENGTH];
+    int64_t read_ns;
+    int64_t write_ns;
+    uint64_t idle_mark;   // From crypto_sched_wait_idle; any operation since spoils the run
+    uint64_t moved;       // Bytes read and written, charged to the background budget
+} bench_job;
+
+// Encrypt a range of the source into the target with pread / pwrite, the
+// way rekey and segment workers do
+static int bench_range(void* arg, uint64_t start, uint64_t end) {
+    bench_job* job = (bench_job*)arg;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(job->buffer_size);
+    int result = 0;
+    if (!ctx || !buffer) {
+        result = -3;
+    } else if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, job->key, job->iv) != 1 ||
+               crypto_ctr_seek(ctx, job->iv, start) != 0) {
+        result = -5;
+    }
+
+    int64_t read_ns = 0;
+    int64_t write_ns = 0;
+    for (uint64_t position = start; result == 0 && position < end;) {
+        size_t length = end - position < job->buffer_size ? (size_t)(end - position) : job->buffer_size;
+        int out_length;
+        int64_t started = now_ns();
+        if (crypto_pread_full(job->source_fd, buffer, length, (off64_t)position) != (ssize_t)length) {
+            result = -1;
+            break;
+        }
+        read_ns += now_ns() - started;
+        if (EVP_EncryptUpdate(ctx, buffer, &out_length, buffer, (int)length) != 1) {
+            result = -5;
+            break;
+        }
+        started = now_ns();
+        if (crypto_pwrite_full(job->target_fd, buffer, length, (off64_t)position) != 0) {
+            result = -7;
+        }
+        write_ns += now_ns() - started;
+        position += length;
+    }
+    __atomic_add_fetch(&job->read_ns, read_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&job->write_ns, write_ns, __ATOMIC_RELAXED);
+
+    crypto_mem_release(buffer, job->buffer_size);
+    EVP_CIPHER_CTX_free(ctx);
+    return result;
+}
+
+// One encrypt pass from a cold source into an empty target, synced; returns
+// bytes per second or a negative error
+static int64_t bench_pass(bench_job* job, int threads) {
+    if (!crypto_sched_idle_since(job->idle_mark)) return -13;
+    posix_fadvise(job->source_fd, 0, 0, POSIX_FADV_DONTNEED);
+    if (ftruncate(job->target_fd, 0) != 0) return -7;
+    job->read_ns = 0;
+    job->write_ns = 0;
+
+    int64_t started = now_ns();
+    int result = threads > 1
+        ? crypto_parallel_ranges(CALIBRATE_BYTES, threads, job->buffer_size, bench_range, job)
+        : bench_range(job, 0, CALIBRATE_BYTES);
+    if (result == 0 && crypto_fdatasync(job->target_fd) != 0) result = -7;
+    int64_t elapsed = now_ns() - started;
+    job->moved += 2 * (uint64_t)CALIBRATE_BYTES;
+    return result != 0 ? result : (int64_t)CALIBRATE_BYTES * 1000000000LL / (elapsed > 0 ? elapsed : 1);
+}
+
+static int open_temporary(const char* directory) {
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/.aes_tune_XXXXXX", directory) >= (int)sizeof(path)) return -1;
+    int fd = mkstemp(path);
+    if (fd >= 0) unlink(path);  // Nothing is left behind, even after a crash
+    return fd;
+}
+
+static int calibrate(const char* directory, aes_tune_profile* profile, unsigned char* buffer, bench_job* job) {
+    if (RAND_bytes(job->key, sizeof(job->key)) != 1 || RAND_bytes(job->iv, sizeof(job->iv)) != 1) return -5;
+
+    // Cipher speed in memory; the same keystream fills the source file, so
+    // the storage sees incompressible data
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return -3;
+    int result = EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, job->key, job->iv) == 1 ? 0 : -5;
+    memset(buffer, 0, CALIBRATE_BUFFER);
+    int64_t cipher_ns = 0;
+    for (uint64_t written = 0; result == 0 && written < CALIBRATE_BYTES; written += CALIBRATE_BUFFER) {
+        int out_length;
+        int64_t started = now_ns();
+        if (EVP_EncryptUpdate(ctx, buffer, &out_length, buffer, CALIBRATE_BUFFER) != 1) {
+            result = -5;
+            break;
+        }
+        cipher_ns += now_ns() - started;
+        if (crypto_write_full(job->source_fd, buffer, CALIBRATE_BUFFER) != 0) result = -7;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    if (result == 0 && crypto_fdatasync(job->source_fd) != 0) result = -7;
+    if (result != 0) return result;
+    job->moved += CALIBRATE_BYTES;
+    profile->cipher_bytes_per_second = (int64_t)CALIBRATE_BYTES * 1000000000LL / (cipher_ns > 0 ? cipher_ns : 1);
+
+    // Buffer size, single thread
+    int64_t best_speed = 0;
+    for (size_t i = 0; i < sizeof(buffer_candidates) / sizeof(buffer_candidates[0]); i++) {
+        job->buffer_size = (size_t)buffer_candidates[i];
+        int64_t speed = bench_pass(job, 1);
+        if (speed < 0) return (int)speed;
+        if (speed > best_speed * CALIBRATE_MARGIN) {
+            best_speed = speed;
+            profile->buffer_size = buffer_candidates[i];
+            profile->read_bytes_per_second = job->read_ns > 0 ? (int64_t)CALIBRATE_BYTES * 1000000000LL / job->read_ns : 0;
+            profile->write_bytes_per_second = job->write_ns > 0 ? (int64_t)CALIBRATE_BYTES * 1000000000LL / job->write_ns : 0;
+        }
+    }
+
+    // Workers, at that buffer size; more than the CPUs (or than the ranges
+    // crypto_parallel_ranges would split 16MB into) can't be measured
+    job->buffer_size = (size_t)profile->buffer_size;
+    profile->threads = 1;
+    int cpus = crypto_cpu_count();
+    for (size_t i = 1; i < sizeof(thread_candidates) / sizeof(thread_candidates[0]); i++) {
+        int threads = thread_candidates[i];
+        if (threads > cpus || threads > CALIBRATE_BYTES / (4 * 1024 * 1024)) break;
+        int64_t speed = bench_pass(job, threads);
+        if (speed < 0) return (int)speed;
+        if (speed > best_speed * CALIBRATE_MARGIN) {
+            best_speed = speed;
+            profile->threads = threads;
+        }
+    }
+
+    // Read-ahead: how many reader chunks one pread should fetch
+    best_speed = 0;
+    for (size_t i = 0; i < sizeof(depth_candidates) / sizeof(depth_candidates[0]); i++) {
+        size_t batch = (size_t)depth_candidates[i] * CALIBRATE_CHUNK;
+        if (!crypto_sched_idle_since(job->idle_mark)) return -13;
+        posix_fadvise(job->source_fd, 0, 0, POSIX_FADV_DONTNEED);
+        int64_t started = now_ns();
+        for (uint64_t position = 0; position < CALIBRATE_BYTES; position += batch) {
+            if (crypto_pread_full(job->source_fd, buffer, batch, (off64_t)position) != (ssize_t)batch) return -1;
+        }
+        int64_t elapsed = now_ns() - started;
+        job->moved += CALIBRATE_BYTES;
+        int64_t speed = (int64_t)CALIBRATE_BYTES * 1000000000LL / (elapsed > 0 ? elapsed : 1);
+        if (speed > best_speed * CALIBRATE_MARGIN) {
+            best_speed = speed;
+            profile->read_ahead = depth_candidates[i] - 1;
+        }
+    }
+    if (profile->read_ahead > MAX_READ_AHEAD) profile->read_ahead = MAX_READ_AHEAD;
+    return crypto_sched_idle_since(job->idle_mark) ? 0 : -13;
+}
+
+int aes_tune_calibrate(const char* directory, aes_tune_profile* profile) {
+    if (!directory || !profile) return -1;
+    memset(profile, 0, sizeof(*profile));
+    profile->buffer_size = BUFFER_SIZE;
+    profile->read_ahead = DEFAULT_READ_AHEAD;
+
+    // A profile measured while other operations compete for the storage
+    // would be kept for good, so measuring waits for the engine to go idle
+    // and gives up (-13) as soon as any operation starts
+    bench_job job;
+    memset(&job, 0, sizeof(job));
+    job.source_fd = job.target_fd = -1;
+    job.idle_mark = crypto_sched_wait_idle(CALIBRATE_QUIET_NS, CALIBRATE_WAIT_NS);
+    if (!job.idle_mark) return -13;
+    job.source_fd = open_temporary(directory);
+    job.target_fd = open_temporary(directory);
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(CALIBRATE_BUFFER);
+
+    // With nothing else running, measure unthrottled even from a background
+    // thread, then charge what it moved to the background budget
+    int background = crypto_sched_background();
+    aes_sched_set_thread_priority(AES_PRIORITY_FOREGROUND);
+
+    int result;
+    if (job.source_fd < 0 || job.target_fd < 0) {
+        result = -1;
+    } else if (!buffer) {
+        result = -3;
+    } else {
+        result = calibrate(directory, profile, buffer, &job);
+    }
+
+    aes_sched_set_thread_priority(background ? AES_PRIORITY_BACKGROUND : AES_PRIORITY_FOREGROUND);
+    if (background) crypto_sched_charge((size_t)job.moved);
+    if (job.source_fd >= 0) close(job.source_fd);
+    if (job.target_fd >= 0) close(job.target_fd);
+    OPENSSL_cleanse(job.key, sizeof(job.key));
+    OPENSSL_cleanse(job.iv, sizeof(job.iv));
+    crypto_mem_release(buffer, CALIBRATE_BUFFER);
+    return result;
+}
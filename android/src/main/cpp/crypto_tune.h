@@ -0,0 +1,59 @@
+#ifndef CRYPTO_TUNE_H
+#define CRYPTO_TUNE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-filesystem tuning. Storage ranges from eMMC to UFS 4.0, so the buffer
+// size, worker count and reader read-ahead that suit one device are wrong
+// for another. A profile, measured by aes_tune_calibrate or restored from an
+// earlier run, is applied per filesystem; operations pick the profile of
+// the filesystem they write to (read from, for readers).
+
+typedef struct {
+    int32_t buffer_size;              // Bytes per read, cipher call and write
+    int32_t threads;                  // Workers for rekey and segment jobs; 0 = one per CPU
+    int32_t read_ahead;               // Chunks a random-access reader fetches ahead
+    int64_t read_bytes_per_second;    // Measured by aes_tune_calibrate, else 0
+    int64_t write_bytes_per_second;
+    int64_t cipher_bytes_per_second;  // AES-256-CTR on one core, in memory
+} aes_tune_profile;
+
+// Explicit settings that win over every profile; 0 keeps the profile's value
+typedef struct {
+    int32_t buffer_size;
+    int32_t threads;
+    int32_t read_ahead;
+} aes_tune_options;
+
+// Benchmark the storage under directory with a short synthetic run (about
+// 16MB through each candidate setting, in an unlinked temporary file) and
+// fill profile with the fastest settings. Nothing is applied. The run waits
+// for the engine to be idle and, from a background thread, its I/O is
+// charged to the background budget. Returns 0, -1 (temporary file), -3
+// (alloc), -5 (cipher), -7 (write) or -13 (other operations ran during the
+// measurement, or the engine never went idle; the profile must not be kept).
+int aes_tune_calibrate(const char* directory, aes_tune_profile* profile);
+
+// Use profile for files on directory's filesystem, or for every filesystem
+// without a profile of its own when directory is NULL. Returns 0 or -1.
+int aes_tune_apply(const char* directory, const aes_tune_profile* profile);
+
+void aes_tune_set_options(const aes_tune_options* options);
+
+// Settings operations on directory's filesystem will use, after options
+void aes_tune_effective(const char* directory, aes_tune_profile* profile);
+
+// Mount point of the filesystem holding directory (to key stored profiles).
+// Returns 0, or -1 if it can't be found.
+int aes_tune_mount_point(const char* directory, char* out, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_TUNE_H
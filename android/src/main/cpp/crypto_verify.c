@@ -0,0 +1,187 @@
+#include "crypto_verify.h"
+#include "crypto_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+// ioprio_set(2) values; not every NDK level ships <linux/ioprio.h>
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+
+typedef struct {
+    pid_t tid;
+    int nice;
+    int ioprio;
+} saved_priority;
+
+static void lower_priority(saved_priority* saved) {
+    saved->tid = (pid_t)syscall(SYS_gettid);
+    errno = 0;
+    saved->nice = getpriority(PRIO_PROCESS, (id_t)saved->tid);
+    if (errno != 0) saved->nice = 0;
+    saved->ioprio = (int)syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, saved->tid);
+
+    // Both calls act on this thread only; failures just leave the defaults
+    setpriority(PRIO_PROCESS, (id_t)saved->tid, 19);
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, saved->tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+}
+
+static void restore_priority(const saved_priority* saved) {
+    if (saved->ioprio >= 0) {
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, saved->tid, saved->ioprio);
+    }
+    setpriority(PRIO_PROCESS, (id_t)saved->tid, saved->nice);
+}
+
+// Decrypt body [data_offset, data_offset + length) into a scratch buffer and
+// feed the plaintext to the digest
+static int verify_ctr_body(int fd, const unsigned char* key, const unsigned char* iv, off64_t data_offset,
+                           uint64_t length, int flags, EVP_MD_CTX* digest, aes_verify_report* report) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    unsigned char* buffer = (unsigned char*)crypto_mem_acquire(BUFFER_SIZE);
+    int result = 0;
+    if (!ctx || !buffer) {
+        result = -3;
+    } else if (EVP_DecryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, key, iv) != 1) {
+        result = -4;
+    }
+
+    uint64_t position = 0;
+    while (result == 0 && position < length) {
+        size_t chunk = length - position < BUFFER_SIZE ? (size_t)(length - position) : BUFFER_SIZE;
+        off64_t file_offset = data_offset + (off64_t)position;
+        int out_length;
+        if (crypto_pread_full(fd, buffer, chunk, file_offset) != (ssize_t)chunk) {
+            result = -1;
+        } else if (EVP_DecryptUpdate(ctx, buffer, &out_length, buffer, (int)chunk) != 1 ||
+                   EVP_DigestUpdate(digest, buffer, (size_t)out_length) != 1) {
+            result = -5;
+        }
+        if (flags & AES_VERIFY_LOW_PRIORITY) {
+            posix_fadvise64(fd, file_offset, (off64_t)chunk, POSIX_FADV_DONTNEED);
+        }
+        position += chunk;
+    }
+    report->bytes_verified = (int64_t)position;
+
+    if (buffer) OPENSSL_cleanse(buffer, BUFFER_SIZE);
+    crypto_mem_release(buffer, BUFFER_SIZE);
+    EVP_CIPHER_CTX_free(ctx);
+    return result;
+}
+
+typedef struct {
+    EVP_MD_CTX* digest;
+    aes_verify_report* report;
+} digest_sink;
+
+// Holes digest as the zeros they decrypt to
+static int digest_run(void* arg, uint64_t offset, const unsigned char* data, size_t length) {
+    static const unsigned char zeros[4096];
+    digest_sink* out = (digest_sink*)arg;
+    for (size_t done = 0; done < length;) {
+        size_t step = data ? length : (length - done < sizeof(zeros) ? length - done : sizeof(zeros));
+        if (EVP_DigestUpdate(out->digest, data ? data : zeros, step) != 1) return -5;
+        done += step;
+    }
+    out->report->bytes_verified = (int64_t)(offset + length);
+    return 0;
+}
+
+static int verify_file(const char* path, const char* key, const unsigned char* expected_sha256,
+                       int flags, aes_verify_report* report) {
+    memset(report, 0, sizeof(*report));
+    report->first_bad_offset = -1;
+
+    aes_file_metadata info;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || aes_file_info(path, &info) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if (info.format == AES_FILE_FORMAT_UNKNOWN) {
+        close(fd);
+        return -2;
+    }
+
+    saved_priority saved;
+    if (flags & AES_VERIFY_LOW_PRIORITY) {
+        lower_priority(&saved);
+    }
+    posix_fadvise64(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    EVP_MD_CTX* digest = EVP_MD_CTX_new();
+    int result = 0;
+    int consistent = 1;
+    if (!digest) {
+        result = -3;
+    } else if (EVP_DigestInit_ex(digest, EVP_sha256(), NULL) != 1) {
+        result = -4;
+    } else if (info.format == AES_FILE_FORMAT_CHUNKED) {
+        result = crypto_chunked_verify(fd, key, flags, digest, report);
+        consistent = report->first_bad_offset < 0;
+    } else if (info.format == AES_FILE_FORMAT_SPARSE) {
+        digest_sink out = { digest, report };
+        result = crypto_sparse_walk(fd, key, digest_run, &out);
+        if (flags & AES_VERIFY_LOW_PRIORITY) {
+            posix_fadvise64(fd, 0, 0, POSIX_FADV_DONTNEED);
+        }
+    } else {
+        unsigned char data_key[AES_KEY_LENGTH];
+        unsigned char iv[IV_LENGTH];
+        off64_t data_offset = 0;
+        if (info.format == AES_FILE_FORMAT_ENVELOPE) {
+            result = crypto_envelope_unwrap(fd, key, data_key, iv, &data_offset);
+        } else {
+            crypto_stream_layout layout;
+            result = crypto_read_stream_layout(fd, &layout);
+            if (result == 0) {
+                crypto_prepare_key(key, data_key);
+                memcpy(iv, layout.iv, IV_LENGTH);
+                data_offset = layout.data_offset;
+            }
+        }
+        if (result == 0) {
+            uint64_t body_length = (uint64_t)(info.file_size - data_offset);
+            // A header that records a different length means a truncated or extended body
+            if (info.format == AES_FILE_FORMAT_HEADER && (uint64_t)info.plaintext_size != body_length) {
+                consistent = 0;
+                report->first_bad_offset = info.plaintext_size < (int64_t)body_length
+                                               ? info.plaintext_size : (int64_t)body_length;
+            }
+            result = verify_ctr_body(fd, data_key, iv, data_offset, body_length, flags, digest, report);
+        }
+        OPENSSL_cleanse(data_key, sizeof(data_key));
+    }
+
+    unsigned int digest_length = 0;
+    if (result == 0 && EVP_DigestFinal_ex(digest, report->sha256, &digest_length) != 1) {
+        result = -6;
+    }
+    if (result == 0) {
+        report->passed = consistent &&
+                         (expected_sha256 == NULL ||
+                          CRYPTO_memcmp(report->sha256, expected_sha256, AES_VERIFY_SHA256_LENGTH) == 0);
+    }
+
+    EVP_MD_CTX_free(digest);
+    if (flags & AES_VERIFY_LOW_PRIORITY) {
+        restore_priority(&saved);
+    }
+    close(fd);
+    return result;
+}
+
+int aes_verify_file(const char* path, const char* key, const unsigned char* expected_sha256,
+                    int flags, aes_verify_report* report) {
+    int64_t started = crypto_metrics_begin(AES_METRIC_VERIFY);
+    int result = verify_file(path, key, expected_sha256, flags, report);
+    return crypto_metrics_end(AES_METRIC_VERIFY, started, report->bytes_verified, result);
+}
@@ -0,0 +1,39 @@
+#ifndef CRYPTO_VERIFY_H
+#define CRYPTO_VERIFY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_VERIFY_SHA256_LENGTH 32
+
+// Run at idle CPU and I/O priority and drop verified pages from the page
+// cache; the calling thread's priorities are restored before returning
+#define AES_VERIFY_LOW_PRIORITY 1
+
+typedef struct {
+    int passed;                 // 1 if every available check succeeded
+    int64_t first_bad_offset;   // Plaintext offset of the first corrupt chunk, -1 if none or unknown
+    int64_t bytes_verified;     // Plaintext bytes decrypted and checked
+    unsigned char sha256[AES_VERIFY_SHA256_LENGTH];  // Digest of the plaintext (complete when passed)
+} aes_verify_report;
+
+// Decrypt path into a scratch buffer and discard the plaintext; nothing is
+// written. Chunked files are checked chunk by chunk against their keyed
+// fingerprints, which locates the first corrupt chunk. Other formats carry
+// no tags: they pass if the body is consistent with the header and, when
+// expected_sha256 is given, the plaintext digest matches it. Sparse files
+// are digested with their holes as zeros, as they decrypt.
+// Returns 0 when verification ran (see report->passed) or a negative error
+// (-10 for a wrong key where the format can tell, -11 for a chunked file
+// left dirty by an interrupted write, -2 for a damaged header or index).
+int aes_verify_file(const char* path, const char* key, const unsigned char* expected_sha256,
+                    int flags, aes_verify_report* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_VERIFY_H
@@ -1,6 +1,28 @@
 #include <jni.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include "crypto_engine.h"
+#include "crypto_batch.h"
+#include "crypto_reader.h"
+#include "crypto_http_server.h"
+#include "crypto_resume.h"
+#include "crypto_chunked.h"
+#include "crypto_rekey.h"
+#include "crypto_envelope.h"
+#include "crypto_header.h"
+#include "crypto_verify.h"
+#include "crypto_memfd.h"
+#include "crypto_memory.h"
+#include "crypto_follow.h"
+#include "crypto_governor.h"
+#include "crypto_segment.h"
+#include "crypto_sched.h"
+#include "crypto_sparse.h"
+#include "crypto_metrics.h"
+#include "crypto_stats.h"
+#include "crypto_trace.h"
+#include "crypto_tune.h"
 
 // JNI wrapper for nativeEncryptFile
 JNIEXPORT jint JNICALL
@@ -37,6 +59,41 @@ Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEncryptFile(
     return result;
 }
 
+// JNI wrapper for nativeEncryptFileResumable
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEncryptFileResumable(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key,
+    jstring iv) {
+
+    // Convert Java strings to C strings
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    const char *iv_str = NULL;
+
+    // Check if IV is provided
+    if (iv != NULL) {
+        iv_str = (*env)->GetStringUTFChars(env, iv, NULL);
+    }
+
+    // Encrypt, continuing from the last checkpoint if one matches
+    int result = aes_encrypt_file_resumable(input_path_str, output_path_str, key_str, iv_str);
+
+    // Release the strings
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    if (iv_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, iv, iv_str);
+    }
+
+    return result;
+}
+
 // JNI wrapper for nativeDecryptFile
 JNIEXPORT jint JNICALL
 Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeDecryptFile(
@@ -72,6 +129,32 @@ Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeDecryptFile(
     return result;
 }
 
+// JNI wrapper for nativeAppendFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeAppendFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring encryptedPath,
+    jstring inputPath,
+    jstring key,
+    jboolean sync) {
+
+    // Convert Java strings to C strings
+    const char *encrypted_path_str = (*env)->GetStringUTFChars(env, encryptedPath, NULL);
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    // Encrypt the new data at the end of the existing keystream
+    int result = aes_append_file(encrypted_path_str, input_path_str, key_str, sync == JNI_TRUE);
+
+    // Release the strings
+    (*env)->ReleaseStringUTFChars(env, encryptedPath, encrypted_path_str);
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
 // JNI wrapper for nativeGetFileSize
 JNIEXPORT jlong JNICALL
 Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeGetFileSize(
@@ -90,3 +173,1064 @@ Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeGetFileSize(
     
     return (jlong)result;
 }
+
+// JNI wrapper for nativeReaderOpen
+JNIEXPORT jlong JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeReaderOpen(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jstring key) {
+
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    aes_reader *reader = aes_reader_open(path_str, key_str);
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return (jlong)(intptr_t)reader;
+}
+
+// JNI wrapper for nativeReaderRead; returns null on error
+JNIEXPORT jbyteArray JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeReaderRead(
+    JNIEnv *env,
+    jobject thiz,
+    jlong handle,
+    jlong offset,
+    jint length) {
+
+    aes_reader *reader = (aes_reader *)(intptr_t)handle;
+    if (reader == NULL || length < 0) {
+        return NULL;
+    }
+
+    int64_t size = aes_reader_size(reader);
+    jint available = offset >= size ? 0 : (size - offset < length ? (jint)(size - offset) : length);
+    jbyteArray array = (*env)->NewByteArray(env, available);
+    if (array == NULL || available == 0) {
+        return array;
+    }
+
+    // Decrypt straight into the Java array
+    jbyte *bytes = (*env)->GetByteArrayElements(env, array, NULL);
+    ssize_t result = aes_reader_pread(reader, bytes, (size_t)available, offset);
+    (*env)->ReleaseByteArrayElements(env, array, bytes, result < 0 ? JNI_ABORT : 0);
+
+    return result < 0 ? NULL : array;
+}
+
+// JNI wrapper for nativeReaderSize
+JNIEXPORT jlong JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeReaderSize(
+    JNIEnv *env,
+    jobject thiz,
+    jlong handle) {
+
+    return (jlong)aes_reader_size((aes_reader *)(intptr_t)handle);
+}
+
+// JNI wrapper for nativeReaderClose
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeReaderClose(
+    JNIEnv *env,
+    jobject thiz,
+    jlong handle) {
+
+    aes_reader_close((aes_reader *)(intptr_t)handle);
+}
+
+// JNI wrapper for nativeStreamServerStart; returns the bound port or a negative error
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeStreamServerStart(
+    JNIEnv *env,
+    jobject thiz) {
+
+    return aes_http_server_start();
+}
+
+// JNI wrapper for nativeStreamServerStop
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeStreamServerStop(
+    JNIEnv *env,
+    jobject thiz) {
+
+    aes_http_server_stop();
+}
+
+// JNI wrapper for nativeStreamServerAdd; returns the session token or null
+JNIEXPORT jstring JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeStreamServerAdd(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jstring key,
+    jstring mimeType) {
+
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    const char *mime_str = NULL;
+    if (mimeType != NULL) {
+        mime_str = (*env)->GetStringUTFChars(env, mimeType, NULL);
+    }
+
+    char token[AES_HTTP_TOKEN_LENGTH + 1];
+    int result = aes_http_server_add(path_str, key_str, mime_str, token);
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    if (mime_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, mimeType, mime_str);
+    }
+
+    return result == 0 ? (*env)->NewStringUTF(env, token) : NULL;
+}
+
+// JNI wrapper for nativeStreamServerRemove
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeStreamServerRemove(
+    JNIEnv *env,
+    jobject thiz,
+    jstring token) {
+
+    const char *token_str = (*env)->GetStringUTFChars(env, token, NULL);
+    aes_http_server_remove(token_str);
+    (*env)->ReleaseStringUTFChars(env, token, token_str);
+}
+
+// JNI wrapper for nativeChunkedSyncFile; returns chunks written or a negative error
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeChunkedSyncFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key,
+    jint chunkSize) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_chunked_sync_file(input_path_str, output_path_str, key_str,
+                                       chunkSize > 0 ? (uint32_t)chunkSize : 0);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeChunkedDecryptFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeChunkedDecryptFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_chunked_decrypt_file(input_path_str, output_path_str, key_str);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeRekeyFile; a null outputPath rekeys in place
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeRekeyFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring oldKey,
+    jstring newKey) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = NULL;
+    if (outputPath != NULL) {
+        output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    }
+    const char *old_key_str = (*env)->GetStringUTFChars(env, oldKey, NULL);
+    const char *new_key_str = (*env)->GetStringUTFChars(env, newKey, NULL);
+
+    int result = aes_rekey_file(input_path_str, output_path_str, old_key_str, new_key_str, 0);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    if (output_path_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    }
+    (*env)->ReleaseStringUTFChars(env, oldKey, old_key_str);
+    (*env)->ReleaseStringUTFChars(env, newKey, new_key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeEncryptFileWithHeader
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEncryptFileWithHeader(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key,
+    jstring iv) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    const char *iv_str = NULL;
+    if (iv != NULL) {
+        iv_str = (*env)->GetStringUTFChars(env, iv, NULL);
+    }
+
+    int result = aes_encrypt_file_with_header(input_path_str, output_path_str, key_str, iv_str);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    if (iv_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, iv, iv_str);
+    }
+
+    return result;
+}
+
+// JNI wrapper for nativeEnvelopeEncryptFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEnvelopeEncryptFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_envelope_encrypt_file(input_path_str, output_path_str, key_str);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeEnvelopeDecryptFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEnvelopeDecryptFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_envelope_decrypt_file(input_path_str, output_path_str, key_str);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeEnvelopeRewrap
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEnvelopeRewrap(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jstring oldKey,
+    jstring newKey) {
+
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *old_key_str = (*env)->GetStringUTFChars(env, oldKey, NULL);
+    const char *new_key_str = (*env)->GetStringUTFChars(env, newKey, NULL);
+
+    int result = aes_envelope_rewrap(path_str, old_key_str, new_key_str);
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    (*env)->ReleaseStringUTFChars(env, oldKey, old_key_str);
+    (*env)->ReleaseStringUTFChars(env, newKey, new_key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeFileInfo; returns [format, version, algorithm,
+// chunkSize, headerSize, fileSize, plaintextSize, hasIv] and fills iv
+JNIEXPORT jlongArray JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeFileInfo(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jbyteArray iv) {
+
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+
+    aes_file_metadata info;
+    int result = aes_file_info(path_str, &info);
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+
+    if (result != 0) {
+        return NULL;
+    }
+
+    jlong fields[8] = {
+        info.format, info.version, info.algorithm, info.chunk_size,
+        info.header_size, info.file_size, info.plaintext_size, info.has_iv
+    };
+    jlongArray array = (*env)->NewLongArray(env, 8);
+    if (array == NULL) {
+        return NULL;
+    }
+    (*env)->SetLongArrayRegion(env, array, 0, 8, fields);
+    if (info.has_iv && (*env)->GetArrayLength(env, iv) >= (jsize)sizeof(info.iv)) {
+        (*env)->SetByteArrayRegion(env, iv, 0, sizeof(info.iv), (const jbyte*)info.iv);
+    }
+    return array;
+}
+
+// JNI wrapper for nativeVerifyFile; returns [result, passed, firstBadOffset,
+// bytesVerified] and fills sha256 with the plaintext digest
+JNIEXPORT jlongArray JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeVerifyFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jstring key,
+    jbyteArray expectedSha256,
+    jboolean lowPriority,
+    jbyteArray sha256) {
+
+    unsigned char expected[AES_VERIFY_SHA256_LENGTH];
+    int has_expected = expectedSha256 != NULL &&
+                       (*env)->GetArrayLength(env, expectedSha256) == AES_VERIFY_SHA256_LENGTH;
+    if (has_expected) {
+        (*env)->GetByteArrayRegion(env, expectedSha256, 0, AES_VERIFY_SHA256_LENGTH, (jbyte*)expected);
+    }
+
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    aes_verify_report report;
+    int result = aes_verify_file(path_str, key_str, has_expected ? expected : NULL,
+                                 lowPriority ? AES_VERIFY_LOW_PRIORITY : 0, &report);
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    jlong fields[4] = { result, report.passed, report.first_bad_offset, report.bytes_verified };
+    jlongArray array = (*env)->NewLongArray(env, 4);
+    if (array == NULL) {
+        return NULL;
+    }
+    (*env)->SetLongArrayRegion(env, array, 0, 4, fields);
+    if (result == 0 && (*env)->GetArrayLength(env, sha256) >= AES_VERIFY_SHA256_LENGTH) {
+        (*env)->SetByteArrayRegion(env, sha256, 0, AES_VERIFY_SHA256_LENGTH, (const jbyte*)report.sha256);
+    }
+    return array;
+}
+
+// JNI wrapper for nativeEncryptFd; the descriptors stay owned by the caller
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEncryptFd(
+    JNIEnv *env,
+    jobject thiz,
+    jint inputFd,
+    jint outputFd,
+    jstring key,
+    jstring iv,
+    jboolean header) {
+
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    const char *iv_str = NULL;
+    if (iv != NULL) {
+        iv_str = (*env)->GetStringUTFChars(env, iv, NULL);
+    }
+
+    int result = header ? aes_encrypt_fd_with_header(inputFd, outputFd, key_str, iv_str)
+                        : aes_encrypt_fd(inputFd, outputFd, key_str, iv_str);
+
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    if (iv_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, iv, iv_str);
+    }
+
+    return result;
+}
+
+// JNI wrapper for nativeDecryptFd; the descriptors stay owned by the caller
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeDecryptFd(
+    JNIEnv *env,
+    jobject thiz,
+    jint inputFd,
+    jint outputFd,
+    jstring key,
+    jstring iv) {
+
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    const char *iv_str = NULL;
+    if (iv != NULL) {
+        iv_str = (*env)->GetStringUTFChars(env, iv, NULL);
+    }
+
+    int result = aes_decrypt_fd(inputFd, outputFd, key_str, iv_str);
+
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    if (iv_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, iv, iv_str);
+    }
+
+    return result;
+}
+
+// JNI wrapper for nativeDecryptToMemfd; returns the sealed memfd or an error
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeDecryptToMemfd(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jstring key,
+    jstring name) {
+
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+    const char *name_str = NULL;
+    if (name != NULL) {
+        name_str = (*env)->GetStringUTFChars(env, name, NULL);
+    }
+
+    int result = aes_decrypt_to_memfd(path_str, key_str, name_str);
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    if (name_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, name, name_str);
+    }
+
+    return result;
+}
+
+// JNI wrapper for nativeDecryptToBytes; the plaintext is decrypted straight
+// into the returned array (large arrays are not moved by ART, so
+// GetByteArrayElements hands out the array itself rather than a copy)
+JNIEXPORT jbyteArray JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeDecryptToBytes(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jstring key) {
+
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    jbyteArray array = NULL;
+    aes_file_metadata info;
+    if (aes_file_info(path_str, &info) == 0 && info.plaintext_size >= 0 && info.plaintext_size <= INT32_MAX) {
+        array = (*env)->NewByteArray(env, (jsize)info.plaintext_size);
+    }
+    if (array != NULL) {
+        jbyte *bytes = (*env)->GetByteArrayElements(env, array, NULL);
+        size_t length = 0;
+        int result = bytes == NULL ? -3
+                                   : aes_decrypt_file_to_buffer(path_str, key_str, (unsigned char *)bytes,
+                                                                (size_t)info.plaintext_size, &length);
+        if (bytes != NULL) {
+            (*env)->ReleaseByteArrayElements(env, array, bytes, result == 0 ? 0 : JNI_ABORT);
+        }
+        // The file changed size between the header read and decryption
+        if (result != 0 || length != (size_t)info.plaintext_size) {
+            (*env)->DeleteLocalRef(env, array);
+            array = NULL;
+        }
+    }
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return array;
+}
+
+// JNI wrapper for nativeEncryptBytesToFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeEncryptBytesToFile(
+    JNIEnv *env,
+    jobject thiz,
+    jbyteArray data,
+    jstring path,
+    jstring key,
+    jboolean header) {
+
+    jsize length = (*env)->GetArrayLength(env, data);
+    jbyte *bytes = (*env)->GetByteArrayElements(env, data, NULL);
+    if (bytes == NULL) {
+        return -3;
+    }
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_encrypt_buffer_to_file((const unsigned char *)bytes, (size_t)length, path_str, key_str, header);
+
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    (*env)->ReleaseByteArrayElements(env, data, bytes, JNI_ABORT);
+
+    return result;
+}
+
+// JNI wrapper for nativeFollowStart; returns the follower pointer or 0
+JNIEXPORT jlong JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeFollowStart(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key,
+    jboolean header,
+    jboolean finishOnClose) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int flags = (header ? AES_FOLLOW_HEADER : 0) | (finishOnClose ? AES_FOLLOW_FINISH_ON_CLOSE : 0);
+    aes_follow *follow = aes_follow_start(input_path_str, output_path_str, key_str, flags);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return (jlong)(intptr_t)follow;
+}
+
+// JNI wrapper for nativeFollowProgress
+JNIEXPORT jlong JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeFollowProgress(
+    JNIEnv *env,
+    jobject thiz,
+    jlong handle) {
+
+    return aes_follow_progress((aes_follow *)(intptr_t)handle);
+}
+
+// JNI wrapper for nativeFollowFinish; releases the follower
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeFollowFinish(
+    JNIEnv *env,
+    jobject thiz,
+    jlong handle) {
+
+    return aes_follow_finish((aes_follow *)(intptr_t)handle);
+}
+
+// JNI wrapper for nativeSegmentEncryptFile; returns the segment count or a negative error
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeSegmentEncryptFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPrefix,
+    jstring key,
+    jlong segmentSize) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_prefix_str = (*env)->GetStringUTFChars(env, outputPrefix, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_segment_encrypt_file(input_path_str, output_prefix_str, key_str, (int64_t)segmentSize, 0);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPrefix, output_prefix_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeSegmentJoinFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeSegmentJoinFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring manifestPath,
+    jstring outputPath,
+    jstring key) {
+
+    const char *manifest_path_str = (*env)->GetStringUTFChars(env, manifestPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_segment_join_file(manifest_path_str, output_path_str, key_str, 0);
+
+    (*env)->ReleaseStringUTFChars(env, manifestPath, manifest_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeChunkedConcatFiles
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeChunkedConcatFiles(
+    JNIEnv *env,
+    jobject thiz,
+    jobjectArray inputPaths,
+    jstring outputPath,
+    jstring key) {
+
+    jsize count = (*env)->GetArrayLength(env, inputPaths);
+    jstring *path_objects = (jstring *)calloc(count > 0 ? count : 1, sizeof(jstring));
+    const char **path_strs = (const char **)calloc(count > 0 ? count : 1, sizeof(const char *));
+    if (!path_objects || !path_strs) {
+        free(path_objects);
+        free(path_strs);
+        return -3;
+    }
+    for (jsize i = 0; i < count; i++) {
+        path_objects[i] = (jstring)(*env)->GetObjectArrayElement(env, inputPaths, i);
+        path_strs[i] = (*env)->GetStringUTFChars(env, path_objects[i], NULL);
+    }
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_chunked_concat_files(path_strs, (int)count, output_path_str, key_str);
+
+    for (jsize i = 0; i < count; i++) {
+        (*env)->ReleaseStringUTFChars(env, path_objects[i], path_strs[i]);
+        (*env)->DeleteLocalRef(env, path_objects[i]);
+    }
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+    free(path_objects);
+    free(path_strs);
+
+    return result;
+}
+
+// JNI wrapper for nativeChunkedTrimFile; a null outputPath trims in place
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeChunkedTrimFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key,
+    jlong start,
+    jlong end) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = NULL;
+    if (outputPath != NULL) {
+        output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    }
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_chunked_trim_file(input_path_str, output_path_str, key_str, (int64_t)start, (int64_t)end);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    if (output_path_str != NULL) {
+        (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    }
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeSparseEncryptFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeSparseEncryptFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_sparse_encrypt_file(input_path_str, output_path_str, key_str);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeSparseDecryptFile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeSparseDecryptFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring inputPath,
+    jstring outputPath,
+    jstring key) {
+
+    const char *input_path_str = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    const char *output_path_str = (*env)->GetStringUTFChars(env, outputPath, NULL);
+    const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+
+    int result = aes_sparse_decrypt_file(input_path_str, output_path_str, key_str);
+
+    (*env)->ReleaseStringUTFChars(env, inputPath, input_path_str);
+    (*env)->ReleaseStringUTFChars(env, outputPath, output_path_str);
+    (*env)->ReleaseStringUTFChars(env, key, key_str);
+
+    return result;
+}
+
+// JNI wrapper for nativeStatsBegin
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeStatsBegin(
+    JNIEnv *env,
+    jobject thiz) {
+
+    aes_stats_begin();
+}
+
+// JNI wrapper for nativeStatsCollect; fills fields with [bytes, wall, read,
+// crypto, write, readCalls, writeCalls, cpu, bufferSize, threads,
+// allocations] and returns the backend name
+JNIEXPORT jstring JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeStatsCollect(
+    JNIEnv *env,
+    jobject thiz,
+    jlongArray fields) {
+
+    aes_op_stats stats;
+    aes_stats_collect(&stats);
+
+    jlong values[11] = {
+        stats.bytes_processed, stats.wall_ns, stats.read_ns, stats.crypto_ns,
+        stats.write_ns, stats.read_calls, stats.write_calls, stats.cpu_ns,
+        stats.buffer_size, stats.threads, stats.allocations
+    };
+    if ((*env)->GetArrayLength(env, fields) >= 11) {
+        (*env)->SetLongArrayRegion(env, fields, 0, 11, values);
+    }
+    return (*env)->NewStringUTF(env, stats.backend);
+}
+
+// JNI wrapper for nativeMetricsSnapshot; returns, for every operation in
+// AES_METRIC_* order and then queue wait, [count, errors, bytes, totalNs,
+// p50Ns, p99Ns, p999Ns, maxNs, errorsByCode...]
+JNIEXPORT jlongArray JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeMetricsSnapshot(
+    JNIEnv *env,
+    jobject thiz) {
+
+    enum { FIELDS = 8 + AES_METRIC_ERROR_CODES };
+    aes_metrics_report report;
+    aes_metrics_snapshot(&report);
+
+    jlong values[(AES_METRIC_OPS + 1) * FIELDS];
+    for (int i = 0; i <= AES_METRIC_OPS; i++) {
+        const aes_op_metrics* m = i < AES_METRIC_OPS ? &report.ops[i] : &report.queue_wait;
+        jlong* out = values + i * FIELDS;
+        out[0] = m->count;
+        out[1] = m->errors;
+        out[2] = m->bytes;
+        out[3] = m->total_ns;
+        out[4] = m->p50_ns;
+        out[5] = m->p99_ns;
+        out[6] = m->p999_ns;
+        out[7] = m->max_ns;
+        for (int code = 0; code < AES_METRIC_ERROR_CODES; code++) {
+            out[8 + code] = m->errors_by_code[code];
+        }
+    }
+
+    jsize length = (jsize)(sizeof(values) / sizeof(values[0]));
+    jlongArray array = (*env)->NewLongArray(env, length);
+    if (array == NULL) {
+        return NULL;
+    }
+    (*env)->SetLongArrayRegion(env, array, 0, length, values);
+    return array;
+}
+
+// JNI wrapper for nativeMetricsPrometheus
+JNIEXPORT jstring JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeMetricsPrometheus(
+    JNIEnv *env,
+    jobject thiz) {
+
+    size_t length = aes_metrics_prometheus(NULL, 0);
+    char *text = malloc(length + 1);
+    if (text == NULL) {
+        return NULL;
+    }
+    aes_metrics_prometheus(text, length + 1);
+    jstring result = (*env)->NewStringUTF(env, text);
+    free(text);
+    return result;
+}
+
+// JNI wrapper for nativeMetricsReset
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeMetricsReset(
+    JNIEnv *env,
+    jobject thiz) {
+
+    aes_metrics_reset();
+}
+
+// JNI wrapper for nativeTraceSetEnabled
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeTraceSetEnabled(
+    JNIEnv *env,
+    jobject thiz,
+    jboolean enabled) {
+
+    aes_trace_set_enabled(enabled ? 1 : 0);
+}
+
+// JNI wrapper for CryptoExecutor.nativeSetThreadPriority; called once by
+// each executor thread as it starts
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_CryptoExecutor_nativeSetThreadPriority(
+    JNIEnv *env,
+    jobject thiz,
+    jboolean background) {
+
+    aes_sched_set_thread_priority(background ? AES_PRIORITY_BACKGROUND : AES_PRIORITY_FOREGROUND);
+}
+
+// JNI wrapper for nativeSetBackgroundBudget
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeSetBackgroundBudget(
+    JNIEnv *env,
+    jobject thiz,
+    jlong bytesPerSecond,
+    jint maxThreads) {
+
+    aes_sched_set_background_budget((int64_t)bytesPerSecond, (int)maxThreads);
+}
+
+// JNI wrapper for nativeMemorySetBudget
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeMemorySetBudget(
+    JNIEnv *env,
+    jobject thiz,
+    jlong bytes) {
+
+    aes_memory_set_budget((int64_t)bytes);
+}
+
+// JNI wrapper for nativeMemoryTrim
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeMemoryTrim(
+    JNIEnv *env,
+    jobject thiz,
+    jint level) {
+
+    aes_memory_trim((int)level);
+}
+
+// JNI wrapper for nativeMemorySnapshot; returns [budget, inUse, pooled, peak,
+// waits, opensslInUse, opensslCached, opensslMallocs]
+JNIEXPORT jlongArray JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeMemorySnapshot(
+    JNIEnv *env,
+    jobject thiz) {
+
+    aes_memory_report report;
+    aes_memory_snapshot(&report);
+    jlong fields[8] = {
+        report.budget, report.in_use, report.pooled, report.peak, report.waits,
+        report.openssl_in_use, report.openssl_cached, report.openssl_mallocs
+    };
+    jlongArray array = (*env)->NewLongArray(env, 8);
+    if (array == NULL) {
+        return NULL;
+    }
+    (*env)->SetLongArrayRegion(env, array, 0, 8, fields);
+    return array;
+}
+
+// Tuning profiles cross JNI as [bufferSize, threads, readAhead,
+// readBytesPerSecond, writeBytesPerSecond, cipherBytesPerSecond]
+static void profile_to_fields(JNIEnv *env, const aes_tune_profile* profile, jlongArray fields) {
+    jlong values[6] = {
+        profile->buffer_size, profile->threads, profile->read_ahead,
+        profile->read_bytes_per_second, profile->write_bytes_per_second, profile->cipher_bytes_per_second
+    };
+    if ((*env)->GetArrayLength(env, fields) >= 6) {
+        (*env)->SetLongArrayRegion(env, fields, 0, 6, values);
+    }
+}
+
+// JNI wrapper for nativeCalibrate; fills fields with the measured profile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_DeviceTuner_nativeCalibrate(
+    JNIEnv *env,
+    jobject thiz,
+    jstring directory,
+    jlongArray fields) {
+
+    const char *directory_str = (*env)->GetStringUTFChars(env, directory, NULL);
+    aes_tune_profile profile;
+    int result = aes_tune_calibrate(directory_str, &profile);
+    (*env)->ReleaseStringUTFChars(env, directory, directory_str);
+
+    if (result == 0) {
+        profile_to_fields(env, &profile, fields);
+    }
+    return result;
+}
+
+// JNI wrapper for nativeApply; a null directory sets the default profile
+JNIEXPORT jint JNICALL
+Java_com_example_aes_1encrypt_1file_DeviceTuner_nativeApply(
+    JNIEnv *env,
+    jobject thiz,
+    jstring directory,
+    jlongArray fields) {
+
+    jlong values[6] = {0};
+    jsize count = (*env)->GetArrayLength(env, fields);
+    (*env)->GetLongArrayRegion(env, fields, 0, count < 6 ? count : 6, values);
+    aes_tune_profile profile = {
+        (int32_t)values[0], (int32_t)values[1], (int32_t)values[2],
+        (int64_t)values[3], (int64_t)values[4], (int64_t)values[5]
+    };
+
+    const char *directory_str = NULL;
+    if (directory != NULL) {
+        directory_str = (*env)->GetStringUTFChars(env, directory, NULL);
+    }
+    int result = aes_tune_apply(directory_str, &profile);
+    if (directory_str) {
+        (*env)->ReleaseStringUTFChars(env, directory, directory_str);
+    }
+    return result;
+}
+
+// JNI wrapper for nativeMountPoint
+JNIEXPORT jstring JNICALL
+Java_com_example_aes_1encrypt_1file_DeviceTuner_nativeMountPoint(
+    JNIEnv *env,
+    jobject thiz,
+    jstring directory) {
+
+    const char *directory_str = (*env)->GetStringUTFChars(env, directory, NULL);
+    char mount_point[4096];
+    int result = aes_tune_mount_point(directory_str, mount_point, sizeof(mount_point));
+    (*env)->ReleaseStringUTFChars(env, directory, directory_str);
+
+    return result == 0 ? (*env)->NewStringUTF(env, mount_point) : NULL;
+}
+
+// JNI wrapper for nativeSetOptions
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_DeviceTuner_nativeSetOptions(
+    JNIEnv *env,
+    jobject thiz,
+    jint bufferSize,
+    jint threads,
+    jint readAhead) {
+
+    aes_tune_options options = { (int32_t)bufferSize, (int32_t)threads, (int32_t)readAhead };
+    aes_tune_set_options(&options);
+}
+
+// JNI wrapper for nativeEffective; fills fields with the settings in force
+JNIEXPORT void JNICALL
+Java_com_example_aes_1encrypt_1file_DeviceTuner_nativeEffective(
+    JNIEnv *env,
+    jobject thiz,
+    jstring directory,
+    jlongArray fields) {
+
+    const char *directory_str = NULL;
+    if (directory != NULL) {
+        directory_str = (*env)->GetStringUTFChars(env, directory, NULL);
+    }
+    aes_tune_profile profile;
+    aes_tune_effective(directory_str, &profile);
+    if (directory_str) {
+        (*env)->ReleaseStringUTFChars(env, directory, directory_str);
+    }
+    profile_to_fields(env, &profile, fields);
+}
+
+// Copy a Java String[] into malloc'd C strings, dropping each local
+// reference as it goes so large batches stay within the local table
+static char **copy_path_array(JNIEnv *env, jobjectArray paths, jsize count) {
+    char **strs = (char **)calloc(count > 0 ? count : 1, sizeof(char *));
+    if (!strs) return NULL;
+    for (jsize i = 0; i < count; i++) {
+        jstring path = (jstring)(*env)->GetObjectArrayElement(env, paths, i);
+        const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+        strs[i] = path_str ? strdup(path_str) : NULL;
+        if (path_str) (*env)->ReleaseStringUTFChars(env, path, path_str);
+        (*env)->DeleteLocalRef(env, path);
+        if (!strs[i]) {
+            for (jsize j = 0; j < i; j++) free(strs[j]);
+            free(strs);
+            return NULL;
+        }
+    }
+    return strs;
+}
+
+static void free_path_array(char **strs, jsize count) {
+    if (!strs) return;
+    for (jsize i = 0; i < count; i++) free(strs[i]);
+    free(strs);
+}
+
+// JNI wrapper for nativeBatchFiles; returns one result code per file, or
+// null if the batch couldn't start
+JNIEXPORT jintArray JNICALL
+Java_com_example_aes_1encrypt_1file_AesEncryptFilePlugin_nativeBatchFiles(
+    JNIEnv *env,
+    jobject thiz,
+    jint mode,
+    jobjectArray inputPaths,
+    jobjectArray outputPaths,
+    jstring key,
+    jboolean sync) {
+
+    jsize count = (*env)->GetArrayLength(env, inputPaths);
+    if ((*env)->GetArrayLength(env, outputPaths) != count) {
+        return NULL;
+    }
+    char **input_strs = copy_path_array(env, inputPaths, count);
+    char **output_strs = copy_path_array(env, outputPaths, count);
+    jint *results = (jint *)calloc(count > 0 ? count : 1, sizeof(jint));
+    int failed = -3;
+    if (input_strs && output_strs && results) {
+        const char *key_str = (*env)->GetStringUTFChars(env, key, NULL);
+        failed = aes_batch_files((int)mode, (const char *const *)input_strs, (const char *const *)output_strs,
+                                 (int)count, key_str, sync ? AES_BATCH_SYNC : 0, (int *)results);
+        (*env)->ReleaseStringUTFChars(env, key, key_str);
+    }
+    free_path_array(input_strs, count);
+    free_path_array(output_strs, count);
+
+    jintArray array = failed >= 0 ? (*env)->NewIntArray(env, count) : NULL;
+    if (array != NULL) {
+        (*env)->SetIntArrayRegion(env, array, 0, count, results);
+    }
+    free(results);
+    return array;
+}
@@ -1,40 +1,102 @@
 package com.example.aes_encrypt_file
 
+import android.content.ComponentCallbacks2
+import android.content.ContentResolver
+import android.content.Context
+import android.content.res.Configuration
+import android.net.Uri
+import android.os.ParcelFileDescriptor
 import io.flutter.embedding.engine.plugins.FlutterPlugin
 import io.flutter.plugin.common.MethodCall
 import io.flutter.plugin.common.MethodChannel
 import io.flutter.plugin.common.MethodChannel.MethodCallHandler
 import io.flutter.plugin.common.MethodChannel.Result
 import java.io.File
+import java.io.FileNotFoundException
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicInteger
 
 class AesEncryptFilePlugin: FlutterPlugin, MethodCallHandler {
     private lateinit var channel: MethodChannel
+    private lateinit var context: Context
+
+    // Open native readers, keyed by the id handed out to Dart. A read holds the
+    // handle's lock for as long as it blocks on disk, so the main thread only
+    // ever uses the size cached at open and closes on a worker.
+    private class ReaderHandle(val pointer: Long, val size: Long) {
+        var closed = false
+    }
+    private val readers = ConcurrentHashMap<Int, ReaderHandle>()
+    private val nextReaderId = AtomicInteger(1)
+
+    // Running follow-mode encryptions (native pointers), keyed by the id handed out to Dart
+    private val followers = ConcurrentHashMap<Int, Long>()
+    private val nextFollowerId = AtomicInteger(1)
+
+    // Sealed memfds holding decrypted plaintext, closed on release or detach
+    private val memoryFiles = ConcurrentHashMap<Int, ParcelFileDescriptor>()
+
+    // Lane for calls that don't pass a priority, set per engine from Dart
+    @Volatile private var defaultLane = CryptoExecutor.Lane.FOREGROUND
+
+    // Native memory follows the system's trim requests; the budget itself is
+    // process-wide, so every attached engine forwards them
+    private val trimCallbacks = object : ComponentCallbacks2 {
+        override fun onTrimMemory(level: Int) {
+            val complete = level == ComponentCallbacks2.TRIM_MEMORY_RUNNING_CRITICAL ||
+                level >= ComponentCallbacks2.TRIM_MEMORY_COMPLETE
+            trimMemory(complete)
+        }
+
+        override fun onLowMemory() = trimMemory(true)
+
+        override fun onConfigurationChanged(newConfig: Configuration) {}
+    }
+
+    // Operation names in native AES_METRIC_* order
+    private val metricOperations = listOf("encrypt", "decrypt", "rekey", "append", "verify", "read")
 
     override fun onAttachedToEngine(flutterPluginBinding: FlutterPlugin.FlutterPluginBinding) {
         channel = MethodChannel(flutterPluginBinding.binaryMessenger, "aes_encrypt_file")
         channel.setMethodCallHandler(this)
+        context = flutterPluginBinding.applicationContext
 
         // Load native library
         System.loadLibrary("native_crypto")
+        context.registerComponentCallbacks(trimCallbacks)
     }
 
-    override fun onMethodCall(call: MethodCall, result: Result) {
+    override fun onMethodCall(call: MethodCall, rawResult: Result) {
+        val result = CryptoExecutor.onMainThread(rawResult)
         when (call.method) {
             "encryptFile" -> {
                 val inputPath = call.argument<String>("inputPath")
                 val outputPath = call.argument<String>("outputPath")
                 val key = call.argument<String>("key")
                 val iv = call.argument<String>("iv")
+                val resumable = call.argument<Boolean>("resumable") ?: false
+                val header = call.argument<Boolean>("header") ?: false
 
                 if (inputPath != null && outputPath != null && key != null) {
-                    Thread {
+                    execute(call) {
                         try {
-                            val success = nativeEncryptFile(inputPath, outputPath, key, iv)
-                            result.success(success == 0)
+                            replyWithStats(call, result) {
+                                if (isContentUri(inputPath) || isContentUri(outputPath)) {
+                                    withDescriptors(inputPath, outputPath) { inputFd, outputFd ->
+                                        nativeEncryptFd(inputFd, outputFd, key, iv, header)
+                                    }
+                                } else if (resumable) {
+                                    nativeEncryptFileResumable(inputPath, outputPath, key, iv)
+                                } else if (header) {
+                                    nativeEncryptFileWithHeader(inputPath, outputPath, key, iv)
+                                } else {
+                                    nativeEncryptFile(inputPath, outputPath, key, iv)
+                                }
+                            }
                         } catch (e: Exception) {
                             result.error("ENCRYPT_FAILED", e.message, null)
                         }
-                    }.start()
+                    }
                 } else {
                     result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
                 }
@@ -46,14 +108,65 @@ class AesEncryptFilePlugin: FlutterPlugin, MethodCallHandler {
                 val iv = call.argument<String>("iv")
 
                 if (inputPath != null && outputPath != null && key != null) {
-                    Thread {
+                    execute(call) {
                         try {
-                            val success = nativeDecryptFile(inputPath, outputPath, key, iv)
-                            result.success(success == 0)
+                            replyWithStats(call, result) {
+                                if (isContentUri(inputPath) || isContentUri(outputPath)) {
+                                    withDescriptors(inputPath, outputPath) { inputFd, outputFd ->
+                                        nativeDecryptFd(inputFd, outputFd, key, iv)
+                                    }
+                                } else {
+                                    nativeDecryptFile(inputPath, outputPath, key, iv)
+                                }
+                            }
                         } catch (e: Exception) {
                             result.error("DECRYPT_FAILED", e.message, null)
                         }
-                    }.start()
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "encryptFiles", "decryptFiles" -> {
+                val inputPaths = call.argument<List<String>>("inputPaths")
+                val outputPaths = call.argument<List<String>>("outputPaths")
+                val key = call.argument<String>("key")
+                val sync = call.argument<Boolean>("sync") ?: false
+                val mode = if (call.method == "decryptFiles") 1 else 0  // AES_BATCH_DECRYPT / AES_BATCH_ENCRYPT
+
+                if (inputPaths != null && outputPaths != null && inputPaths.size == outputPaths.size && key != null &&
+                    (inputPaths + outputPaths).none { isContentUri(it) }) {
+                    execute(call) {
+                        try {
+                            val codes = nativeBatchFiles(mode, inputPaths.toTypedArray(), outputPaths.toTypedArray(), key, sync)
+                            if (codes != null) {
+                                result.success(codes.map { it == 0 })
+                            } else {
+                                result.error(if (mode == 1) "DECRYPT_FAILED" else "ENCRYPT_FAILED", "Failed to start batch", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error(if (mode == 1) "DECRYPT_FAILED" else "ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "appendFile" -> {
+                val encryptedPath = call.argument<String>("encryptedPath")
+                val inputPath = call.argument<String>("inputPath")
+                val key = call.argument<String>("key")
+                val sync = call.argument<Boolean>("sync") ?: false
+
+                if (encryptedPath != null && inputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            val success = nativeAppendFile(encryptedPath, inputPath, key, sync)
+                            result.success(success == 0)
+                        } catch (e: Exception) {
+                            result.error("APPEND_FAILED", e.message, null)
+                        }
+                    }
                 } else {
                     result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
                 }
@@ -61,28 +174,800 @@ class AesEncryptFilePlugin: FlutterPlugin, MethodCallHandler {
             "getFileSize" -> {
                 val path = call.arguments as? String
                 if (path != null) {
-                    Thread {
+                    execute(call) {
                         try {
                             val size = nativeGetFileSize(path)
                             result.success(size)
                         } catch (e: Exception) {
                             result.error("SIZE_ERROR", e.message, null)
                         }
-                    }.start()
+                    }
                 } else {
                     result.error("INVALID_PATH", "File path is required", null)
                 }
             }
+            "getFileInfo" -> {
+                val paths = call.argument<List<String>>("paths")
+                if (paths != null) {
+                    execute(call) {
+                        try {
+                            // Header-only reads, so a whole listing is answered in one call
+                            val infos = paths.map { path ->
+                                val iv = ByteArray(16)
+                                nativeFileInfo(path, iv)?.let { fields ->
+                                    mapOf(
+                                        "format" to fields[0].toInt(),
+                                        "version" to fields[1].toInt(),
+                                        "algorithm" to fields[2].toInt(),
+                                        "chunkSize" to fields[3],
+                                        "headerSize" to fields[4],
+                                        "fileSize" to fields[5],
+                                        "plaintextSize" to fields[6],
+                                        "iv" to if (fields[7] != 0L) iv else null
+                                    )
+                                }
+                            }
+                            result.success(infos)
+                        } catch (e: Exception) {
+                            result.error("INFO_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "verifyFile" -> {
+                val path = call.argument<String>("path")
+                val key = call.argument<String>("key")
+                val expectedSha256 = call.argument<ByteArray>("expectedSha256")
+                val lowPriority = call.argument<Boolean>("lowPriority") ?: false
+
+                if (path != null && key != null) {
+                    execute(call) {
+                        try {
+                            val sha256 = ByteArray(32)
+                            val fields = nativeVerifyFile(path, key, expectedSha256, lowPriority, sha256)
+                            if (fields == null) {
+                                result.error("VERIFY_FAILED", "Out of memory", null)
+                            } else {
+                                result.success(mapOf(
+                                    "error" to fields[0].toInt(),
+                                    "passed" to (fields[1] != 0L),
+                                    "firstBadOffset" to fields[2],
+                                    "bytesVerified" to fields[3],
+                                    "sha256" to if (fields[0] == 0L) sha256 else null
+                                ))
+                            }
+                        } catch (e: Exception) {
+                            result.error("VERIFY_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "rekeyFile" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val oldKey = call.argument<String>("oldKey")
+                val newKey = call.argument<String>("newKey")
+
+                if (inputPath != null && oldKey != null && newKey != null) {
+                    execute(call) {
+                        try {
+                            replyWithStats(call, result) {
+                                nativeRekeyFile(inputPath, outputPath, oldKey, newKey)
+                            }
+                        } catch (e: Exception) {
+                            result.error("REKEY_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "envelopeEncryptFile" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+
+                if (inputPath != null && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            val success = nativeEnvelopeEncryptFile(inputPath, outputPath, key)
+                            result.success(success == 0)
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "envelopeDecryptFile" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+
+                if (inputPath != null && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            val success = nativeEnvelopeDecryptFile(inputPath, outputPath, key)
+                            result.success(success == 0)
+                        } catch (e: Exception) {
+                            result.error("DECRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "sparseEncryptFile" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+
+                if (inputPath != null && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            val success = nativeSparseEncryptFile(inputPath, outputPath, key)
+                            result.success(success == 0)
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "sparseDecryptFile" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+
+                if (inputPath != null && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            val success = nativeSparseDecryptFile(inputPath, outputPath, key)
+                            result.success(success == 0)
+                        } catch (e: Exception) {
+                            result.error("DECRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "rewrapFileKeys" -> {
+                val paths = call.argument<List<String>>("paths")
+                val oldKey = call.argument<String>("oldKey")
+                val newKey = call.argument<String>("newKey")
+
+                if (paths != null && oldKey != null && newKey != null) {
+                    execute(call) {
+                        try {
+                            // Each file only has its header rewritten; report the ones that failed
+                            val failed = paths.filter { nativeEnvelopeRewrap(it, oldKey, newKey) != 0 }
+                            result.success(failed)
+                        } catch (e: Exception) {
+                            result.error("REKEY_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "encryptFileIncremental" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+                val chunkSize = call.argument<Int>("chunkSize") ?: 0
+
+                if (inputPath != null && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            result.success(nativeChunkedSyncFile(inputPath, outputPath, key, chunkSize))
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "decryptChunkedFile" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+
+                if (inputPath != null && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            result.success(nativeChunkedDecryptFile(inputPath, outputPath, key) == 0)
+                        } catch (e: Exception) {
+                            result.error("DECRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "concatChunkedFiles" -> {
+                val inputPaths = call.argument<List<String>>("inputPaths")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+
+                if (inputPaths != null && inputPaths.isNotEmpty() && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            result.success(nativeChunkedConcatFiles(inputPaths.toTypedArray(), outputPath, key) == 0)
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "trimChunkedFile" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+                val start = call.argument<Number>("start")?.toLong() ?: 0L
+                val end = call.argument<Number>("end")?.toLong() ?: -1L
+
+                if (inputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            result.success(nativeChunkedTrimFile(inputPath, outputPath, key, start, end) == 0)
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "encryptFileSegments" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPrefix = call.argument<String>("outputPrefix")
+                val key = call.argument<String>("key")
+                val segmentSize = call.argument<Number>("segmentSize")?.toLong() ?: 0L
+
+                if (inputPath != null && outputPrefix != null && key != null) {
+                    execute(call) {
+                        try {
+                            result.success(nativeSegmentEncryptFile(inputPath, outputPrefix, key, segmentSize))
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "joinFileSegments" -> {
+                val manifestPath = call.argument<String>("manifestPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+
+                if (manifestPath != null && outputPath != null && key != null) {
+                    execute(call) {
+                        try {
+                            result.success(nativeSegmentJoinFile(manifestPath, outputPath, key) == 0)
+                        } catch (e: Exception) {
+                            result.error("DECRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "readerOpen" -> {
+                val path = call.argument<String>("path")
+                val key = call.argument<String>("key")
+
+                if (path != null && key != null) {
+                    execute(call) {
+                        try {
+                            val pointer = nativeReaderOpen(path, key)
+                            if (pointer == 0L) {
+                                result.error("READER_OPEN_FAILED", "Cannot open $path", null)
+                            } else {
+                                val id = nextReaderId.getAndIncrement()
+                                readers[id] = ReaderHandle(pointer, nativeReaderSize(pointer))
+                                result.success(id)
+                            }
+                        } catch (e: Exception) {
+                            result.error("READER_OPEN_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "readerRead" -> {
+                val reader = call.argument<Int>("handle")?.let { readers[it] }
+                val offset = call.argument<Number>("offset")?.toLong()
+                val length = call.argument<Int>("length")
+
+                if (reader != null && offset != null && length != null) {
+                    execute(call) {
+                        try {
+                            val bytes = synchronized(reader) {
+                                if (reader.closed) null else nativeReaderRead(reader.pointer, offset, length)
+                            }
+                            if (bytes != null) {
+                                result.success(bytes)
+                            } else {
+                                result.error("READ_FAILED", "Read failed at offset $offset", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("READ_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "readerLength" -> {
+                val reader = call.argument<Int>("handle")?.let { readers[it] }
+                if (reader != null) {
+                    result.success(reader.size)
+                } else {
+                    result.error("INVALID_HANDLE", "Reader is not open", null)
+                }
+            }
+            "readerClose" -> {
+                val reader = call.argument<Int>("handle")?.let { readers.remove(it) }
+                if (reader != null) {
+                    // Waits for a read in flight to finish first
+                    execute(call) {
+                        closeReader(reader)
+                        result.success(null)
+                    }
+                } else {
+                    result.success(null)
+                }
+            }
+            "decryptFileToBytes" -> {
+                val path = call.argument<String>("path")
+                val key = call.argument<String>("key")
+
+                if (path != null && key != null) {
+                    execute(call) {
+                        try {
+                            val bytes = nativeDecryptToBytes(path, key)
+                            if (bytes != null) {
+                                result.success(bytes)
+                            } else {
+                                result.error("DECRYPT_FAILED", "Decryption to memory failed", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("DECRYPT_FAILED", e.message, null)
+                        } catch (e: OutOfMemoryError) {
+                            result.error("DECRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "encryptBytesToFile" -> {
+                val bytes = call.argument<ByteArray>("bytes")
+                val path = call.argument<String>("path")
+                val key = call.argument<String>("key")
+                val header = call.argument<Boolean>("header") ?: false
+
+                if (bytes != null && path != null && key != null) {
+                    execute(call) {
+                        try {
+                            val success = nativeEncryptBytesToFile(bytes, path, key, header)
+                            result.success(success == 0)
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "decryptToMemory" -> {
+                val path = call.argument<String>("path")
+                val key = call.argument<String>("key")
+
+                if (path != null && key != null) {
+                    execute(call) {
+                        try {
+                            val fd = nativeDecryptToMemfd(path, key, File(path).name)
+                            if (fd >= 0) {
+                                val descriptor = ParcelFileDescriptor.adoptFd(fd)
+                                memoryFiles[fd] = descriptor
+                                result.success(mapOf(
+                                    "fd" to fd,
+                                    "path" to "/proc/self/fd/$fd",
+                                    "length" to descriptor.statSize
+                                ))
+                            } else {
+                                result.error("DECRYPT_FAILED", "Decryption to memory failed ($fd)", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("DECRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "releaseMemoryFile" -> {
+                call.argument<Int>("fd")?.let { memoryFiles.remove(it) }?.close()
+                result.success(null)
+            }
+            "startFollowEncryption" -> {
+                val inputPath = call.argument<String>("inputPath")
+                val outputPath = call.argument<String>("outputPath")
+                val key = call.argument<String>("key")
+                val header = call.argument<Boolean>("header") ?: false
+                val finishOnClose = call.argument<Boolean>("finishOnClose") ?: false
+
+                if (inputPath != null && outputPath != null && key != null) {
+                    val pointer = nativeFollowStart(inputPath, outputPath, key, header, finishOnClose)
+                    if (pointer != 0L) {
+                        val id = nextFollowerId.getAndIncrement()
+                        followers[id] = pointer
+                        result.success(id)
+                    } else {
+                        result.error("ENCRYPT_FAILED", "Cannot follow $inputPath", null)
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "followProgress" -> {
+                val pointer = call.argument<Int>("handle")?.let { followers[it] }
+                result.success(if (pointer != null) nativeFollowProgress(pointer) else -1L)
+            }
+            "finishFollowEncryption" -> {
+                val pointer = call.argument<Int>("handle")?.let { followers.remove(it) }
+                if (pointer != null) {
+                    execute(call) {
+                        try {
+                            result.success(nativeFollowFinish(pointer) == 0)
+                        } catch (e: Exception) {
+                            result.error("ENCRYPT_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Unknown follow handle", null)
+                }
+            }
+            "registerStream" -> {
+                val path = call.argument<String>("path")
+                val key = call.argument<String>("key")
+                val mimeType = call.argument<String>("mimeType")
+
+                if (path != null && key != null) {
+                    execute(call) {
+                        try {
+                            val port = nativeStreamServerStart()
+                            val token = if (port > 0) nativeStreamServerAdd(path, key, mimeType) else null
+                            if (token != null) {
+                                // Keep the file name so players can sniff the container from the URL
+                                result.success("http://127.0.0.1:$port/$token/${Uri.encode(File(path).name)}")
+                            } else {
+                                result.error("STREAM_FAILED", "Cannot stream $path", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("STREAM_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "unregisterStream" -> {
+                val token = call.argument<String>("token")
+                if (token != null) {
+                    nativeStreamServerRemove(token)
+                    result.success(null)
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "stopStreamServer" -> {
+                execute(call) {
+                    nativeStreamServerStop()
+                    result.success(null)
+                }
+            }
+            "getMetrics" -> {
+                // A snapshot only copies native counters, so no worker thread is needed
+                val fields = nativeMetricsSnapshot()
+                if (fields != null) {
+                    val stride = fields.size / (metricOperations.size + 1)
+                    fun entry(index: Int): Map<String, Any> {
+                        val base = index * stride
+                        return mapOf(
+                            "count" to fields[base],
+                            "errors" to fields[base + 1],
+                            "bytes" to fields[base + 2],
+                            "totalNanos" to fields[base + 3],
+                            "p50Nanos" to fields[base + 4],
+                            "p99Nanos" to fields[base + 5],
+                            "p999Nanos" to fields[base + 6],
+                            "maxNanos" to fields[base + 7],
+                            "errorsByCode" to (8 until stride).associate { slot ->
+                                (if (slot == 8) 0 else 8 - slot) to fields[base + slot]
+                            }.filterValues { it != 0L }
+                        )
+                    }
+                    result.success(
+                        mapOf(
+                            "operations" to metricOperations.withIndex().associate { (i, name) -> name to entry(i) },
+                            "queueWait" to entry(metricOperations.size)
+                        )
+                    )
+                } else {
+                    result.error("METRICS_FAILED", "Cannot read metrics", null)
+                }
+            }
+            "getMetricsText" -> {
+                result.success(nativeMetricsPrometheus())
+            }
+            "resetMetrics" -> {
+                nativeMetricsReset()
+                result.success(null)
+            }
+            "setTaskPriority" -> {
+                val priority = call.argument<String>("priority")
+                if (priority == "foreground" || priority == "background") {
+                    defaultLane = laneOf(priority)
+                    result.success(null)
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "setBackgroundBudget" -> {
+                val bytesPerSecond = call.argument<Number>("bytesPerSecond")?.toLong() ?: 0L
+                val maxThreads = call.argument<Int>("maxThreads") ?: 0
+                nativeSetBackgroundBudget(bytesPerSecond, maxThreads)
+                result.success(null)
+            }
+            "setMemoryBudget" -> {
+                nativeMemorySetBudget(call.argument<Number>("bytes")?.toLong() ?: 0L)
+                result.success(null)
+            }
+            "trimMemory" -> {
+                trimMemory(call.argument<Boolean>("complete") ?: false) { result.success(null) }
+            }
+            "getMemoryUsage" -> {
+                val fields = nativeMemorySnapshot()
+                if (fields != null) {
+                    result.success(mapOf(
+                        "budget" to fields[0],
+                        "inUse" to fields[1],
+                        "pooled" to fields[2],
+                        "peak" to fields[3],
+                        "waits" to fields[4],
+                        "opensslInUse" to fields[5],
+                        "opensslCached" to fields[6],
+                        "opensslMallocs" to fields[7]
+                    ))
+                } else {
+                    result.error("MEMORY_FAILED", "Failed to read memory usage", null)
+                }
+            }
+            "calibrate" -> {
+                val directory = call.argument<String>("directory")
+                if (directory != null) {
+                    execute(call) {
+                        try {
+                            val fields = DeviceTuner.calibrate(context, directory)
+                            if (fields != null) {
+                                result.success(tuningMap(fields))
+                            } else {
+                                result.error("CALIBRATE_FAILED", "Failed to calibrate $directory", null)
+                            }
+                        } catch (e: Exception) {
+                            result.error("CALIBRATE_FAILED", e.message, null)
+                        }
+                    }
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
+            "setTuningOptions" -> {
+                DeviceTuner.setOptions(
+                    call.argument<Int>("bufferSize") ?: 0,
+                    call.argument<Int>("threads") ?: 0,
+                    call.argument<Int>("readAhead") ?: 0
+                )
+                DeviceTuner.autoCalibrate = call.argument<Boolean>("autoCalibrate") ?: true
+                result.success(null)
+            }
+            "getTuningProfile" -> {
+                result.success(tuningMap(DeviceTuner.effective(call.argument<String>("directory"))))
+            }
+            "setTraceEnabled" -> {
+                val enabled = call.argument<Boolean>("enabled")
+                if (enabled != null) {
+                    nativeTraceSetEnabled(enabled)
+                    result.success(null)
+                } else {
+                    result.error("INVALID_ARGUMENTS", "Missing required parameters", null)
+                }
+            }
             else -> result.notImplemented()
         }
     }
 
+    private fun isContentUri(location: String) =
+        location.startsWith(ContentResolver.SCHEME_CONTENT + ":")
+
+    // content:// URIs (SAF picker, MediaStore) are opened through the
+    // ContentResolver; plain paths are opened directly
+    private fun openDescriptor(location: String, mode: String): ParcelFileDescriptor {
+        return if (isContentUri(location)) {
+            context.contentResolver.openFileDescriptor(Uri.parse(location), mode)
+                ?: throw FileNotFoundException(location)
+        } else {
+            ParcelFileDescriptor.open(File(location), ParcelFileDescriptor.parseMode(mode))
+        }
+    }
+
+    // Hands the raw fds to native code so imported files are never copied
+    // into app storage first; both descriptors are closed afterwards
+    private fun withDescriptors(inputPath: String, outputPath: String, block: (Int, Int) -> Int): Int {
+        openDescriptor(inputPath, "r").use { input ->
+            openDescriptor(outputPath, "wt").use { output ->
+                return block(input.fd, output.fd)
+            }
+        }
+    }
+
+    // Runs native work on the shared executor, in the lane named by the
+    // call's "priority" argument or this engine's default, after making sure
+    // the filesystem it writes to (or reads from) has been tuned
+    private fun execute(call: MethodCall, block: () -> Unit) {
+        val arguments = call.arguments as? Map<*, *>
+        val requested = arguments?.get("priority") as? String
+        val target = listOf(arguments?.get("outputPath"), arguments?.get("inputPath"),
+                            (arguments?.get("outputPaths") as? List<*>)?.firstOrNull())
+            .filterIsInstance<String>()
+            .firstOrNull { !isContentUri(it) }
+        CryptoExecutor.execute(if (requested != null) laneOf(requested) else defaultLane) {
+            if (target != null) DeviceTuner.ensureTuned(context, target)
+            block()
+        }
+    }
+
+    private fun closeReader(reader: ReaderHandle) {
+        synchronized(reader) {
+            reader.closed = true
+            nativeReaderClose(reader.pointer)
+        }
+    }
+
+    // Trimming waits for readers mid-read to finish their chunk, so it runs
+    // on a worker rather than the main thread that delivers onTrimMemory
+    private fun trimMemory(complete: Boolean, done: () -> Unit = {}) {
+        CryptoExecutor.execute(CryptoExecutor.Lane.FOREGROUND) {
+            nativeMemoryTrim(if (complete) 2 else 1)  // AES_TRIM_COMPLETE / AES_TRIM_MODERATE
+            done()
+        }
+    }
+
+    private fun tuningMap(fields: LongArray) = mapOf(
+        "bufferSize" to fields[0],
+        "threads" to fields[1],
+        "readAhead" to fields[2],
+        "readBytesPerSecond" to fields[3],
+        "writeBytesPerSecond" to fields[4],
+        "cipherBytesPerSecond" to fields[5]
+    )
+
+    private fun laneOf(priority: String) =
+        if (priority == "background") CryptoExecutor.Lane.BACKGROUND else CryptoExecutor.Lane.FOREGROUND
+
+    // Replies with a bool, or with the success flag plus the native
+    // operation stats when the caller asked for them
+    private fun replyWithStats(call: MethodCall, result: Result, operation: () -> Int) {
+        if (call.argument<Boolean>("stats") != true) {
+            result.success(operation() == 0)
+            return
+        }
+        val fields = LongArray(11)
+        var backend = ""
+        nativeStatsBegin()
+        val success = try {
+            operation() == 0
+        } finally {
+            backend = nativeStatsCollect(fields)
+        }
+        result.success(
+            mapOf(
+                "success" to success,
+                "stats" to mapOf(
+                    "bytesProcessed" to fields[0],
+                    "wallNanos" to fields[1],
+                    "readNanos" to fields[2],
+                    "cryptoNanos" to fields[3],
+                    "writeNanos" to fields[4],
+                    "readCalls" to fields[5],
+                    "writeCalls" to fields[6],
+                    "cpuNanos" to fields[7],
+                    "bufferSize" to fields[8],
+                    "threads" to fields[9],
+                    "allocations" to fields[10],
+                    "backend" to backend
+                )
+            )
+        )
+    }
+
     override fun onDetachedFromEngine(binding: FlutterPlugin.FlutterPluginBinding) {
         channel.setMethodCallHandler(null)
+        context.unregisterComponentCallbacks(trimCallbacks)
+        val openReaders = readers.keys.mapNotNull { readers.remove(it) }
+        if (openReaders.isNotEmpty()) {
+            CryptoExecutor.execute(CryptoExecutor.Lane.FOREGROUND) { openReaders.forEach { closeReader(it) } }
+        }
+        for (fd in memoryFiles.keys) {
+            memoryFiles.remove(fd)?.close()
+        }
+        // Finishing flushes the tail and fsyncs, so keep it off the main thread
+        val pending = followers.keys.mapNotNull { followers.remove(it) }
+        if (pending.isNotEmpty()) {
+            CryptoExecutor.execute(CryptoExecutor.Lane.BACKGROUND) { pending.forEach { nativeFollowFinish(it) } }
+        }
     }
 
     // Native method declarations
     private external fun nativeEncryptFile(inputPath: String, outputPath: String, key: String, iv: String?): Int
+    private external fun nativeEncryptFileResumable(inputPath: String, outputPath: String, key: String, iv: String?): Int
     private external fun nativeDecryptFile(inputPath: String, outputPath: String, key: String, iv: String?): Int
+    private external fun nativeBatchFiles(mode: Int, inputPaths: Array<String>, outputPaths: Array<String>, key: String, sync: Boolean): IntArray?
+    private external fun nativeAppendFile(encryptedPath: String, inputPath: String, key: String, sync: Boolean): Int
     private external fun nativeGetFileSize(path: String): Long
+    private external fun nativeEncryptFileWithHeader(inputPath: String, outputPath: String, key: String, iv: String?): Int
+    private external fun nativeFileInfo(path: String, iv: ByteArray): LongArray?
+    private external fun nativeEncryptFd(inputFd: Int, outputFd: Int, key: String, iv: String?, header: Boolean): Int
+    private external fun nativeDecryptFd(inputFd: Int, outputFd: Int, key: String, iv: String?): Int
+    private external fun nativeChunkedConcatFiles(inputPaths: Array<String>, outputPath: String, key: String): Int
+    private external fun nativeChunkedTrimFile(inputPath: String, outputPath: String?, key: String, start: Long, end: Long): Int
+    private external fun nativeSegmentEncryptFile(inputPath: String, outputPrefix: String, key: String, segmentSize: Long): Int
+    private external fun nativeSegmentJoinFile(manifestPath: String, outputPath: String, key: String): Int
+    private external fun nativeFollowStart(inputPath: String, outputPath: String, key: String, header: Boolean, finishOnClose: Boolean): Long
+    private external fun nativeFollowProgress(handle: Long): Long
+    private external fun nativeFollowFinish(handle: Long): Int
+    private external fun nativeDecryptToBytes(path: String, key: String): ByteArray?
+    private external fun nativeEncryptBytesToFile(data: ByteArray, path: String, key: String, header: Boolean): Int
+    private external fun nativeDecryptToMemfd(path: String, key: String, name: String?): Int
+    private external fun nativeVerifyFile(path: String, key: String, expectedSha256: ByteArray?, lowPriority: Boolean, sha256: ByteArray): LongArray?
+    private external fun nativeRekeyFile(inputPath: String, outputPath: String?, oldKey: String, newKey: String): Int
+    private external fun nativeEnvelopeEncryptFile(inputPath: String, outputPath: String, key: String): Int
+    private external fun nativeEnvelopeDecryptFile(inputPath: String, outputPath: String, key: String): Int
+    private external fun nativeEnvelopeRewrap(path: String, oldKey: String, newKey: String): Int
+    private external fun nativeSparseEncryptFile(inputPath: String, outputPath: String, key: String): Int
+    private external fun nativeSparseDecryptFile(inputPath: String, outputPath: String, key: String): Int
+    private external fun nativeStatsBegin()
+    private external fun nativeStatsCollect(fields: LongArray): String
+    private external fun nativeMetricsSnapshot(): LongArray?
+    private external fun nativeMetricsPrometheus(): String?
+    private external fun nativeMetricsReset()
+    private external fun nativeTraceSetEnabled(enabled: Boolean)
+    private external fun nativeSetBackgroundBudget(bytesPerSecond: Long, maxThreads: Int)
+    private external fun nativeMemorySetBudget(bytes: Long)
+    private external fun nativeMemoryTrim(level: Int)
+    private external fun nativeMemorySnapshot(): LongArray?
+    private external fun nativeChunkedSyncFile(inputPath: String, outputPath: String, key: String, chunkSize: Int): Int
+    private external fun nativeChunkedDecryptFile(inputPath: String, outputPath: String, key: String): Int
+    private external fun nativeReaderOpen(path: String, key: String): Long
+    private external fun nativeReaderRead(handle: Long, offset: Long, length: Int): ByteArray?
+    private external fun nativeReaderSize(handle: Long): Long
+    private external fun nativeReaderClose(handle: Long)
+    private external fun nativeStreamServerStart(): Int
+    private external fun nativeStreamServerStop()
+    private external fun nativeStreamServerAdd(path: String, key: String, mimeType: String?): String?
+    private external fun nativeStreamServerRemove(token: String)
 }/** AesEncryptFilePlugin */
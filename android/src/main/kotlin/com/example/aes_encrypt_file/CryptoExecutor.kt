@@ -0,0 +1,64 @@
+package com.example.aes_encrypt_file
+
+import android.os.Handler
+import android.os.Looper
+import android.os.Process
+import io.flutter.plugin.common.MethodChannel.Result
+import java.util.concurrent.LinkedBlockingQueue
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Process-wide worker threads for native calls, shared by every FlutterEngine
+ * the plugin is attached to (add-to-app). Work is queued instead of getting
+ * a thread per call, so bursts no longer create hundreds of threads.
+ *
+ * Two lanes: foreground work gets one thread per core at default priority;
+ * background work (prefetch, verification, bulk jobs) gets half as many
+ * threads at [Process.THREAD_PRIORITY_BACKGROUND], so it can never occupy
+ * the threads interactive calls need. Background threads are also marked
+ * natively, where they pause at each buffer while foreground operations run
+ * and draw from the bandwidth budget set with setBackgroundBudget.
+ */
+internal object CryptoExecutor {
+    enum class Lane { FOREGROUND, BACKGROUND }
+
+    private const val IDLE_SECONDS = 30L
+
+    private val cores = Runtime.getRuntime().availableProcessors().coerceAtLeast(2)
+    private val mainHandler = Handler(Looper.getMainLooper())
+
+    private val foreground = newPool("aes-fg", cores, false)
+    private val background = newPool("aes-bg", (cores / 2).coerceAtLeast(1), true)
+
+    private fun newPool(name: String, threads: Int, isBackground: Boolean): ThreadPoolExecutor {
+        val ids = AtomicInteger(1)
+        val priority = if (isBackground) Process.THREAD_PRIORITY_BACKGROUND else Process.THREAD_PRIORITY_DEFAULT
+        return ThreadPoolExecutor(threads, threads, IDLE_SECONDS, TimeUnit.SECONDS, LinkedBlockingQueue<Runnable>()) { runnable ->
+            Thread(null, {
+                Process.setThreadPriority(priority)
+                nativeSetThreadPriority(isBackground)
+                runnable.run()
+            }, "$name-${ids.getAndIncrement()}")
+        }.apply { allowCoreThreadTimeOut(true) }
+    }
+
+    fun execute(lane: Lane, block: () -> Unit) {
+        (if (lane == Lane.BACKGROUND) background else foreground).execute { block() }
+    }
+
+    /** Wraps [result] so every reply is delivered on the platform main thread. */
+    fun onMainThread(result: Result): Result = object : Result {
+        override fun success(value: Any?) = post { result.success(value) }
+        override fun error(code: String, message: String?, details: Any?) = post { result.error(code, message, details) }
+        override fun notImplemented() = post { result.notImplemented() }
+    }
+
+    private fun post(reply: () -> Unit) {
+        if (Looper.myLooper() == Looper.getMainLooper()) reply() else mainHandler.post { reply() }
+    }
+
+    // Native library is loaded by the plugin before any work is queued
+    private external fun nativeSetThreadPriority(background: Boolean)
+}
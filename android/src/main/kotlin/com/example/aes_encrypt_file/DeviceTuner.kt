@@ -0,0 +1,97 @@
+package com.example.aes_encrypt_file
+
+import android.content.Context
+import android.os.Build
+import java.io.File
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Per-filesystem tuning of buffer size, worker count and reader read-ahead.
+ *
+ * The first operation on a filesystem starts a short calibration run on the
+ * background lane (it runs with the defaults meanwhile). Natively the run
+ * waits for the engine to go idle and abandons itself when another operation
+ * starts, so a later operation retries it rather than keeping a profile
+ * measured under contention. The measured profile is applied natively and
+ * kept in SharedPreferences, keyed by the OS build and mount point, so later
+ * launches apply it without measuring again. An OS update re-measures, since
+ * I/O scheduling and drivers change.
+ */
+internal object DeviceTuner {
+    private const val PREFERENCES = "aes_encrypt_file_tuning"
+    const val PROFILE_FIELDS = 6
+    private const val CALIBRATE_BUSY = -13
+
+    @Volatile var autoCalibrate = true
+
+    // Directories already resolved, and mount points applied or being measured
+    private val checkedDirectories = ConcurrentHashMap.newKeySet<String>()
+    private val tunedMounts = ConcurrentHashMap.newKeySet<String>()
+
+    /** Applies the stored profile for [path]'s filesystem, or starts measuring it. */
+    fun ensureTuned(context: Context, path: String) {
+        if (!autoCalibrate) return
+        val file = File(path)
+        val directory = (if (file.isDirectory) file else file.absoluteFile.parentFile)?.path ?: return
+        if (!checkedDirectories.add(directory)) return
+        val mountPoint = nativeMountPoint(directory) ?: return
+        if (!tunedMounts.add(mountPoint)) return
+
+        val stored = preferences(context).getString(preferenceKey(mountPoint), null)?.let(::parse)
+        if (stored != null) {
+            nativeApply(directory, stored)
+        } else {
+            CryptoExecutor.execute(CryptoExecutor.Lane.BACKGROUND) {
+                if (measure(context, directory, LongArray(PROFILE_FIELDS)) == CALIBRATE_BUSY) {
+                    tunedMounts.remove(mountPoint)
+                    checkedDirectories.remove(directory)
+                }
+            }
+        }
+    }
+
+    /** Measures [directory]'s filesystem, applies and stores the result; null on failure. */
+    fun calibrate(context: Context, directory: String): LongArray? {
+        val fields = LongArray(PROFILE_FIELDS)
+        return if (measure(context, directory, fields) == 0) fields else null
+    }
+
+    // Nothing is applied or stored unless the native run succeeded
+    private fun measure(context: Context, directory: String, fields: LongArray): Int {
+        val result = nativeCalibrate(directory, fields)
+        if (result != 0) return result
+        nativeApply(directory, fields)
+        nativeMountPoint(directory)?.let { mountPoint ->
+            tunedMounts.add(mountPoint)
+            preferences(context).edit()
+                .putString(preferenceKey(mountPoint), fields.joinToString(","))
+                .apply()
+        }
+        return 0
+    }
+
+    fun setOptions(bufferSize: Int, threads: Int, readAhead: Int) = nativeSetOptions(bufferSize, threads, readAhead)
+
+    /** Settings in force for [directory] (or the default profile), after options. */
+    fun effective(directory: String?): LongArray {
+        val fields = LongArray(PROFILE_FIELDS)
+        nativeEffective(directory, fields)
+        return fields
+    }
+
+    private fun preferences(context: Context) =
+        context.getSharedPreferences(PREFERENCES, Context.MODE_PRIVATE)
+
+    private fun preferenceKey(mountPoint: String) = "${Build.FINGERPRINT}|$mountPoint"
+
+    private fun parse(value: String): LongArray? {
+        val fields = value.split(',').mapNotNull { it.toLongOrNull() }
+        return if (fields.size == PROFILE_FIELDS) fields.toLongArray() else null
+    }
+
+    private external fun nativeCalibrate(directory: String, fields: LongArray): Int
+    private external fun nativeApply(directory: String?, fields: LongArray): Int
+    private external fun nativeMountPoint(directory: String): String?
+    private external fun nativeSetOptions(bufferSize: Int, threads: Int, readAhead: Int)
+    private external fun nativeEffective(directory: String?, fields: LongArray)
+}
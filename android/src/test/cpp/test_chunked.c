@@ -0,0 +1,185 @@
+// Chunked containers: sync, decrypt, verify, concat and trim, including the
+// rollback and crash paths of the in-place operations. Failing writes are
+// produced with RLIMIT_FSIZE, which fails (or, with SIGXFSZ at its default
+// action, kills the process at) the first write reaching the limit.
+
+#include "crypto_chunked.h"
+#include "crypto_engine.h"
+#include "crypto_header.h"
+#include "crypto_verify.h"
+#include "test_support.h"
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define KEY "chunked test key"
+#define OTHER_KEY "another key"
+#define CHUNK (64 * 1024)
+#define FLAGS_OFFSET 40
+
+// Run operation in a child with writes limited to limit bytes; with
+// kill_on_limit the child dies at the first write past it, as in a crash.
+// Returns the operation's result, or 1000 + signal if the child was killed.
+static int run_limited(int (*operation)(void), int64_t limit, int kill_on_limit) {
+    pid_t child = fork();
+    if (child == 0) {
+        struct rlimit rl = { (rlim_t)limit, (rlim_t)limit };
+        signal(SIGXFSZ, kill_on_limit ? SIG_DFL : SIG_IGN);
+        if (setrlimit(RLIMIT_FSIZE, &rl) != 0) _exit(100);
+        _exit(operation() & 0xff);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (WIFSIGNALED(status)) return 1000 + WTERMSIG(status);
+    return (signed char)WEXITSTATUS(status);
+}
+
+static void test_round_trip(void) {
+    write_test_file("plain", 10 * CHUNK + 123, 1, 0);
+    CHECK_EQ(aes_chunked_sync_file("plain", "plain.enc", KEY, CHUNK), 11);
+    CHECK_EQ(aes_chunked_decrypt_file("plain.enc", "plain.dec", KEY), 0);
+    CHECK(files_equal("plain", "plain.dec"));
+
+    // Resync after a change rewrites only the changed chunk
+    patch_file("plain", 3 * CHUNK + 10, "changed", 7);
+    CHECK_EQ(aes_chunked_sync_file("plain", "plain.enc", KEY, CHUNK), 1);
+    CHECK_EQ(aes_chunked_decrypt_file("plain.enc", "plain.dec", KEY), 0);
+    CHECK(files_equal("plain", "plain.dec"));
+
+    aes_verify_report report;
+    CHECK_EQ(aes_verify_file("plain.enc", KEY, NULL, 0, &report), 0);
+    CHECK_EQ(report.passed, 1);
+    CHECK_EQ(report.bytes_verified, file_size("plain"));
+
+    // A flipped ciphertext byte is located to its chunk
+    copy_file("plain.enc", "bad.enc");
+    corrupt_byte("bad.enc", 64 + 5 * CHUNK + 7);
+    CHECK_EQ(aes_verify_file("bad.enc", KEY, NULL, 0, &report), 0);
+    CHECK_EQ(report.passed, 0);
+    CHECK_EQ(report.first_bad_offset, 5 * CHUNK);
+}
+
+static void test_errors(void) {
+    CHECK_EQ(aes_chunked_decrypt_file("plain.enc", "wrong.dec", OTHER_KEY), -10);
+
+    copy_file("plain.enc", "dirty.enc");
+    patch_file("dirty.enc", FLAGS_OFFSET, "\x01", 1);
+    CHECK_EQ(aes_chunked_decrypt_file("dirty.enc", "dirty.dec", KEY), -11);
+    aes_verify_report report;
+    CHECK_EQ(aes_verify_file("dirty.enc", KEY, NULL, 0, &report), -11);
+    // The key is checked first: a dirty file under the wrong key is -10
+    CHECK_EQ(aes_chunked_decrypt_file("dirty.enc", "dirty.dec", OTHER_KEY), -10);
+
+    copy_file("plain.enc", "short.enc");
+    truncate_file("short.enc", file_size("plain.enc") - 10);
+    CHECK_EQ(aes_chunked_decrypt_file("short.enc", "short.dec", KEY), -2);
+
+    CHECK_EQ(aes_encrypt_file_with_header("plain", "stream.enc", KEY, NULL), 0);
+    CHECK_EQ(aes_chunked_decrypt_file("stream.enc", "stream.dec", KEY), -12);
+}
+
+static void test_concat(void) {
+    write_test_file("part0", 3 * CHUNK + 1000, 2, 0);
+    write_test_file("part1", 2 * CHUNK, 3, 0);
+    write_test_file("part2", 500, 4, 0);
+    CHECK(aes_chunked_sync_file("part0", "part0.enc", KEY, CHUNK) > 0);
+    CHECK(aes_chunked_sync_file("part1", "part1.enc", KEY, CHUNK) > 0);
+    CHECK(aes_chunked_sync_file("part2", "part2.enc", KEY, CHUNK) > 0);
+    CHECK(aes_chunked_sync_file("part2", "foreign.enc", OTHER_KEY, CHUNK) > 0);
+    system("cat part0 part1 part2 > joined");
+
+    const char* inputs[] = { "part0.enc", "part1.enc", "part2.enc" };
+    CHECK_EQ(aes_chunked_concat_files(inputs, 3, "joined.enc", KEY), 0);
+    CHECK_EQ(aes_chunked_decrypt_file("joined.enc", "joined.dec", KEY), 0);
+    CHECK(files_equal("joined", "joined.dec"));
+
+    // A foreign key is rejected before anything is written
+    copy_file("part0.enc", "part0.before");
+    const char* foreign[] = { "part0.enc", "foreign.enc" };
+    CHECK_EQ(aes_chunked_concat_files(foreign, 2, "part0.enc", KEY), -10);
+    CHECK(files_equal("part0.enc", "part0.before"));
+    CHECK_EQ(aes_chunked_concat_files(foreign, 2, "foreign.out", KEY), -10);
+    CHECK(!file_exists("foreign.out"));
+
+    // In place through another name for the first input
+    copy_file("part0.enc", "inplace.enc");
+    const char* in_place[] = { "inplace.enc", "part1.enc", "part2.enc" };
+    CHECK_EQ(aes_chunked_concat_files(in_place, 3, "./inplace.enc", KEY), 0);
+    CHECK_EQ(aes_chunked_decrypt_file("inplace.enc", "inplace.dec", KEY), 0);
+    CHECK(files_equal("joined", "inplace.dec"));
+}
+
+static int concat_in_place(void) {
+    const char* inputs[] = { "rollback.enc", "part1.enc" };
+    return aes_chunked_concat_files(inputs, 2, "rollback.enc", KEY);
+}
+
+static int concat_to_new(void) {
+    const char* inputs[] = { "part0.enc", "part1.enc" };
+    return aes_chunked_concat_files(inputs, 2, "limited.enc", KEY);
+}
+
+static void test_concat_failures(void) {
+    // A failed in-place append puts the first file back exactly
+    copy_file("part0.enc", "rollback.enc");
+    int64_t size = file_size("rollback.enc");
+    int result = run_limited(concat_in_place, size, 0);
+    CHECK(result < 0 && result != -8);
+    CHECK(files_equal("rollback.enc", "part0.before"));
+    CHECK_EQ(aes_chunked_decrypt_file("rollback.enc", "rollback.dec", KEY), 0);
+    CHECK(files_equal("part0", "rollback.dec"));
+
+    // A failed concat into a new file leaves nothing behind
+    result = run_limited(concat_to_new, 2 * CHUNK, 0);
+    CHECK(result < 0);
+    CHECK(!file_exists("limited.enc"));
+
+    // Dying mid-append leaves a file that is refused as dirty, not misread
+    copy_file("part0.enc", "rollback.enc");
+    CHECK_EQ(run_limited(concat_in_place, size, 1), 1000 + SIGXFSZ);
+    CHECK_EQ(aes_chunked_decrypt_file("rollback.enc", "rollback.dec", KEY), -11);
+}
+
+static int trim_in_place(void) {
+    return aes_chunked_trim_file("crash.enc", NULL, KEY, 0, 2 * CHUNK);
+}
+
+static int trim_to_new(void) {
+    return aes_chunked_trim_file("plain.enc", "limited.enc", KEY, CHUNK, 4 * CHUNK);
+}
+
+static void test_trim(void) {
+    // Rounded outward to whole chunks
+    CHECK_EQ(aes_chunked_trim_file("plain.enc", "trim.enc", KEY, CHUNK + 10, 3 * CHUNK - 10), 0);
+    CHECK_EQ(aes_chunked_decrypt_file("trim.enc", "trim.dec", KEY), 0);
+    system("dd if=plain of=trim.expected bs=65536 skip=1 count=2 status=none");
+    CHECK(files_equal("trim.expected", "trim.dec"));
+
+    copy_file("plain.enc", "trim.inplace");
+    CHECK_EQ(aes_chunked_trim_file("trim.inplace", "trim.inplace", KEY, CHUNK + 10, 3 * CHUNK - 10), 0);
+    CHECK_EQ(aes_chunked_decrypt_file("trim.inplace", "trim.dec", KEY), 0);
+    CHECK(files_equal("trim.expected", "trim.dec"));
+
+    CHECK_EQ(aes_chunked_trim_file("plain.enc", "trim.bad", KEY, 3 * CHUNK, CHUNK), -1);
+    CHECK_EQ(aes_chunked_trim_file("plain.enc", "trim.bad", OTHER_KEY, 0, CHUNK), -10);
+    CHECK(!file_exists("trim.bad"));
+
+    int result = run_limited(trim_to_new, CHUNK, 0);
+    CHECK(result < 0);
+    CHECK(!file_exists("limited.enc"));
+
+    // Dying before the new index is written leaves the file dirty
+    copy_file("plain.enc", "crash.enc");
+    CHECK_EQ(run_limited(trim_in_place, 64 + 2 * CHUNK, 1), 1000 + SIGXFSZ);
+    CHECK_EQ(aes_chunked_decrypt_file("crash.enc", "crash.dec", KEY), -11);
+}
+
+int main(void) {
+    test_begin();
+    test_round_trip();
+    test_errors();
+    test_concat();
+    test_concat_failures();
+    test_trim();
+    return test_end("test_chunked");
+}
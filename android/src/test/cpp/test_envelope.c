@@ -0,0 +1,49 @@
+// Envelope format: wrapped data key, rewrap without touching the content
+
+#include "crypto_engine.h"
+#include "crypto_envelope.h"
+#include "crypto_header.h"
+#include "test_support.h"
+
+#define KEY "envelope test key"
+#define OTHER_KEY "another key"
+
+static void test_round_trip(void) {
+    write_test_file("plain", 2 * 1024 * 1024 + 77, 1, 0);
+    CHECK_EQ(aes_envelope_encrypt_file("plain", "plain.enc", KEY), 0);
+    aes_file_metadata info;
+    CHECK_EQ(aes_file_info("plain.enc", &info), 0);
+    CHECK_EQ(info.format, AES_FILE_FORMAT_ENVELOPE);
+    CHECK_EQ(aes_envelope_decrypt_file("plain.enc", "plain.dec", KEY), 0);
+    CHECK(files_equal("plain", "plain.dec"));
+    CHECK_EQ(aes_envelope_decrypt_file("plain.enc", "wrong.dec", OTHER_KEY), -10);
+}
+
+static void test_rewrap(void) {
+    int64_t size = file_size("plain.enc");
+    CHECK_EQ(aes_envelope_rewrap("plain.enc", OTHER_KEY, KEY), -10);
+    CHECK_EQ(aes_envelope_rewrap("plain.enc", KEY, OTHER_KEY), 0);
+    CHECK_EQ(file_size("plain.enc"), size);
+    CHECK_EQ(aes_envelope_decrypt_file("plain.enc", "plain.dec", KEY), -10);
+    CHECK_EQ(aes_envelope_decrypt_file("plain.enc", "plain.dec", OTHER_KEY), 0);
+    CHECK(files_equal("plain", "plain.dec"));
+}
+
+static void test_errors(void) {
+    CHECK_EQ(aes_encrypt_file("plain", "legacy.enc", KEY), 0);
+    CHECK_EQ(aes_envelope_decrypt_file("legacy.enc", "legacy.dec", KEY), -12);
+    CHECK_EQ(aes_envelope_rewrap("legacy.enc", KEY, OTHER_KEY), -12);
+
+    // A header cut off inside the wrapped key is damaged
+    copy_file("plain.enc", "short.enc");
+    truncate_file("short.enc", 40);
+    CHECK_EQ(aes_envelope_decrypt_file("short.enc", "short.dec", OTHER_KEY), -2);
+}
+
+int main(void) {
+    test_begin();
+    test_round_trip();
+    test_rewrap();
+    test_errors();
+    return test_end("test_envelope");
+}
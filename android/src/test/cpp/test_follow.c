@@ -0,0 +1,100 @@
+// Follow mode: encrypting a file while it is still being written
+
+#include "crypto_engine.h"
+#include "crypto_follow.h"
+#include "crypto_header.h"
+#include "test_support.h"
+
+#define KEY "follow test key"
+#define BLOCK (256 * 1024)
+
+static void write_blocks(int fd, int count, uint32_t seed) {
+    write_test_file("block", BLOCK, seed, 0);
+    unsigned char* data = (unsigned char*)malloc(BLOCK);
+    int block = open("block", O_RDONLY);
+    CHECK_EQ(read(block, data, BLOCK), BLOCK);
+    close(block);
+    for (int i = 0; i < count; i++) {
+        data[0] = (unsigned char)i;
+        CHECK_EQ(write(fd, data, BLOCK), BLOCK);
+        usleep(10000);
+    }
+    free(data);
+}
+
+static void read_head(const char* path, unsigned char* head) {
+    int fd = open(path, O_RDONLY);
+    CHECK_EQ(pread(fd, head, AES_FILE_HEADER_SIZE, 0), AES_FILE_HEADER_SIZE);
+    close(fd);
+}
+
+static void test_growth_and_head_patch(void) {
+    int writer = open("recording", O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    aes_follow* follow = aes_follow_start("recording", "recording.enc", KEY, AES_FOLLOW_HEADER);
+    CHECK(follow != NULL);
+    write_blocks(writer, 30, 1);
+    usleep(300000);
+    CHECK(aes_follow_progress(follow) > 0);
+
+    // A muxer patches its header after the fact; the head is only encrypted
+    // once, at finish
+    CHECK_EQ(pwrite(writer, "PATCHED!", 8, 100), 8);
+    CHECK_EQ(write(writer, "tail", 4), 4);
+    close(writer);
+    CHECK_EQ(aes_follow_finish(follow), 0);
+    CHECK_EQ(aes_decrypt_file("recording.enc", "recording.dec", KEY), 0);
+    CHECK(files_equal("recording", "recording.dec"));
+
+    aes_file_metadata info;
+    CHECK_EQ(aes_file_info("recording.enc", &info), 0);
+    CHECK_EQ(info.format, AES_FILE_FORMAT_HEADER);
+    CHECK_EQ(info.plaintext_size, file_size("recording"));
+}
+
+static void test_truncation_restarts(void) {
+    int writer = open("restart", O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    aes_follow* follow = aes_follow_start("restart", "restart.enc", KEY, AES_FOLLOW_HEADER);
+    CHECK(follow != NULL);
+    write_blocks(writer, 30, 2);
+    usleep(300000);
+    CHECK(aes_follow_progress(follow) > 0);
+    unsigned char before[AES_FILE_HEADER_SIZE];
+    read_head("restart.enc", before);
+
+    // The writer starts over: everything is re-encrypted under a new IV
+    // rather than reusing the keystream for different plaintext
+    CHECK_EQ(ftruncate(writer, 0), 0);
+    CHECK_EQ(lseek(writer, 0, SEEK_SET), 0);
+    usleep(200000);
+    write_blocks(writer, 25, 3);
+    usleep(300000);
+    unsigned char after[AES_FILE_HEADER_SIZE];
+    read_head("restart.enc", after);
+    CHECK(memcmp(before, after, sizeof(before)) != 0);
+
+    close(writer);
+    CHECK_EQ(aes_follow_finish(follow), 0);
+    CHECK_EQ(aes_decrypt_file("restart.enc", "restart.dec", KEY), 0);
+    CHECK(files_equal("restart", "restart.dec"));
+}
+
+static void test_finish_on_close(void) {
+    int writer = open("closed", O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    aes_follow* follow = aes_follow_start("closed", "closed.enc", KEY, AES_FOLLOW_FINISH_ON_CLOSE);
+    CHECK(follow != NULL);
+    write_blocks(writer, 10, 4);
+    close(writer);
+    usleep(300000);
+    CHECK_EQ(aes_follow_progress(follow), file_size("closed"));
+    CHECK_EQ(aes_follow_finish(follow), 0);
+    CHECK_EQ(aes_decrypt_file("closed.enc", "closed.dec", KEY), 0);
+    CHECK(files_equal("closed", "closed.dec"));
+}
+
+int main(void) {
+    test_begin();
+    test_growth_and_head_patch();
+    test_truncation_restarts();
+    test_finish_on_close();
+    return test_end("test_follow");
+}
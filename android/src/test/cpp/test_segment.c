@@ -0,0 +1,64 @@
+// Segmented output: parts, manifest and the digest checks on join
+
+#include "crypto_engine.h"
+#include "crypto_segment.h"
+#include "test_support.h"
+
+#define KEY "segment test key"
+#define SEGMENT (256 * 1024)
+
+static void test_round_trip(void) {
+    write_test_file("plain", 4 * SEGMENT + 999, 1, 0);
+    CHECK_EQ(aes_segment_encrypt_file("plain", "out", KEY, SEGMENT, 3), 5);
+    CHECK(file_exists("out.manifest"));
+    CHECK(file_exists("out.part00004"));
+    CHECK_EQ(aes_segment_join_file("out.manifest", "joined", KEY, 3), 0);
+    CHECK(files_equal("plain", "joined"));
+
+    // Any part decrypts on its own to its slice of the plaintext
+    CHECK_EQ(aes_decrypt_file("out.part00002", "part2.dec", KEY), 0);
+    system("dd if=plain of=part2.expected bs=262144 skip=2 count=1 status=none");
+    CHECK(files_equal("part2.expected", "part2.dec"));
+
+    // Names with spaces survive the manifest; newlines are refused
+    CHECK_EQ(aes_segment_encrypt_file("plain", "My Video.mp4", KEY, SEGMENT, 0), 5);
+    CHECK_EQ(aes_segment_join_file("My Video.mp4.manifest", "My Video.out", KEY, 0), 0);
+    CHECK(files_equal("plain", "My Video.out"));
+    CHECK_EQ(aes_segment_encrypt_file("plain", "bad\nname", KEY, SEGMENT, 0), -1);
+}
+
+static void test_tampering(void) {
+    // A flipped byte in one part fails its digest and removes the output
+    copy_file("out.part00001", "part1.saved");
+    corrupt_byte("out.part00001", 100);
+    CHECK_EQ(aes_segment_join_file("out.manifest", "tampered", KEY, 2), -2);
+    CHECK(!file_exists("tampered"));
+    copy_file("part1.saved", "out.part00001");
+
+    // So does a missing or resized part
+    CHECK_EQ(rename("out.part00003", "part3.saved"), 0);
+    CHECK_EQ(aes_segment_join_file("out.manifest", "missing", KEY, 2), -2);
+    CHECK(!file_exists("missing"));
+    CHECK_EQ(rename("part3.saved", "out.part00003"), 0);
+    copy_file("out.part00003", "part3.saved");
+    truncate_file("out.part00003", file_size("part3.saved") - 16);
+    CHECK_EQ(aes_segment_join_file("out.manifest", "resized", KEY, 2), -2);
+    copy_file("part3.saved", "out.part00003");
+
+    // An edited manifest no longer tiles the plaintext
+    CHECK_EQ(system("sed 's/^1 262144 /1 262160 /' out.manifest > edited.manifest"), 0);
+    CHECK_EQ(aes_segment_join_file("edited.manifest", "edited", KEY, 2), -2);
+    CHECK(!file_exists("edited"));
+    CHECK_EQ(system("sed 's|out.part00000$|../out.part00000|' out.manifest > escape.manifest"), 0);
+    CHECK_EQ(aes_segment_join_file("escape.manifest", "escape", KEY, 2), -2);
+
+    CHECK_EQ(aes_segment_join_file("out.manifest", "joined", KEY, 2), 0);
+    CHECK(files_equal("plain", "joined"));
+}
+
+int main(void) {
+    test_begin();
+    test_round_trip();
+    test_tampering();
+    return test_end("test_segment");
+}
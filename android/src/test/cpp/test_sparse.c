@@ -0,0 +1,87 @@
+// Sparse format: holes and zero runs, and validation of the hole map
+
+#include "crypto_engine.h"
+#include "crypto_header.h"
+#include "crypto_sparse.h"
+#include "crypto_verify.h"
+#include "test_support.h"
+
+#define KEY "sparse test key"
+#define DATA_OFFSET 4096
+#define HOLE_COUNT_OFFSET 40
+
+static void test_round_trip(void) {
+    // Zero runs in the data plus a real hole at the end
+    write_test_file("plain", 1024 * 1024, 1, 4);
+    truncate_file("plain", 3 * 1024 * 1024 + 100);
+    CHECK_EQ(aes_sparse_encrypt_file("plain", "plain.enc", KEY), 0);
+    CHECK_EQ(aes_sparse_decrypt_file("plain.enc", "plain.dec", KEY), 0);
+    CHECK(files_equal("plain", "plain.dec"));
+    // The stream decryptor leaves other formats to their own entry points
+    CHECK_EQ(aes_decrypt_file("plain.enc", "plain.dec2", KEY), -12);
+
+    aes_verify_report report;
+    CHECK_EQ(aes_verify_file("plain.enc", KEY, NULL, 0, &report), 0);
+    CHECK_EQ(report.passed, 1);
+
+    write_test_file("empty", 0, 0, 0);
+    CHECK_EQ(aes_sparse_encrypt_file("empty", "empty.enc", KEY), 0);
+    CHECK_EQ(aes_sparse_decrypt_file("empty.enc", "empty.dec", KEY), 0);
+    CHECK_EQ(file_size("empty.dec"), 0);
+}
+
+static uint64_t read_u64(const char* path, int64_t offset) {
+    uint64_t value = 0;
+    int fd = open(path, O_RDONLY);
+    if (pread(fd, &value, sizeof(value), offset) != (ssize_t)sizeof(value)) value = 0;
+    close(fd);
+    return value;
+}
+
+static void test_map_validation(void) {
+    uint64_t plaintext_size = read_u64("plain.enc", 16);
+    uint64_t hole_count = read_u64("plain.enc", HOLE_COUNT_OFFSET);
+    int64_t map_offset = DATA_OFFSET + (int64_t)plaintext_size;
+    CHECK_EQ(plaintext_size, file_size("plain"));
+    CHECK(hole_count >= 2);
+
+    // More holes than the map holds
+    copy_file("plain.enc", "count.enc");
+    uint64_t count = hole_count + 1;
+    patch_file("count.enc", HOLE_COUNT_OFFSET, &count, sizeof(count));
+    CHECK_EQ(aes_sparse_decrypt_file("count.enc", "bad.dec", KEY), -2);
+
+    // Holes out of order
+    copy_file("plain.enc", "order.enc");
+    unsigned char first[16], second[16];
+    int fd = open("plain.enc", O_RDONLY);
+    CHECK_EQ(pread(fd, first, sizeof(first), map_offset), 16);
+    CHECK_EQ(pread(fd, second, sizeof(second), map_offset + 16), 16);
+    close(fd);
+    patch_file("order.enc", map_offset, second, sizeof(second));
+    patch_file("order.enc", map_offset + 16, first, sizeof(first));
+    CHECK_EQ(aes_sparse_decrypt_file("order.enc", "bad.dec", KEY), -2);
+
+    // A hole past the end of the plaintext
+    copy_file("plain.enc", "range.enc");
+    uint64_t offset = plaintext_size;
+    patch_file("range.enc", map_offset + 16 * (int64_t)(hole_count - 1), &offset, sizeof(offset));
+    CHECK_EQ(aes_sparse_decrypt_file("range.enc", "bad.dec", KEY), -2);
+    aes_verify_report report;
+    CHECK_EQ(aes_verify_file("range.enc", KEY, NULL, 0, &report), -2);
+
+    // Cut off in the map
+    copy_file("plain.enc", "short.enc");
+    truncate_file("short.enc", file_size("plain.enc") - 8);
+    CHECK_EQ(aes_sparse_decrypt_file("short.enc", "bad.dec", KEY), -2);
+
+    CHECK_EQ(aes_encrypt_file_with_header("plain", "stream.enc", KEY, NULL), 0);
+    CHECK_EQ(aes_sparse_decrypt_file("stream.enc", "bad.dec", KEY), -12);
+}
+
+int main(void) {
+    test_begin();
+    test_round_trip();
+    test_map_validation();
+    return test_end("test_sparse");
+}
@@ -0,0 +1,117 @@
+// Single-stream formats: legacy (IV + CTR body) and AESFILE1, append and rekey
+
+#include "crypto_engine.h"
+#include "crypto_envelope.h"
+#include "crypto_header.h"
+#include "crypto_rekey.h"
+#include "test_support.h"
+
+#define KEY "stream test key"
+#define OTHER_KEY "another key"
+
+static void test_legacy_round_trip(void) {
+    write_test_file("plain", 3 * 1024 * 1024 + 17, 1, 0);
+    CHECK_EQ(aes_encrypt_file("plain", "legacy.enc", KEY), 0);
+    CHECK_EQ(file_size("legacy.enc"), file_size("plain") + 16);
+    CHECK_EQ(aes_decrypt_file("legacy.enc", "legacy.dec", KEY), 0);
+    CHECK(files_equal("plain", "legacy.dec"));
+
+    // Legacy files carry no key check: the wrong key decrypts to noise
+    CHECK_EQ(aes_decrypt_file("legacy.enc", "legacy.wrong", OTHER_KEY), 0);
+    CHECK(!files_equal("plain", "legacy.wrong"));
+
+    write_test_file("empty", 0, 0, 0);
+    CHECK_EQ(aes_encrypt_file("empty", "empty.enc", KEY), 0);
+    CHECK_EQ(aes_decrypt_file("empty.enc", "empty.dec", KEY), 0);
+    CHECK_EQ(file_size("empty.dec"), 0);
+}
+
+static void test_header_round_trip(void) {
+    write_test_file("plain", 1024 * 1024 + 5, 2, 0);
+    CHECK_EQ(aes_encrypt_file_with_header("plain", "header.enc", KEY, NULL), 0);
+    aes_file_metadata info;
+    CHECK_EQ(aes_file_info("header.enc", &info), 0);
+    CHECK_EQ(info.format, AES_FILE_FORMAT_HEADER);
+    CHECK_EQ(info.plaintext_size, file_size("plain"));
+    CHECK_EQ(aes_decrypt_file("header.enc", "header.dec", KEY), 0);
+    CHECK(files_equal("plain", "header.dec"));
+
+    // CTR has no tag: a cut-off body decrypts to a prefix, and only the
+    // recorded length tells that something is missing
+    copy_file("header.enc", "header.short");
+    truncate_file("header.short", file_size("header.enc") - 100);
+    CHECK_EQ(aes_decrypt_file("header.short", "header.short.dec", KEY), 0);
+    CHECK_EQ(file_size("header.short.dec"), file_size("plain") - 100);
+    CHECK_EQ(aes_file_info("header.short", &info), 0);
+    CHECK_EQ(info.plaintext_size, file_size("plain"));
+
+    // A cut-off header is damaged
+    truncate_file("header.short", AES_FILE_HEADER_SIZE - 8);
+    CHECK_EQ(aes_decrypt_file("header.short", "header.short.dec", KEY), -2);
+}
+
+static void test_append(void) {
+    write_test_file("first", 100000, 3, 0);
+    write_test_file("second", 250001, 4, 0);
+    CHECK_EQ(aes_encrypt_file_with_header("first", "append.enc", KEY, NULL), 0);
+    CHECK_EQ(aes_append_file("append.enc", "second", KEY, 1), 0);
+    CHECK_EQ(aes_decrypt_file("append.enc", "append.dec", KEY), 0);
+
+    copy_file("first", "both");
+    FILE* out = fopen("both", "ab");
+    FILE* in = fopen("second", "rb");
+    int c;
+    while ((c = fgetc(in)) != EOF) fputc(c, out);
+    fclose(in);
+    fclose(out);
+    CHECK(files_equal("both", "append.dec"));
+}
+
+static void test_rekey(void) {
+    write_test_file("plain", 5 * 1024 * 1024 + 3, 5, 0);
+    CHECK_EQ(aes_encrypt_file_with_header("plain", "rekey.enc", KEY, NULL), 0);
+
+    CHECK_EQ(aes_rekey_file("rekey.enc", "rekey.new", KEY, OTHER_KEY, 4), 0);
+    CHECK_EQ(aes_decrypt_file("rekey.new", "rekey.dec", OTHER_KEY), 0);
+    CHECK(files_equal("plain", "rekey.dec"));
+
+    // The same file under another name is rekeyed in place, not truncated
+    // into an empty output
+    CHECK_EQ(aes_rekey_file("rekey.new", "./rekey.new", OTHER_KEY, KEY, 4), 0);
+    CHECK_EQ(aes_decrypt_file("rekey.new", "rekey.dec", KEY), 0);
+    CHECK(files_equal("plain", "rekey.dec"));
+
+    CHECK_EQ(symlink("rekey.new", "rekey.link"), 0);
+    CHECK_EQ(aes_rekey_file("rekey.new", "rekey.link", KEY, OTHER_KEY, 2), 0);
+    CHECK_EQ(aes_decrypt_file("rekey.new", "rekey.dec", OTHER_KEY), 0);
+    CHECK(files_equal("plain", "rekey.dec"));
+
+    CHECK_EQ(aes_rekey_file("rekey.new", NULL, OTHER_KEY, KEY, 0), 0);
+    CHECK_EQ(aes_decrypt_file("rekey.new", "rekey.dec", KEY), 0);
+    CHECK(files_equal("plain", "rekey.dec"));
+}
+
+static void test_rekey_rejects_other_formats(void) {
+    write_test_file("plain", 200000, 6, 0);
+    CHECK_EQ(aes_envelope_encrypt_file("plain", "envelope.enc", KEY), 0);
+
+    // No output is created, and an existing one is left alone
+    CHECK_EQ(aes_rekey_file("envelope.enc", "rekey.none", KEY, OTHER_KEY, 1), -12);
+    CHECK(!file_exists("rekey.none"));
+    write_test_file("rekey.existing", 1000, 7, 0);
+    copy_file("rekey.existing", "rekey.existing.copy");
+    CHECK_EQ(aes_rekey_file("envelope.enc", "rekey.existing", KEY, OTHER_KEY, 1), -12);
+    CHECK(files_equal("rekey.existing", "rekey.existing.copy"));
+
+    CHECK_EQ(aes_decrypt_file("envelope.enc", "envelope.dec", KEY), -12);
+}
+
+int main(void) {
+    test_begin();
+    test_legacy_round_trip();
+    test_header_round_trip();
+    test_append();
+    test_rekey();
+    test_rekey_rejects_other_formats();
+    return test_end("test_stream");
+}
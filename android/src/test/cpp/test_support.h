@@ -0,0 +1,150 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+// Minimal harness for the host tests. Each test file is one executable that
+// runs in a fresh temporary directory, reports every failed check and exits
+// non-zero if there was one. The directory is removed when all checks pass.
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int test_failures;
+static char test_directory[] = "/tmp/aes_test_XXXXXX";
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                          \
+        }                                                                             \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                    \
+    do {                                                                              \
+        long long actual_ = (long long)(actual);                                      \
+        long long expected_ = (long long)(expected);                                  \
+        if (actual_ != expected_) {                                                   \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+                    #actual, actual_, expected_);                                     \
+            test_failures++;                                                          \
+        }                                                                             \
+    } while (0)
+
+static inline void test_begin(void) {
+    if (!mkdtemp(test_directory) || chdir(test_directory) != 0) {
+        perror("temporary directory");
+        exit(2);
+    }
+}
+
+static inline int remove_entry(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+static inline int test_end(const char* name) {
+    if (test_failures == 0) {
+        nftw(test_directory, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+        printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    printf("%s: %d checks failed (files kept in %s)\n", name, test_failures, test_directory);
+    return 1;
+}
+
+// Deterministic pseudo-random contents; zero_runs > 0 also writes that many
+// 64KB runs of zeros spread over the file
+static inline void write_test_file(const char* path, size_t size, uint32_t seed, int zero_runs) {
+    unsigned char* data = (unsigned char*)malloc(size ? size : 1);
+    uint32_t state = seed * 2654435761u + 1;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 1664525u + 1013904223u;
+        data[i] = (unsigned char)(state >> 24);
+    }
+    for (int run = 0; run < zero_runs && size > 0; run++) {
+        size_t start = size / (size_t)(zero_runs + 1) * (size_t)(run + 1);
+        size_t length = size - start < 65536 ? size - start : 65536;
+        memset(data + start, 0, length);
+    }
+    FILE* file = fopen(path, "wb");
+    if (!file || fwrite(data, 1, size, file) != size || fclose(file) != 0) {
+        perror(path);
+        exit(2);
+    }
+    free(data);
+}
+
+static inline int64_t file_size(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (int64_t)st.st_size : -1;
+}
+
+static inline int file_exists(const char* path) {
+    return access(path, F_OK) == 0;
+}
+
+static inline int files_equal(const char* a, const char* b) {
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    int equal = fa && fb;
+    while (equal) {
+        int ca = fgetc(fa);
+        int cb = fgetc(fb);
+        if (ca != cb) equal = 0;
+        if (ca == EOF || cb == EOF) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return equal;
+}
+
+static inline void copy_file(const char* from, const char* to) {
+    FILE* in = fopen(from, "rb");
+    FILE* out = fopen(to, "wb");
+    char buffer[65536];
+    size_t length;
+    while (in && out && (length = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        fwrite(buffer, 1, length, out);
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+}
+
+static inline void patch_file(const char* path, int64_t offset, const void* data, size_t length) {
+    int fd = open(path, O_WRONLY);
+    if (fd < 0 || pwrite(fd, data, length, offset) != (ssize_t)length) {
+        perror(path);
+        exit(2);
+    }
+    close(fd);
+}
+
+// Flip one byte, as a bad sector or a tampering upload would
+static inline void corrupt_byte(const char* path, int64_t offset) {
+    unsigned char byte = 0;
+    int fd = open(path, O_RDWR);
+    if (fd < 0 || pread(fd, &byte, 1, offset) != 1) {
+        perror(path);
+        exit(2);
+    }
+    byte ^= 0x5a;
+    if (pwrite(fd, &byte, 1, offset) != 1) exit(2);
+    close(fd);
+}
+
+static inline void truncate_file(const char* path, int64_t size) {
+    if (truncate(path, size) != 0) {
+        perror(path);
+        exit(2);
+    }
+}
+
+#endif // TEST_SUPPORT_H
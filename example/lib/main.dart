@@ -105,6 +105,7 @@ class _MyAppState extends State<MyApp> {
 
       memoryMonitor.updatePeak();
       stopwatch.stop();
+      await memoryMonitor.sampleNative(_aesEncryptFilePlugin);
       final memoryReport = memoryMonitor.getReport();
 
       if (success) {
@@ -168,6 +169,7 @@ class _MyAppState extends State<MyApp> {
 
       memoryMonitor.updatePeak();
       stopwatch.stop();
+      await memoryMonitor.sampleNative(_aesEncryptFilePlugin);
       final memoryReport = memoryMonitor.getReport();
 
       if (success) {
@@ -1,9 +1,12 @@
 import 'dart:io';
 
+import 'package:aes_encrypt_file/aes_encrypt_file.dart';
+
 /// Helper class to monitor RAM usage during encryption/decryption operations
 class MemoryMonitor {
   int? _startRss;
   int? _peakRss;
+  AesMemoryUsage? _native;
 
   /// Start monitoring memory
   void start() {
@@ -32,6 +35,16 @@ class MemoryMonitor {
     }
   }
 
+  /// Read the native engine's own memory figure (Android). RSS covers the
+  /// whole process; this counts only the plugin's buffers and OpenSSL state.
+  Future<void> sampleNative(AesEncryptFile plugin) async {
+    try {
+      _native = await plugin.getMemoryUsage();
+    } catch (e) {
+      // Not available on this platform
+    }
+  }
+
   /// Get memory usage report
   MemoryUsageReport getReport() {
     int? currentRss;
@@ -47,6 +60,7 @@ class MemoryMonitor {
       startRss: _startRss,
       peakRss: _peakRss,
       currentRss: currentRss,
+      native: _native,
     );
   }
 
@@ -72,11 +86,13 @@ class MemoryUsageReport {
   final int? startRss;
   final int? peakRss;
   final int? currentRss;
+  final AesMemoryUsage? native;
 
   MemoryUsageReport({
     this.startRss,
     this.peakRss,
     this.currentRss,
+    this.native,
   });
 
   /// Get RSS (Resident Set Size) increase
@@ -116,6 +132,12 @@ class MemoryUsageReport {
     } else {
       lines.add('RAM Usage: Không khả dụng trên nền tảng này');
     }
+
+    final native = this.native;
+    if (native != null) {
+      lines.add('Native engine: ${MemoryMonitor.formatBytes(native.total)}');
+      lines.add('  OpenSSL: ${MemoryMonitor.formatBytes(native.opensslInUse + native.opensslCached)}');
+    }
     
     return lines.join('\n');
   }
@@ -1,35 +1,636 @@
 
+import 'dart:io';
+import 'dart:typed_data';
+
 import 'aes_encrypt_file_platform_interface.dart';
+import 'decrypted_memory_file.dart';
+import 'encrypted_file_info.dart';
+import 'encrypted_file_verification.dart';
+import 'encrypted_random_access_file.dart';
+import 'encrypted_segment_manifest.dart';
+import 'engine_metrics.dart';
+import 'following_encryption.dart';
+import 'memory_usage.dart';
+import 'operation_stats.dart';
+import 'task_priority.dart';
+import 'tuning_profile.dart';
+
+export 'decrypted_memory_file.dart';
+export 'encrypted_file_info.dart';
+export 'encrypted_file_verification.dart';
+export 'encrypted_random_access_file.dart';
+export 'encrypted_segment_manifest.dart';
+export 'engine_metrics.dart';
+export 'following_encryption.dart';
+export 'memory_usage.dart';
+export 'operation_stats.dart';
+export 'task_priority.dart';
+export 'tuning_profile.dart';
 
 class AesEncryptFile {
 
+  /// Encrypts [inputPath] into [outputPath].
+  ///
+  /// Set [resumable] for very large files: progress is checkpointed to
+  /// `<outputPath>.ckpt`, and calling again with the same arguments after
+  /// the app was killed continues from the last checkpoint (Android).
+  ///
+  /// Set [header] to write a versioned header (format, algorithm, plaintext
+  /// length, IV) in front of the body so [getFileInfo] can describe the file
+  /// exactly. Such files are decrypted by [decryptFile] as usual (Android).
+  ///
+  /// On Android [inputPath] and [outputPath] may also be `content://` URIs
+  /// (Storage Access Framework, MediaStore); they are opened as file
+  /// descriptors and streamed directly, without a temporary copy.
+  /// [resumable] does not apply to URIs.
+  ///
+  /// [onStats] receives a breakdown of the run (bytes, read / crypto / write
+  /// time, CPU time, threads, AES backend) before the future completes, to
+  /// tell whether a slow job is I/O-bound or CPU-bound (Android).
+  ///
+  /// [priority] overrides the lane set with [setTaskPriority] for this call.
    Future<bool> encryptFile({
     required String inputPath,
     required String outputPath,
     required String key,
     String? iv,
+    bool resumable = false,
+    bool header = false,
+    void Function(AesOperationStats)? onStats,
+    AesTaskPriority? priority,
   }) {
     return AesEncryptFilePlatform.instance.encryptFile(
       inputPath: inputPath,
       outputPath: outputPath,
       key: key,
       iv: iv,
+      resumable: resumable,
+      header: header,
+      onStats: onStats,
+      priority: priority,
     );
   }
 
+  /// Decrypts [inputPath] into [outputPath].
+  ///
+  /// Like [encryptFile], either side may be a `content://` URI on Android,
+  /// and [onStats] and [priority] work the same way.
   Future<bool> decryptFile({
     required String inputPath,
     required String outputPath,
     required String key,
     String? iv,
+    void Function(AesOperationStats)? onStats,
+    AesTaskPriority? priority,
   }) {
     return AesEncryptFilePlatform.instance.decryptFile(
       inputPath: inputPath,
       outputPath: outputPath,
       key: key,
       iv: iv,
+      onStats: onStats,
+      priority: priority,
+    );
+  }
+
+  /// Encrypts each of [inputPaths] into the matching entry of
+  /// [outputPaths] as one pipelined batch (Android).
+  ///
+  /// While one file is being encrypted, the next ones are already opened
+  /// and read ahead, and finished outputs are closed (and, with [sync],
+  /// flushed to storage) on a separate thread. For imports of many small or
+  /// medium files this hides most of the per-file open / close latency that
+  /// calling [encryptFile] in a loop pays. Plain paths only; the output
+  /// format is that of [encryptFile].
+  ///
+  /// Returns one success flag per file. A failed file's output is removed
+  /// and the rest of the batch carries on.
+  Future<List<bool>> encryptFiles({
+    required List<String> inputPaths,
+    required List<String> outputPaths,
+    required String key,
+    bool sync = false,
+    AesTaskPriority? priority,
+  }) {
+    return AesEncryptFilePlatform.instance.encryptFiles(
+      inputPaths: inputPaths,
+      outputPaths: outputPaths,
+      key: key,
+      sync: sync,
+      priority: priority,
+    );
+  }
+
+  /// Decrypts each of [inputPaths] into the matching entry of
+  /// [outputPaths]; the batch counterpart of [decryptFile], pipelined like
+  /// [encryptFiles] (Android).
+  Future<List<bool>> decryptFiles({
+    required List<String> inputPaths,
+    required List<String> outputPaths,
+    required String key,
+    bool sync = false,
+    AesTaskPriority? priority,
+  }) {
+    return AesEncryptFilePlatform.instance.decryptFiles(
+      inputPaths: inputPaths,
+      outputPaths: outputPaths,
+      key: key,
+      sync: sync,
+      priority: priority,
+    );
+  }
+
+  /// Appends the contents of [inputPath] to the encrypted file at
+  /// [encryptedPath] without touching the existing ciphertext.
+  ///
+  /// The new data continues the file's CTR keystream, so the cost is
+  /// proportional to the appended bytes only. Set [sync] to flush the
+  /// appended data to storage before the call completes (Android).
+  Future<bool> appendFile({
+    required String encryptedPath,
+    required String inputPath,
+    required String key,
+    bool sync = false,
+  }) {
+    return AesEncryptFilePlatform.instance.appendFile(
+      encryptedPath: encryptedPath,
+      inputPath: inputPath,
+      key: key,
+      sync: sync,
+    );
+  }
+
+  /// Describes encrypted files from their headers only (Android).
+  ///
+  /// Uses `stat` and one small read per file, so listing screens can show
+  /// formats and plaintext sizes of thousands of files without reading
+  /// their bodies. Entries are null for files that cannot be read.
+  Future<List<EncryptedFileInfo?>> getFilesInfo(List<String> paths) async {
+    final infos = await AesEncryptFilePlatform.instance.getFileInfo(paths: paths);
+    return [
+      for (var i = 0; i < paths.length; i++)
+        infos[i] == null ? null : EncryptedFileInfo.fromMap(paths[i], infos[i]!),
+    ];
+  }
+
+  /// Describes a single encrypted file; see [getFilesInfo].
+  Future<EncryptedFileInfo?> getFileInfo(String path) async {
+    return (await getFilesInfo([path])).first;
+  }
+
+  /// Checks that [path] decrypts correctly without writing any output.
+  ///
+  /// The plaintext is decrypted into a scratch buffer, hashed and discarded.
+  /// Chunked files are checked against their per-chunk fingerprints, which
+  /// also locates the first corrupt chunk; for other formats pass the
+  /// [EncryptedFileVerification.sha256] recorded earlier as [expectedSha256].
+  /// With [lowPriority] the work runs at idle CPU and I/O priority and does
+  /// not keep the verified data in the page cache (Android).
+  Future<EncryptedFileVerification> verifyFile({
+    required String path,
+    required String key,
+    Uint8List? expectedSha256,
+    bool lowPriority = false,
+  }) async {
+    final report = await AesEncryptFilePlatform.instance.verifyFile(
+      path: path,
+      key: key,
+      expectedSha256: expectedSha256,
+      lowPriority: lowPriority,
+    );
+    return EncryptedFileVerification.fromMap(report);
+  }
+
+  /// Re-encrypts an encrypted file from [oldKey] to [newKey] with a fresh IV.
+  ///
+  /// Runs as a single streaming pass, split across CPU cores, without ever
+  /// writing plaintext to storage. Without [outputPath] the file is rewritten
+  /// in place; an interrupted in-place rekey leaves the file unreadable, so
+  /// prefer a separate [outputPath] plus rename when that matters (Android).
+  /// [onStats] works as for [encryptFile]; its times are summed over the
+  /// worker threads.
+  Future<bool> rekeyFile({
+    required String inputPath,
+    String? outputPath,
+    required String oldKey,
+    required String newKey,
+    void Function(AesOperationStats)? onStats,
+  }) {
+    return AesEncryptFilePlatform.instance.rekeyFile(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      oldKey: oldKey,
+      newKey: newKey,
+      onStats: onStats,
+    );
+  }
+
+  /// Encrypts [inputPath] into the envelope format at [outputPath].
+  ///
+  /// The content is encrypted under a random per-file data key and only that
+  /// data key is encrypted with [key] (AES key wrap) in the file header, so
+  /// the key can later be changed with [rewrapFileKeys] without touching the
+  /// content (Android).
+  Future<bool> envelopeEncryptFile({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.envelopeEncryptFile(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+    );
+  }
+
+  /// Decrypts a file written by [envelopeEncryptFile].
+  Future<bool> envelopeDecryptFile({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.envelopeDecryptFile(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+    );
+  }
+
+  /// Encrypts a sparse file (disk image, preallocated database) at
+  /// [outputPath] without reading or encrypting its holes.
+  ///
+  /// Holes and all-zero 4KB blocks are recorded in a map instead of being
+  /// encrypted, and stay holes in the output, so both the work and the disk
+  /// usage follow the amount of real data (Android).
+  Future<bool> sparseEncryptFile({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.sparseEncryptFile(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+    );
+  }
+
+  /// Decrypts a file written by [sparseEncryptFile], recreating its holes.
+  Future<bool> sparseDecryptFile({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.sparseDecryptFile(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+    );
+  }
+
+  /// Changes the key of envelope files from [oldKey] to [newKey] in place.
+  ///
+  /// Only the wrapped data key in each header is rewritten, so the cost is
+  /// one small write per file regardless of file size. Returns the paths
+  /// that failed (wrong [oldKey], not an envelope file, I/O error).
+  Future<List<String>> rewrapFileKeys({
+    required List<String> paths,
+    required String oldKey,
+    required String newKey,
+  }) {
+    return AesEncryptFilePlatform.instance.rewrapFileKeys(
+      paths: paths,
+      oldKey: oldKey,
+      newKey: newKey,
+    );
+  }
+
+  /// Encrypts [inputPath] into the chunked format at [outputPath].
+  ///
+  /// Each [chunkSize] (default 1MB) chunk gets its own random nonce and a
+  /// keyed fingerprint. When [outputPath] already holds a chunked file for
+  /// the same key, only chunks whose plaintext changed are re-encrypted and
+  /// rewritten. Returns the number of chunks written, or -1 on failure.
+  Future<int> encryptFileIncremental({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+    int? chunkSize,
+  }) {
+    return AesEncryptFilePlatform.instance.encryptFileIncremental(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+      chunkSize: chunkSize,
+    );
+  }
+
+  /// Decrypts a file written by [encryptFileIncremental].
+  Future<bool> decryptChunkedFile({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.decryptChunkedFile(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+    );
+  }
+
+  /// Joins chunked files (see [encryptFileIncremental]) into [outputPath].
+  ///
+  /// Nothing is decrypted: the ciphertext is copied with `copy_file_range`
+  /// and only the chunk index is rebuilt. All inputs must use the same key
+  /// and chunk size. When [outputPath] is the first input, the others are
+  /// appended to it in place (Android).
+  Future<bool> concatChunkedFiles({
+    required List<String> inputPaths,
+    required String outputPath,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.concatChunkedFiles(
+      inputPaths: inputPaths,
+      outputPath: outputPath,
+      key: key,
+    );
+  }
+
+  /// Keeps only the chunks of a chunked file that overlap [start, end).
+  ///
+  /// The range is widened to whole chunks and nothing is decrypted. Without
+  /// [outputPath] the file is trimmed in place by rewriting its index; an
+  /// interrupted in-place trim leaves a file that no longer opens, so pass
+  /// [outputPath] when that matters (Android).
+  Future<bool> trimChunkedFile({
+    required String inputPath,
+    String? outputPath,
+    required String key,
+    int start = 0,
+    int? end,
+  }) {
+    return AesEncryptFilePlatform.instance.trimChunkedFile(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+      start: start,
+      end: end,
+    );
+  }
+
+  /// Encrypts [inputPath] directly into upload-sized part files.
+  ///
+  /// Writes `<outputPrefix>.part00000`, `.part00001`, ... of [segmentSize]
+  /// plaintext bytes each (default 64MB), encrypted in parallel, followed by
+  /// `<outputPrefix>.manifest` with per-part SHA-256 digests. Each part is
+  /// renamed into place once complete, so uploads can start before the last
+  /// one is written. Throws a [FileSystemException] on failure (Android).
+  Future<EncryptedSegmentManifest> encryptFileSegments({
+    required String inputPath,
+    required String outputPrefix,
+    required String key,
+    int? segmentSize,
+  }) async {
+    final count = await AesEncryptFilePlatform.instance.encryptFileSegments(
+      inputPath: inputPath,
+      outputPrefix: outputPrefix,
+      key: key,
+      segmentSize: segmentSize,
+    );
+    if (count < 0) {
+      throw FileSystemException('Cannot encrypt into segments', inputPath);
+    }
+    return EncryptedSegmentManifest.read('$outputPrefix.manifest');
+  }
+
+  /// Decrypts the parts listed in [manifestPath] back into one file.
+  ///
+  /// Parts are checked against the manifest digests; on a missing or altered
+  /// part nothing is left at [outputPath] and false is returned.
+  Future<bool> joinFileSegments({
+    required String manifestPath,
+    required String outputPath,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.joinFileSegments(
+      manifestPath: manifestPath,
+      outputPath: outputPath,
+      key: key,
+    );
+  }
+
+  /// Opens an encrypted file for random access reads of its plaintext.
+  Future<EncryptedRandomAccessFile> openRead({
+    required String path,
+    required String key,
+  }) {
+    return EncryptedRandomAccessFile.open(path: path, key: key);
+  }
+
+  /// Decrypts [path] and returns the plaintext, e.g. for `Image.memory`.
+  ///
+  /// The native side sizes the result from the file header and decrypts
+  /// straight into it, so no temp file is written and read back. Throws a
+  /// `PlatformException` if the file cannot be decrypted (Android).
+  Future<Uint8List> decryptFileToBytes({
+    required String path,
+    required String key,
+  }) {
+    return AesEncryptFilePlatform.instance.decryptFileToBytes(path: path, key: key);
+  }
+
+  /// Encrypts [bytes] into a new file at [path] without a plaintext temp
+  /// file. Set [header] for the self-describing layout (Android).
+  Future<bool> encryptBytesToFile({
+    required Uint8List bytes,
+    required String path,
+    required String key,
+    bool header = false,
+  }) {
+    return AesEncryptFilePlatform.instance.encryptBytesToFile(
+      bytes: bytes,
+      path: path,
+      key: key,
+      header: header,
     );
   }
 
+  /// Decrypts [path] into an anonymous memory file and returns it.
+  ///
+  /// The result exposes a `/proc/self/fd/N` path for libraries that need a
+  /// path or fd, so no plaintext temp file has to be written and deleted.
+  /// The memory file is sealed read-only; close it when done (Android).
+  Future<DecryptedMemoryFile> decryptToMemoryFile({
+    required String path,
+    required String key,
+  }) {
+    return DecryptedMemoryFile.decrypt(path: path, key: key);
+  }
+
+  /// Starts encrypting [inputPath] while a recorder is still writing it.
+  ///
+  /// Chunks are encrypted as they are completed, so stopping a long
+  /// recording only leaves the tail to process. Call
+  /// [FollowingEncryption.finish] when the recording stops, or set
+  /// [finishOnClose] to finish as soon as the writer closes the file. The
+  /// output matches [encryptFile] with the same [header] setting (Android).
+  Future<FollowingEncryption> startFollowEncryption({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+    bool header = false,
+    bool finishOnClose = false,
+  }) {
+    return FollowingEncryption.start(
+      inputPath: inputPath,
+      outputPath: outputPath,
+      key: key,
+      header: header,
+      finishOnClose: finishOnClose,
+    );
+  }
+
+  /// Serves the plaintext of an encrypted file to media players.
+  ///
+  /// Returns a `http://127.0.0.1:<port>/<token>/<name>` URL backed by a
+  /// loopback server that decrypts only the byte ranges the player requests,
+  /// so playback starts without writing a decrypted copy to disk.
+  Future<Uri> registerStream({
+    required String path,
+    required String key,
+    String? mimeType,
+  }) async {
+    final url = await AesEncryptFilePlatform.instance.registerStream(
+      path: path,
+      key: key,
+      mimeType: mimeType,
+    );
+    return Uri.parse(url);
+  }
+
+  /// Stops serving a URL returned by [registerStream].
+  Future<void> unregisterStream(Uri uri) {
+    return AesEncryptFilePlatform.instance.unregisterStream(token: uri.pathSegments.first);
+  }
+
+  /// Stops the loopback stream server and invalidates every stream URL.
+  Future<void> stopStreamServer() {
+    return AesEncryptFilePlatform.instance.stopStreamServer();
+  }
+
+  /// Returns operation counts, bytes, errors by code and p50 / p99 / p99.9
+  /// latency per operation type, aggregated over the whole process since
+  /// start or the last [resetMetrics] (Android).
+  ///
+  /// Log it periodically or per release to catch tail-latency regressions.
+  Future<AesEngineMetrics> getMetrics() async {
+    final metrics = await AesEncryptFilePlatform.instance.getMetrics();
+    return AesEngineMetrics.fromMap(metrics);
+  }
+
+  /// Returns the same metrics as [getMetrics] in the Prometheus text
+  /// exposition format, ready to be served or uploaded (Android).
+  Future<String> getMetricsText() {
+    return AesEncryptFilePlatform.instance.getMetricsText();
+  }
+
+  /// Zeroes the counters reported by [getMetrics] (Android).
+  Future<void> resetMetrics() {
+    return AesEncryptFilePlatform.instance.resetMetrics();
+  }
+
+  /// Mutes or unmutes the native trace spans (Android).
+  ///
+  /// Spans exist only when the plugin is built with `AES_ENABLE_TRACE`; they
+  /// are on by default there and appear in Perfetto captures that record the
+  /// app. Without that flag this call has no effect.
+  Future<void> setTraceEnabled(bool enabled) {
+    return AesEncryptFilePlatform.instance.setTraceEnabled(enabled);
+  }
+
+  /// Sets the lane for native calls from this Flutter engine that don't
+  /// pass their own priority (Android).
+  ///
+  /// All calls share one process-wide pool: [AesTaskPriority.foreground]
+  /// has a thread per core, [AesTaskPriority.background] half as many at
+  /// background thread priority. Excess calls queue instead of spawning
+  /// threads.
+  Future<void> setTaskPriority(AesTaskPriority priority) {
+    return AesEncryptFilePlatform.instance.setTaskPriority(priority);
+  }
+
+  /// Limits what [AesTaskPriority.background] work may use (Android).
+  ///
+  /// Background reads and writes share a token bucket of [bytesPerSecond],
+  /// and each background operation uses at most [maxThreads] threads.
+  /// Background work also pauses at every buffer while a foreground call is
+  /// running, so interactive decrypts stay fast during a large backup. Pass
+  /// null to lift a limit.
+  Future<void> setBackgroundBudget({int? bytesPerSecond, int? maxThreads}) {
+    return AesEncryptFilePlatform.instance.setBackgroundBudget(
+      bytesPerSecond: bytesPerSecond,
+      maxThreads: maxThreads,
+    );
+  }
+
+  /// Sets the budget shared by the native engine's buffers, reader caches,
+  /// stream servers and parallel workers, in bytes (Android).
+  ///
+  /// When it is used up, new operations wait for running ones to release
+  /// memory and parallel jobs start fewer threads, instead of the process
+  /// growing until the low-memory killer steps in. Null restores the
+  /// default of 1/32 of device RAM, between 16 MB and 256 MB.
+  Future<void> setMemoryBudget(int? bytes) {
+    return AesEncryptFilePlatform.instance.setMemoryBudget(bytes);
+  }
+
+  /// Gives native memory back: pooled buffers and cached reader chunks are
+  /// freed (Android).
+  ///
+  /// The plugin already does this from `onTrimMemory`; call it yourself
+  /// before a memory-hungry step of your own. With [complete] the budget is
+  /// also halved for 30 seconds.
+  Future<void> trimMemory({bool complete = false}) {
+    return AesEncryptFilePlatform.instance.trimMemory(complete: complete);
+  }
+
+  /// Returns how much of the native memory budget is in use (Android).
+  Future<AesMemoryUsage> getMemoryUsage() async {
+    final usage = await AesEncryptFilePlatform.instance.getMemoryUsage();
+    return AesMemoryUsage.fromMap(usage);
+  }
+
+  /// Measures the storage holding [directory] and tunes the engine for it
+  /// (Android).
+  ///
+  /// Runs about 16 MB through a temporary file for each candidate buffer
+  /// size, worker count and read-ahead depth, which takes a few seconds.
+  /// The plugin already does this once per filesystem, in the background,
+  /// the first time an operation touches it, and remembers the result until
+  /// the next OS update; call it to re-measure, e.g. after the device was
+  /// restored to another phone.
+  Future<AesTuningProfile> calibrate(String directory) async {
+    final profile = await AesEncryptFilePlatform.instance.calibrate(directory);
+    return AesTuningProfile.fromMap(profile);
+  }
+
+  /// Overrides the tuned settings for every filesystem (Android).
+  ///
+  /// Null or 0 keeps the measured value. With [autoCalibrate] false, new
+  /// filesystems are no longer measured automatically.
+  Future<void> setTuningOptions({int? bufferSize, int? threads, int? readAhead, bool autoCalibrate = true}) {
+    return AesEncryptFilePlatform.instance.setTuningOptions(
+      bufferSize: bufferSize,
+      threads: threads,
+      readAhead: readAhead,
+      autoCalibrate: autoCalibrate,
+    );
+  }
+
+  /// Returns the settings operations on [directory]'s filesystem use, or
+  /// the defaults when [directory] is null (Android).
+  Future<AesTuningProfile> getTuningProfile({String? directory}) async {
+    final profile = await AesEncryptFilePlatform.instance.getTuningProfile(directory);
+    return AesTuningProfile.fromMap(profile);
+  }
 
 }
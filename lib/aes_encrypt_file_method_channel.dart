@@ -2,6 +2,8 @@ import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
 import 'aes_encrypt_file_platform_interface.dart';
+import 'operation_stats.dart';
+import 'task_priority.dart';
 
 /// An implementation of [AesEncryptFilePlatform] that uses method channels.
 class MethodChannelAesEncryptFile extends AesEncryptFilePlatform {
@@ -11,7 +13,7 @@ class MethodChannelAesEncryptFile extends AesEncryptFilePlatform {
 
 
   @override
-  Future<bool> decryptFile({required String inputPath, required String outputPath, required String key, String? iv}) async{
+  Future<bool> decryptFile({required String inputPath, required String outputPath, required String key, String? iv, void Function(AesOperationStats)? onStats, AesTaskPriority? priority}) async{
     try {
       final Map<String, dynamic> args = {
         'inputPath': inputPath,
@@ -21,15 +23,17 @@ class MethodChannelAesEncryptFile extends AesEncryptFilePlatform {
       if (iv != null) {
         args['iv'] = iv;
       }
-      final bool result = await methodChannel.invokeMethod('decryptFile', args);
-      return result;
+      if (priority != null) {
+        args['priority'] = priority.name;
+      }
+      return _invokeWithStats('decryptFile', args, onStats);
     } on PlatformException {
       return false;
     }
   }
 
   @override
-  Future<bool> encryptFile({required String inputPath, required String outputPath, required String key, String? iv}) async{
+  Future<bool> encryptFile({required String inputPath, required String outputPath, required String key, String? iv, bool resumable = false, bool header = false, void Function(AesOperationStats)? onStats, AesTaskPriority? priority}) async{
     try {
       final Map<String, dynamic> args = {
         'inputPath': inputPath,
@@ -39,11 +43,478 @@ class MethodChannelAesEncryptFile extends AesEncryptFilePlatform {
       if (iv != null) {
         args['iv'] = iv;
       }
-      final bool result = await methodChannel.invokeMethod('encryptFile', args);
+      if (priority != null) {
+        args['priority'] = priority.name;
+      }
+      if (resumable) {
+        args['resumable'] = true;
+      }
+      if (header) {
+        args['header'] = true;
+      }
+      return _invokeWithStats('encryptFile', args, onStats);
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  /// Asks for operation stats when [onStats] is set; the native side then
+  /// replies with a map instead of a bool.
+  Future<bool> _invokeWithStats(String method, Map<String, dynamic> args, void Function(AesOperationStats)? onStats) async {
+    if (onStats == null) {
+      final bool result = await methodChannel.invokeMethod(method, args);
+      return result;
+    }
+    args['stats'] = true;
+    final Map<dynamic, dynamic> result = await methodChannel.invokeMethod(method, args);
+    onStats(AesOperationStats.fromMap(result['stats'] as Map<dynamic, dynamic>));
+    return result['success'] as bool;
+  }
+
+  @override
+  Future<List<bool>> encryptFiles({required List<String> inputPaths, required List<String> outputPaths, required String key, bool sync = false, AesTaskPriority? priority}) {
+    return _invokeBatch('encryptFiles', inputPaths, outputPaths, key, sync, priority);
+  }
+
+  @override
+  Future<List<bool>> decryptFiles({required List<String> inputPaths, required List<String> outputPaths, required String key, bool sync = false, AesTaskPriority? priority}) {
+    return _invokeBatch('decryptFiles', inputPaths, outputPaths, key, sync, priority);
+  }
+
+  Future<List<bool>> _invokeBatch(String method, List<String> inputPaths, List<String> outputPaths, String key, bool sync, AesTaskPriority? priority) async {
+    try {
+      final Map<String, dynamic> args = {
+        'inputPaths': inputPaths,
+        'outputPaths': outputPaths,
+        'key': key,
+        'sync': sync,
+      };
+      if (priority != null) {
+        args['priority'] = priority.name;
+      }
+      final List<dynamic> results = await methodChannel.invokeMethod(method, args);
+      return results.cast<bool>();
+    } on PlatformException {
+      return List<bool>.filled(inputPaths.length, false);
+    }
+  }
+
+  @override
+  Future<bool> appendFile({required String encryptedPath, required String inputPath, required String key, bool sync = false}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('appendFile', {
+        'encryptedPath': encryptedPath,
+        'inputPath': inputPath,
+        'key': key,
+        'sync': sync,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<List<Map<dynamic, dynamic>?>> getFileInfo({required List<String> paths}) async {
+    final List<dynamic> infos = await methodChannel.invokeMethod('getFileInfo', {'paths': paths});
+    return infos.cast<Map<dynamic, dynamic>?>();
+  }
+
+  @override
+  Future<Map<dynamic, dynamic>> verifyFile({required String path, required String key, Uint8List? expectedSha256, bool lowPriority = false}) async {
+    final Map<String, dynamic> args = {
+      'path': path,
+      'key': key,
+      'lowPriority': lowPriority,
+    };
+    if (expectedSha256 != null) {
+      args['expectedSha256'] = expectedSha256;
+    }
+    final Map<dynamic, dynamic> report = await methodChannel.invokeMethod('verifyFile', args);
+    return report;
+  }
+
+  @override
+  Future<bool> rekeyFile({required String inputPath, String? outputPath, required String oldKey, required String newKey, void Function(AesOperationStats)? onStats}) async {
+    try {
+      final Map<String, dynamic> args = {
+        'inputPath': inputPath,
+        'oldKey': oldKey,
+        'newKey': newKey,
+      };
+      if (outputPath != null) {
+        args['outputPath'] = outputPath;
+      }
+      return _invokeWithStats('rekeyFile', args, onStats);
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> envelopeEncryptFile({required String inputPath, required String outputPath, required String key}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('envelopeEncryptFile', {
+        'inputPath': inputPath,
+        'outputPath': outputPath,
+        'key': key,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> envelopeDecryptFile({required String inputPath, required String outputPath, required String key}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('envelopeDecryptFile', {
+        'inputPath': inputPath,
+        'outputPath': outputPath,
+        'key': key,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> sparseEncryptFile({required String inputPath, required String outputPath, required String key}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('sparseEncryptFile', {
+        'inputPath': inputPath,
+        'outputPath': outputPath,
+        'key': key,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> sparseDecryptFile({required String inputPath, required String outputPath, required String key}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('sparseDecryptFile', {
+        'inputPath': inputPath,
+        'outputPath': outputPath,
+        'key': key,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<List<String>> rewrapFileKeys({required List<String> paths, required String oldKey, required String newKey, void Function(AesOperationStats)? onStats}) async {
+    try {
+      final List<dynamic> failed = await methodChannel.invokeMethod('rewrapFileKeys', {
+        'paths': paths,
+        'oldKey': oldKey,
+        'newKey': newKey,
+      });
+      return failed.cast<String>();
+    } on PlatformException {
+      return List<String>.of(paths);
+    }
+  }
+
+  @override
+  Future<int> encryptFileIncremental({required String inputPath, required String outputPath, required String key, int? chunkSize}) async {
+    try {
+      final Map<String, dynamic> args = {
+        'inputPath': inputPath,
+        'outputPath': outputPath,
+        'key': key,
+      };
+      if (chunkSize != null) {
+        args['chunkSize'] = chunkSize;
+      }
+      final int written = await methodChannel.invokeMethod('encryptFileIncremental', args);
+      return written < 0 ? -1 : written;
+    } on PlatformException {
+      return -1;
+    }
+  }
+
+  @override
+  Future<bool> decryptChunkedFile({required String inputPath, required String outputPath, required String key}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('decryptChunkedFile', {
+        'inputPath': inputPath,
+        'outputPath': outputPath,
+        'key': key,
+      });
       return result;
     } on PlatformException {
       return false;
     }
   }
 
+  @override
+  Future<bool> concatChunkedFiles({required List<String> inputPaths, required String outputPath, required String key}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('concatChunkedFiles', {
+        'inputPaths': inputPaths,
+        'outputPath': outputPath,
+        'key': key,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> trimChunkedFile({required String inputPath, String? outputPath, required String key, int start = 0, int? end}) async {
+    try {
+      final Map<String, dynamic> args = {
+        'inputPath': inputPath,
+        'key': key,
+        'start': start,
+      };
+      if (outputPath != null) {
+        args['outputPath'] = outputPath;
+      }
+      if (end != null) {
+        args['end'] = end;
+      }
+      final bool result = await methodChannel.invokeMethod('trimChunkedFile', args);
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<int> encryptFileSegments({required String inputPath, required String outputPrefix, required String key, int? segmentSize}) async {
+    try {
+      final Map<String, dynamic> args = {
+        'inputPath': inputPath,
+        'outputPrefix': outputPrefix,
+        'key': key,
+      };
+      if (segmentSize != null) {
+        args['segmentSize'] = segmentSize;
+      }
+      final int count = await methodChannel.invokeMethod('encryptFileSegments', args);
+      return count < 0 ? -1 : count;
+    } on PlatformException {
+      return -1;
+    }
+  }
+
+  @override
+  Future<bool> joinFileSegments({required String manifestPath, required String outputPath, required String key}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('joinFileSegments', {
+        'manifestPath': manifestPath,
+        'outputPath': outputPath,
+        'key': key,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<int> readerOpen({required String path, required String key}) async {
+    final int handle = await methodChannel.invokeMethod('readerOpen', {
+      'path': path,
+      'key': key,
+    });
+    return handle;
+  }
+
+  @override
+  Future<Uint8List> readerRead({required int handle, required int offset, required int length}) async {
+    final Uint8List bytes = await methodChannel.invokeMethod('readerRead', {
+      'handle': handle,
+      'offset': offset,
+      'length': length,
+    });
+    return bytes;
+  }
+
+  @override
+  Future<int> readerLength({required int handle}) async {
+    final int length = await methodChannel.invokeMethod('readerLength', {'handle': handle});
+    return length;
+  }
+
+  @override
+  Future<void> readerClose({required int handle}) async {
+    await methodChannel.invokeMethod('readerClose', {'handle': handle});
+  }
+
+  @override
+  Future<Uint8List> decryptFileToBytes({required String path, required String key}) async {
+    final Uint8List bytes = await methodChannel.invokeMethod('decryptFileToBytes', {
+      'path': path,
+      'key': key,
+    });
+    return bytes;
+  }
+
+  @override
+  Future<bool> encryptBytesToFile({required Uint8List bytes, required String path, required String key, bool header = false}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('encryptBytesToFile', {
+        'bytes': bytes,
+        'path': path,
+        'key': key,
+        'header': header,
+      });
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<Map<dynamic, dynamic>> decryptToMemory({required String path, required String key}) async {
+    final Map<dynamic, dynamic> info = await methodChannel.invokeMethod('decryptToMemory', {
+      'path': path,
+      'key': key,
+    });
+    return info;
+  }
+
+  @override
+  Future<void> releaseMemoryFile({required int fd}) async {
+    await methodChannel.invokeMethod('releaseMemoryFile', {'fd': fd});
+  }
+
+  @override
+  Future<int> startFollowEncryption({required String inputPath, required String outputPath, required String key, bool header = false, bool finishOnClose = false}) async {
+    final int handle = await methodChannel.invokeMethod('startFollowEncryption', {
+      'inputPath': inputPath,
+      'outputPath': outputPath,
+      'key': key,
+      'header': header,
+      'finishOnClose': finishOnClose,
+    });
+    return handle;
+  }
+
+  @override
+  Future<int> followProgress({required int handle}) async {
+    final int progress = await methodChannel.invokeMethod('followProgress', {'handle': handle});
+    return progress;
+  }
+
+  @override
+  Future<bool> finishFollowEncryption({required int handle}) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('finishFollowEncryption', {'handle': handle});
+      return result;
+    } on PlatformException {
+      return false;
+    }
+  }
+
+  @override
+  Future<String> registerStream({required String path, required String key, String? mimeType}) async {
+    final Map<String, dynamic> args = {
+      'path': path,
+      'key': key,
+    };
+    if (mimeType != null) {
+      args['mimeType'] = mimeType;
+    }
+    final String url = await methodChannel.invokeMethod('registerStream', args);
+    return url;
+  }
+
+  @override
+  Future<void> unregisterStream({required String token}) async {
+    await methodChannel.invokeMethod('unregisterStream', {'token': token});
+  }
+
+  @override
+  Future<void> stopStreamServer() async {
+    await methodChannel.invokeMethod('stopStreamServer');
+  }
+
+  @override
+  Future<Map<dynamic, dynamic>> getMetrics() async {
+    final Map<dynamic, dynamic> metrics = await methodChannel.invokeMethod('getMetrics');
+    return metrics;
+  }
+
+  @override
+  Future<String> getMetricsText() async {
+    final String text = await methodChannel.invokeMethod('getMetricsText');
+    return text;
+  }
+
+  @override
+  Future<void> resetMetrics() async {
+    await methodChannel.invokeMethod('resetMetrics');
+  }
+
+  @override
+  Future<void> setTraceEnabled(bool enabled) async {
+    await methodChannel.invokeMethod('setTraceEnabled', {'enabled': enabled});
+  }
+
+  @override
+  Future<void> setTaskPriority(AesTaskPriority priority) async {
+    await methodChannel.invokeMethod('setTaskPriority', {'priority': priority.name});
+  }
+
+  @override
+  Future<void> setBackgroundBudget({int? bytesPerSecond, int? maxThreads}) async {
+    await methodChannel.invokeMethod('setBackgroundBudget', {
+      'bytesPerSecond': bytesPerSecond ?? 0,
+      'maxThreads': maxThreads ?? 0,
+    });
+  }
+
+  @override
+  Future<void> setMemoryBudget(int? bytes) async {
+    await methodChannel.invokeMethod('setMemoryBudget', {'bytes': bytes ?? 0});
+  }
+
+  @override
+  Future<void> trimMemory({bool complete = false}) async {
+    await methodChannel.invokeMethod('trimMemory', {'complete': complete});
+  }
+
+  @override
+  Future<Map<dynamic, dynamic>> getMemoryUsage() async {
+    final Map<dynamic, dynamic> usage = await methodChannel.invokeMethod('getMemoryUsage');
+    return usage;
+  }
+
+  @override
+  Future<Map<dynamic, dynamic>> calibrate(String directory) async {
+    final Map<dynamic, dynamic> profile = await methodChannel.invokeMethod('calibrate', {
+      'directory': directory,
+      'priority': 'background',
+    });
+    return profile;
+  }
+
+  @override
+  Future<void> setTuningOptions({int? bufferSize, int? threads, int? readAhead, bool autoCalibrate = true}) async {
+    await methodChannel.invokeMethod('setTuningOptions', {
+      'bufferSize': bufferSize ?? 0,
+      'threads': threads ?? 0,
+      'readAhead': readAhead ?? 0,
+      'autoCalibrate': autoCalibrate,
+    });
+  }
+
+  @override
+  Future<Map<dynamic, dynamic>> getTuningProfile(String? directory) async {
+    final Map<dynamic, dynamic> profile = await methodChannel.invokeMethod('getTuningProfile', {
+      'directory': directory,
+    });
+    return profile;
+  }
+
 }
@@ -1,6 +1,10 @@
+import 'dart:typed_data';
+
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
 import 'aes_encrypt_file_method_channel.dart';
+import 'operation_stats.dart';
+import 'task_priority.dart';
 
 abstract class AesEncryptFilePlatform extends PlatformInterface {
   /// Constructs a AesEncryptFilePlatform.
@@ -25,8 +29,151 @@ abstract class AesEncryptFilePlatform extends PlatformInterface {
 
 
 
-  Future<bool> encryptFile({required String inputPath, required String outputPath, required String key, String? iv});
+  /// Encrypts [inputPath] into [outputPath].
+  ///
+  /// With [resumable] the native side checkpoints progress next to the
+  /// output and a repeated call continues an interrupted run. With [header]
+  /// the output starts with a versioned, self-describing header.
+  Future<bool> encryptFile({required String inputPath, required String outputPath, required String key, String? iv, bool resumable = false, bool header = false, void Function(AesOperationStats)? onStats, AesTaskPriority? priority});
+
+  /// With [onStats] the native side also reports where the operation spent
+  /// its time; the same applies to [encryptFile] and [rekeyFile].
+  Future<bool> decryptFile({required String inputPath, required String outputPath, required String key, String? iv, void Function(AesOperationStats)? onStats, AesTaskPriority? priority});
+
+  /// Encrypts inputPaths[i] into outputPaths[i] as one pipelined batch;
+  /// returns a success flag per file. With [sync] each output is flushed.
+  Future<List<bool>> encryptFiles({required List<String> inputPaths, required List<String> outputPaths, required String key, bool sync = false, AesTaskPriority? priority});
+
+  /// Batch counterpart of [decryptFile]; see [encryptFiles].
+  Future<List<bool>> decryptFiles({required List<String> inputPaths, required List<String> outputPaths, required String key, bool sync = false, AesTaskPriority? priority});
+
+  /// Appends the plaintext of [inputPath] to the encrypted file at [encryptedPath].
+  Future<bool> appendFile({required String encryptedPath, required String inputPath, required String key, bool sync = false});
+
+  /// Reads format, sizes and IV from the headers of [paths]; entries are
+  /// null for files that could not be read.
+  Future<List<Map<dynamic, dynamic>?>> getFileInfo({required List<String> paths});
+
+  /// Decrypts [path] without writing any output and reports whether it is
+  /// intact.
+  Future<Map<dynamic, dynamic>> verifyFile({required String path, required String key, Uint8List? expectedSha256, bool lowPriority = false});
+
+  /// Re-encrypts an encrypted file under [newKey] in a single pass.
+  Future<bool> rekeyFile({required String inputPath, String? outputPath, required String oldKey, required String newKey, void Function(AesOperationStats)? onStats});
+
+  /// Encrypts into the envelope format (random data key wrapped by [key]).
+  Future<bool> envelopeEncryptFile({required String inputPath, required String outputPath, required String key});
+
+  /// Decrypts a file written by [envelopeEncryptFile].
+  Future<bool> envelopeDecryptFile({required String inputPath, required String outputPath, required String key});
+
+  /// Encrypts into the sparse format, skipping holes and zero blocks.
+  Future<bool> sparseEncryptFile({required String inputPath, required String outputPath, required String key});
+
+  /// Decrypts a file written by [sparseEncryptFile], recreating its holes.
+  Future<bool> sparseDecryptFile({required String inputPath, required String outputPath, required String key});
+
+  /// Re-wraps the data key of each envelope file from [oldKey] to [newKey].
+  /// Returns the paths that could not be re-wrapped.
+  Future<List<String>> rewrapFileKeys({required List<String> paths, required String oldKey, required String newKey});
+
+  /// Encrypts into the chunked format, rewriting only changed chunks of an
+  /// existing output. Returns the number of chunks written, or -1 on failure.
+  Future<int> encryptFileIncremental({required String inputPath, required String outputPath, required String key, int? chunkSize});
+
+  /// Decrypts a file written by [encryptFileIncremental].
+  Future<bool> decryptChunkedFile({required String inputPath, required String outputPath, required String key});
+
+  /// Joins chunked files into [outputPath] without decrypting them.
+  Future<bool> concatChunkedFiles({required List<String> inputPaths, required String outputPath, required String key});
+
+  /// Keeps the chunks of a chunked file that overlap [start, end); in place without [outputPath].
+  Future<bool> trimChunkedFile({required String inputPath, String? outputPath, required String key, int start = 0, int? end});
+
+  /// Encrypts [inputPath] into segment files next to [outputPrefix]; returns the segment count or -1.
+  Future<int> encryptFileSegments({required String inputPath, required String outputPrefix, required String key, int? segmentSize});
+
+  /// Decrypts the segments listed in [manifestPath] into [outputPath].
+  Future<bool> joinFileSegments({required String manifestPath, required String outputPath, required String key});
+
+  /// Opens a seekable reader over an encrypted file and returns its handle.
+  Future<int> readerOpen({required String path, required String key});
+
+  /// Reads up to [length] plaintext bytes at [offset] from an open reader.
+  Future<Uint8List> readerRead({required int handle, required int offset, required int length});
+
+  /// Returns the plaintext length of the file behind an open reader.
+  Future<int> readerLength({required int handle});
+
+  /// Releases the native reader behind [handle].
+  Future<void> readerClose({required int handle});
+
+  /// Decrypts [path] and returns the plaintext.
+  Future<Uint8List> decryptFileToBytes({required String path, required String key});
+
+  /// Encrypts [bytes] into the file at [path].
+  Future<bool> encryptBytesToFile({required Uint8List bytes, required String path, required String key, bool header = false});
+
+  /// Decrypts [path] into a sealed memory file; returns its `fd`, `path` and `length`.
+  Future<Map<dynamic, dynamic>> decryptToMemory({required String path, required String key});
+
+  /// Closes a memory file created by [decryptToMemory].
+  Future<void> releaseMemoryFile({required int fd});
+
+  /// Starts encrypting [inputPath] while it is still being written; returns a handle.
+  Future<int> startFollowEncryption({required String inputPath, required String outputPath, required String key, bool header = false, bool finishOnClose = false});
+
+  /// Plaintext bytes encrypted so far by the follower [handle].
+  Future<int> followProgress({required int handle});
+
+  /// Finishes the follower [handle] and releases it.
+  Future<bool> finishFollowEncryption({required int handle});
+
+  /// Serves an encrypted file over the loopback stream server and returns its URL.
+  Future<String> registerStream({required String path, required String key, String? mimeType});
+
+  /// Stops serving the stream identified by [token].
+  Future<void> unregisterStream({required String token});
+
+  /// Stops the loopback stream server and drops every registered stream.
+  Future<void> stopStreamServer();
+
+  /// Snapshot of the process-wide engine metrics.
+  Future<Map<dynamic, dynamic>> getMetrics();
+
+  /// The engine metrics in the Prometheus text exposition format.
+  Future<String> getMetricsText();
+
+  /// Zeroes every engine metric.
+  Future<void> resetMetrics();
+
+  /// Turns the native trace spans on or off in builds that include them.
+  Future<void> setTraceEnabled(bool enabled);
+
+  /// Sets the lane for calls that don't pass their own priority.
+  Future<void> setTaskPriority(AesTaskPriority priority);
+
+  /// Caps background work at [bytesPerSecond] of reads plus writes and
+  /// [maxThreads] threads per operation; null or 0 removes a cap.
+  Future<void> setBackgroundBudget({int? bytesPerSecond, int? maxThreads});
+
+  /// Sets the native memory budget in bytes; null or 0 restores the default.
+  Future<void> setMemoryBudget(int? bytes);
+
+  /// Releases pooled buffers and cached chunks; [complete] also lowers the
+  /// budget for a while.
+  Future<void> trimMemory({bool complete = false});
+
+  /// Snapshot of the native memory budget.
+  Future<Map<dynamic, dynamic>> getMemoryUsage();
+
+  /// Benchmarks [directory]'s filesystem and applies the resulting profile.
+  Future<Map<dynamic, dynamic>> calibrate(String directory);
+
+  /// Overrides tuned settings; null or 0 keeps the measured value.
+  Future<void> setTuningOptions({int? bufferSize, int? threads, int? readAhead, bool autoCalibrate = true});
 
-  Future<bool> decryptFile({required String inputPath, required String outputPath, required String key, String? iv});
+  /// Settings in force for [directory]'s filesystem, or the defaults.
+  Future<Map<dynamic, dynamic>> getTuningProfile(String? directory);
 
 }
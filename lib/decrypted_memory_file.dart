@@ -0,0 +1,41 @@
+import 'dart:io';
+
+import 'package:flutter/services.dart';
+
+import 'aes_encrypt_file_platform_interface.dart';
+
+/// Plaintext of an encrypted file held in an anonymous, sealed memory file.
+///
+/// [path] (`/proc/self/fd/N`) can be handed to anything in the app process
+/// that wants a file path — image decoders, PDF renderers, SQLite — and is
+/// read at memory speed. The plaintext never touches storage; call [close]
+/// to release the memory.
+class DecryptedMemoryFile {
+  DecryptedMemoryFile._(this._fd, this.path, this.length);
+
+  final int _fd;
+  bool _closed = false;
+
+  /// Readable path of the memory file, valid until [close].
+  final String path;
+
+  /// Plaintext length in bytes.
+  final int length;
+
+  /// Decrypts [path] with [key] into a new memory file.
+  static Future<DecryptedMemoryFile> decrypt({required String path, required String key}) async {
+    try {
+      final info = await AesEncryptFilePlatform.instance.decryptToMemory(path: path, key: key);
+      return DecryptedMemoryFile._(info['fd'] as int, info['path'] as String, info['length'] as int);
+    } on PlatformException catch (e) {
+      throw FileSystemException(e.message ?? 'Cannot decrypt to memory', path);
+    }
+  }
+
+  /// Releases the memory file; [path] stops resolving afterwards.
+  Future<void> close() async {
+    if (_closed) return;
+    _closed = true;
+    await AesEncryptFilePlatform.instance.releaseMemoryFile(fd: _fd);
+  }
+}
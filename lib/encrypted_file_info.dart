@@ -0,0 +1,75 @@
+import 'dart:typed_data';
+
+/// Container format of an encrypted file.
+enum EncryptedFileFormat {
+  /// Not recognised (or too short to hold an IV).
+  unknown,
+
+  /// 16-byte IV followed by the AES-256-CTR body; no metadata.
+  legacy,
+
+  /// Versioned `AESFILE1` header (see `encryptFile(header: true)`).
+  header,
+
+  /// Chunked format written by `encryptFileIncremental`.
+  chunked,
+
+  /// Envelope format written by `envelopeEncryptFile`.
+  envelope,
+
+  /// Sparse format written by `sparseEncryptFile`.
+  sparse,
+}
+
+/// Metadata of an encrypted file, read from its header without decrypting
+/// or reading the body.
+class EncryptedFileInfo {
+  const EncryptedFileInfo({
+    required this.path,
+    required this.format,
+    required this.version,
+    required this.chunkSize,
+    required this.headerSize,
+    required this.fileSize,
+    required this.plaintextSize,
+    this.iv,
+  });
+
+  /// Builds an instance from the map returned by the platform channel.
+  factory EncryptedFileInfo.fromMap(String path, Map<dynamic, dynamic> map) {
+    final format = map['format'] as int;
+    return EncryptedFileInfo(
+      path: path,
+      format: format >= 0 && format < EncryptedFileFormat.values.length
+          ? EncryptedFileFormat.values[format]
+          : EncryptedFileFormat.unknown,
+      version: map['version'] as int,
+      chunkSize: map['chunkSize'] as int,
+      headerSize: map['headerSize'] as int,
+      fileSize: map['fileSize'] as int,
+      plaintextSize: map['plaintextSize'] as int,
+      iv: map['iv'] as Uint8List?,
+    );
+  }
+
+  final String path;
+  final EncryptedFileFormat format;
+
+  /// Format version from the header, 0 for [EncryptedFileFormat.legacy].
+  final int version;
+
+  /// Plaintext bytes per chunk, 0 for single-stream formats.
+  final int chunkSize;
+
+  /// Bytes in front of the encrypted body.
+  final int headerSize;
+
+  /// Size of the encrypted file on disk.
+  final int fileSize;
+
+  /// Size of the decrypted content, or -1 if it cannot be known from the header.
+  final int plaintextSize;
+
+  /// IV of single-stream formats, null for chunked files.
+  final Uint8List? iv;
+}
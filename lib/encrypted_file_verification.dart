@@ -0,0 +1,42 @@
+import 'dart:typed_data';
+
+/// Outcome of `AesEncryptFile.verifyFile`.
+class EncryptedFileVerification {
+  const EncryptedFileVerification({
+    required this.passed,
+    required this.errorCode,
+    required this.bytesVerified,
+    this.firstCorruptOffset,
+    this.sha256,
+  });
+
+  /// Builds an instance from the map returned by the platform channel.
+  factory EncryptedFileVerification.fromMap(Map<dynamic, dynamic> map) {
+    final firstBadOffset = map['firstBadOffset'] as int;
+    return EncryptedFileVerification(
+      passed: map['passed'] as bool,
+      errorCode: map['error'] as int,
+      bytesVerified: map['bytesVerified'] as int,
+      firstCorruptOffset: firstBadOffset < 0 ? null : firstBadOffset,
+      sha256: map['sha256'] as Uint8List?,
+    );
+  }
+
+  /// Whether every available check succeeded.
+  final bool passed;
+
+  /// Native error code when verification could not run (for example -10 for
+  /// a wrong key), 0 otherwise.
+  final int errorCode;
+
+  /// Plaintext bytes decrypted and checked.
+  final int bytesVerified;
+
+  /// Plaintext offset of the first corrupt region, when the format can
+  /// locate it (chunked files, or a body shorter or longer than its header).
+  final int? firstCorruptOffset;
+
+  /// SHA-256 of the plaintext. Store it at backup time and pass it back as
+  /// `expectedSha256` to check formats that carry no per-chunk tags.
+  final Uint8List? sha256;
+}
@@ -0,0 +1,91 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+
+import 'aes_encrypt_file_platform_interface.dart';
+
+/// Random access to the plaintext of an encrypted file, modelled on
+/// [RandomAccessFile].
+///
+/// The native side keeps the file open together with the key schedule and
+/// a cache of decrypted chunks, so many small or overlapping reads (media
+/// scrubbing, thumbnail probing) do not re-open or re-decrypt the file.
+class EncryptedRandomAccessFile {
+  EncryptedRandomAccessFile._(this.path, this._handle);
+
+  /// Path of the encrypted file.
+  final String path;
+
+  final int _handle;
+  int _position = 0;
+  bool _closed = false;
+
+  /// Opens [path] for reading with [key].
+  static Future<EncryptedRandomAccessFile> open({required String path, required String key}) async {
+    try {
+      final handle = await AesEncryptFilePlatform.instance.readerOpen(path: path, key: key);
+      return EncryptedRandomAccessFile._(path, handle);
+    } on PlatformException catch (e) {
+      throw FileSystemException(e.message ?? 'Cannot open encrypted file', path);
+    }
+  }
+
+  /// Plaintext length of the file.
+  Future<int> length() {
+    _checkOpen();
+    return AesEncryptFilePlatform.instance.readerLength(handle: _handle);
+  }
+
+  /// Current read position.
+  Future<int> position() async {
+    _checkOpen();
+    return _position;
+  }
+
+  /// Moves the read position used by [read].
+  Future<EncryptedRandomAccessFile> setPosition(int position) async {
+    _checkOpen();
+    if (position < 0) {
+      throw RangeError.range(position, 0, null, 'position');
+    }
+    _position = position;
+    return this;
+  }
+
+  /// Reads up to [count] bytes at the current position and advances it.
+  ///
+  /// Returns fewer bytes than requested only at the end of the file.
+  Future<Uint8List> read(int count) async {
+    final bytes = await readAt(_position, count);
+    _position += bytes.length;
+    return bytes;
+  }
+
+  /// Reads up to [count] bytes at [offset] without moving the position.
+  Future<Uint8List> readAt(int offset, int count) async {
+    _checkOpen();
+    try {
+      return await AesEncryptFilePlatform.instance.readerRead(
+        handle: _handle,
+        offset: offset,
+        length: count,
+      );
+    } on PlatformException catch (e) {
+      throw FileSystemException(e.message ?? 'Read failed', path);
+    }
+  }
+
+  /// Releases the native reader. The object must not be used afterwards.
+  Future<void> close() async {
+    if (_closed) return;
+    _closed = true;
+    await AesEncryptFilePlatform.instance.readerClose(handle: _handle);
+  }
+
+  void _checkOpen() {
+    if (_closed) {
+      throw FileSystemException('File closed', path);
+    }
+  }
+}
@@ -0,0 +1,86 @@
+import 'dart:io';
+
+/// One part file written by `encryptFileSegments`.
+///
+/// Every part is a standalone `AESFILE1` file that `decryptFile` can open on
+/// its own; its counter starts at [offset], so the parts together decrypt to
+/// the original file.
+class EncryptedSegment {
+  const EncryptedSegment({
+    required this.index,
+    required this.offset,
+    required this.length,
+    required this.sha256,
+    required this.path,
+  });
+
+  final int index;
+
+  /// Position of this part's plaintext in the original file.
+  final int offset;
+
+  /// Plaintext bytes in this part.
+  final int length;
+
+  /// Hex SHA-256 of the part file as stored, e.g. for upload integrity checks.
+  final String sha256;
+
+  /// Path of the part file.
+  final String path;
+}
+
+/// Manifest listing the parts of a segmented encryption, in order.
+class EncryptedSegmentManifest {
+  const EncryptedSegmentManifest({
+    required this.path,
+    required this.segmentSize,
+    required this.plaintextSize,
+    required this.segments,
+  });
+
+  /// Reads the text manifest written next to the parts.
+  static Future<EncryptedSegmentManifest> read(String path) async {
+    final lines = (await File(path).readAsLines()).where((line) => line.isNotEmpty).toList();
+    if (lines.length < 4 || lines[0] != 'AESSEG1') {
+      throw FileSystemException('Not a segment manifest', path);
+    }
+    int field(String line, String name) {
+      final parts = line.split(' ');
+      if (parts.length != 2 || parts[0] != name) {
+        throw FileSystemException('Malformed segment manifest', path);
+      }
+      return int.parse(parts[1]);
+    }
+
+    final directory = File(path).parent.path;
+    return EncryptedSegmentManifest(
+      path: path,
+      segmentSize: field(lines[1], 'segment_size'),
+      plaintextSize: field(lines[2], 'plaintext_size'),
+      segments: [
+        for (final line in lines.skip(4))
+          () {
+            final parts = line.split(' ');
+            return EncryptedSegment(
+              index: int.parse(parts[0]),
+              offset: int.parse(parts[1]),
+              length: int.parse(parts[2]),
+              sha256: parts[3],
+              path: '$directory/${parts[4]}',
+            );
+          }(),
+      ],
+    );
+  }
+
+  /// Path of the manifest itself.
+  final String path;
+
+  /// Plaintext bytes per part (the last part may be shorter).
+  final int segmentSize;
+
+  /// Size of the original file.
+  final int plaintextSize;
+
+  final List<EncryptedSegment> segments;
+}
@@ -0,0 +1,82 @@
+/// Aggregate counters and latency percentiles for one operation type.
+class AesOperationMetrics {
+  const AesOperationMetrics({
+    required this.count,
+    required this.errors,
+    required this.bytes,
+    required this.totalTime,
+    required this.p50,
+    required this.p99,
+    required this.p999,
+    required this.max,
+    required this.errorsByCode,
+  });
+
+  /// Builds an instance from the map returned by the platform channel.
+  factory AesOperationMetrics.fromMap(Map<dynamic, dynamic> map) {
+    Duration nanos(String name) => Duration(microseconds: (map[name] as int) ~/ 1000);
+    return AesOperationMetrics(
+      count: map['count'] as int,
+      errors: map['errors'] as int,
+      bytes: map['bytes'] as int,
+      totalTime: nanos('totalNanos'),
+      p50: nanos('p50Nanos'),
+      p99: nanos('p99Nanos'),
+      p999: nanos('p999Nanos'),
+      max: nanos('maxNanos'),
+      errorsByCode: (map['errorsByCode'] as Map<dynamic, dynamic>)
+          .map((code, count) => MapEntry(code as int, count as int)),
+    );
+  }
+
+  /// Operations completed, successful or not.
+  final int count;
+
+  /// Operations that returned an error.
+  final int errors;
+
+  /// Bytes produced by successful operations.
+  final int bytes;
+
+  /// Sum of all latencies.
+  final Duration totalTime;
+
+  /// Median latency.
+  final Duration p50;
+
+  /// 99th percentile latency.
+  final Duration p99;
+
+  /// 99.9th percentile latency.
+  final Duration p999;
+
+  /// Slowest operation.
+  final Duration max;
+
+  /// Failures by native error code (e.g. -10 for a wrong key, -12 for a file
+  /// in a format the call doesn't handle); 0 collects codes without a slot of
+  /// their own.
+  final Map<int, int> errorsByCode;
+}
+
+/// Process-wide snapshot of the native engine metrics, from
+/// `AesEncryptFile.getMetrics`.
+class AesEngineMetrics {
+  const AesEngineMetrics({required this.operations, required this.queueWait});
+
+  /// Builds an instance from the map returned by the platform channel.
+  factory AesEngineMetrics.fromMap(Map<dynamic, dynamic> map) {
+    return AesEngineMetrics(
+      operations: (map['operations'] as Map<dynamic, dynamic>).map((name, entry) =>
+          MapEntry(name as String, AesOperationMetrics.fromMap(entry as Map<dynamic, dynamic>))),
+      queueWait: AesOperationMetrics.fromMap(map['queueWait'] as Map<dynamic, dynamic>),
+    );
+  }
+
+  /// Metrics keyed by operation: `encrypt`, `decrypt`, `rekey`, `append`,
+  /// `verify` and `read` (random-access reads).
+  final Map<String, AesOperationMetrics> operations;
+
+  /// How long parallel work waited for a worker thread to start it.
+  final AesOperationMetrics queueWait;
+}
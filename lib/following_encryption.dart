@@ -0,0 +1,62 @@
+import 'dart:io';
+
+import 'package:flutter/services.dart';
+
+import 'aes_encrypt_file_platform_interface.dart';
+
+/// Encryption that follows a file while another component is still writing it.
+///
+/// Completed 1MB chunks are encrypted in the background as the recording
+/// grows, so only the tail is left when [finish] is called. The first 4MB
+/// are encrypted again on [finish], which picks up header rewrites such as an
+/// MP4 muxer patching its `moov`/`mdat` sizes at the end of a recording.
+class FollowingEncryption {
+  FollowingEncryption._(this._handle, this.inputPath, this.outputPath);
+
+  final int _handle;
+  bool _finished = false;
+
+  /// File being recorded.
+  final String inputPath;
+
+  /// Encrypted output being built.
+  final String outputPath;
+
+  /// Starts following [inputPath] and encrypting it into [outputPath].
+  static Future<FollowingEncryption> start({
+    required String inputPath,
+    required String outputPath,
+    required String key,
+    bool header = false,
+    bool finishOnClose = false,
+  }) async {
+    try {
+      final handle = await AesEncryptFilePlatform.instance.startFollowEncryption(
+        inputPath: inputPath,
+        outputPath: outputPath,
+        key: key,
+        header: header,
+        finishOnClose: finishOnClose,
+      );
+      return FollowingEncryption._(handle, inputPath, outputPath);
+    } on PlatformException catch (e) {
+      throw FileSystemException(e.message ?? 'Cannot follow file', inputPath);
+    }
+  }
+
+  /// Plaintext bytes encrypted so far, or -1 once finished.
+  Future<int> progress() {
+    if (_finished) return Future.value(-1);
+    return AesEncryptFilePlatform.instance.followProgress(handle: _handle);
+  }
+
+  /// Encrypts the remaining bytes, seals the output and stops following.
+  ///
+  /// With `finishOnClose` the follower may already have finished on its own
+  /// when the writer closed the file; this then only collects the result.
+  Future<bool> finish() async {
+    if (_finished) return false;
+    _finished = true;
+    return AesEncryptFilePlatform.instance.finishFollowEncryption(handle: _handle);
+  }
+}
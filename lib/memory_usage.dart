@@ -0,0 +1,56 @@
+/// Snapshot of the native engine's memory budget, from
+/// `AesEncryptFile.getMemoryUsage`.
+class AesMemoryUsage {
+  const AesMemoryUsage({
+    required this.budget,
+    required this.inUse,
+    required this.pooled,
+    required this.peak,
+    required this.waits,
+    required this.opensslInUse,
+    required this.opensslCached,
+    required this.opensslMallocs,
+  });
+
+  /// Builds an instance from the map returned by the platform channel.
+  factory AesMemoryUsage.fromMap(Map<dynamic, dynamic> map) {
+    return AesMemoryUsage(
+      budget: map['budget'] as int,
+      inUse: map['inUse'] as int,
+      pooled: map['pooled'] as int,
+      peak: map['peak'] as int,
+      waits: map['waits'] as int,
+      opensslInUse: map['opensslInUse'] as int,
+      opensslCached: map['opensslCached'] as int,
+      opensslMallocs: map['opensslMallocs'] as int,
+    );
+  }
+
+  /// Current limit in bytes; halved for a while after a critical trim.
+  final int budget;
+
+  /// Bytes held by running operations, readers and stream servers.
+  final int inUse;
+
+  /// Free I/O buffers kept for the next operation.
+  final int pooled;
+
+  /// Highest [inUse] + [pooled] since start or the last trim.
+  final int peak;
+
+  /// Buffer requests that had to wait for memory to be released.
+  final int waits;
+
+  /// Bytes OpenSSL holds (cipher contexts, provider state).
+  final int opensslInUse;
+
+  /// Freed OpenSSL blocks kept for reuse.
+  final int opensslCached;
+
+  /// Heap allocations made for OpenSSL since start; stops growing once
+  /// operations run from the free lists.
+  final int opensslMallocs;
+
+  /// Everything the native engine holds: budgeted memory plus OpenSSL's.
+  int get total => inUse + pooled + opensslInUse + opensslCached;
+}
@@ -0,0 +1,87 @@
+/// Where an encrypt, decrypt or rekey operation spent its time, reported
+/// through the `onStats` callback of those methods.
+///
+/// Read, crypto, write and CPU time are summed over every native thread the
+/// operation used, so with [threads] above 1 they can exceed [wallTime].
+class AesOperationStats {
+  const AesOperationStats({
+    required this.bytesProcessed,
+    required this.wallTime,
+    required this.readTime,
+    required this.cryptoTime,
+    required this.writeTime,
+    required this.readCalls,
+    required this.writeCalls,
+    required this.cpuTime,
+    required this.bufferSize,
+    required this.threads,
+    required this.allocations,
+    required this.backend,
+  });
+
+  /// Builds an instance from the map returned by the platform channel.
+  factory AesOperationStats.fromMap(Map<dynamic, dynamic> map) {
+    Duration nanos(String name) => Duration(microseconds: (map[name] as int) ~/ 1000);
+    return AesOperationStats(
+      bytesProcessed: map['bytesProcessed'] as int,
+      wallTime: nanos('wallNanos'),
+      readTime: nanos('readNanos'),
+      cryptoTime: nanos('cryptoNanos'),
+      writeTime: nanos('writeNanos'),
+      readCalls: map['readCalls'] as int,
+      writeCalls: map['writeCalls'] as int,
+      cpuTime: nanos('cpuNanos'),
+      bufferSize: map['bufferSize'] as int,
+      threads: map['threads'] as int,
+      allocations: map['allocations'] as int,
+      backend: map['backend'] as String,
+    );
+  }
+
+  /// Bytes passed through the cipher.
+  final int bytesProcessed;
+
+  /// Elapsed time from start to finish.
+  final Duration wallTime;
+
+  /// Time spent waiting on reads.
+  final Duration readTime;
+
+  /// Time spent in the AES implementation.
+  final Duration cryptoTime;
+
+  /// Time spent waiting on writes.
+  final Duration writeTime;
+
+  /// Read calls issued to the file system.
+  final int readCalls;
+
+  /// Write calls issued to the file system.
+  final int writeCalls;
+
+  /// CPU time used by the native threads.
+  final Duration cpuTime;
+
+  /// Size of the I/O buffer in bytes.
+  final int bufferSize;
+
+  /// Native threads that worked on the operation.
+  final int threads;
+
+  /// Heap allocations OpenSSL needed that its free lists could not serve;
+  /// 0 once the engine is warm.
+  final int allocations;
+
+  /// Cipher implementation in use, e.g. `OpenSSL 3.1.1 AES-256-CTR (ARMv8 CE)`.
+  final String backend;
+
+  /// Throughput over the wall time, in bytes per second.
+  double get bytesPerSecond =>
+      wallTime.inMicroseconds == 0 ? 0 : bytesProcessed * 1000000 / wallTime.inMicroseconds;
+
+  @override
+  String toString() => 'AesOperationStats($bytesProcessed bytes in ${wallTime.inMilliseconds} ms, '
+      'read ${readTime.inMilliseconds} ms, crypto ${cryptoTime.inMilliseconds} ms, '
+      'write ${writeTime.inMilliseconds} ms, cpu ${cpuTime.inMilliseconds} ms, '
+      '$threads thread(s), $backend)';
+}
@@ -0,0 +1,9 @@
+/// Lane a native call runs in on Android.
+enum AesTaskPriority {
+  /// Work the user is waiting for; one worker thread per CPU core.
+  foreground,
+
+  /// Prefetching, verification and bulk jobs; fewer threads at background
+  /// thread priority, so they never hold up [foreground] calls.
+  background,
+}
@@ -0,0 +1,43 @@
+/// Buffer size, worker count and read-ahead the native engine uses on one
+/// filesystem, from `AesEncryptFile.calibrate` or
+/// `AesEncryptFile.getTuningProfile`.
+class AesTuningProfile {
+  const AesTuningProfile({
+    required this.bufferSize,
+    required this.threads,
+    required this.readAhead,
+    required this.readBytesPerSecond,
+    required this.writeBytesPerSecond,
+    required this.cipherBytesPerSecond,
+  });
+
+  /// Builds an instance from the map returned by the platform channel.
+  factory AesTuningProfile.fromMap(Map<dynamic, dynamic> map) {
+    return AesTuningProfile(
+      bufferSize: map['bufferSize'] as int,
+      threads: map['threads'] as int,
+      readAhead: map['readAhead'] as int,
+      readBytesPerSecond: map['readBytesPerSecond'] as int,
+      writeBytesPerSecond: map['writeBytesPerSecond'] as int,
+      cipherBytesPerSecond: map['cipherBytesPerSecond'] as int,
+    );
+  }
+
+  /// Bytes per read, cipher call and write.
+  final int bufferSize;
+
+  /// Workers for rekey and segmented jobs; 0 means one per CPU.
+  final int threads;
+
+  /// Chunks an `EncryptedRandomAccessFile` fetches ahead on sequential reads.
+  final int readAhead;
+
+  /// Cold-cache read throughput measured at [bufferSize]; 0 if not measured.
+  final int readBytesPerSecond;
+
+  /// Synced write throughput measured at [bufferSize]; 0 if not measured.
+  final int writeBytesPerSecond;
+
+  /// AES-256-CTR throughput of one core, in memory; 0 if not measured.
+  final int cipherBytesPerSecond;
+}